@@ -1,6 +1,8 @@
 #include "app.hpp"
 #include "simple_render_system.hpp"
 #include "vmc_camera.hpp"
+#include "block_textures.hpp"
+#include "vmc_ktx2_file.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -10,38 +12,273 @@
 #define VMA_IMPLEMENTATION
 #include <vma/vk_mem_alloc.h>
 
+#include <algorithm>
 #include <stdexcept>
 #include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
 #include <thread>
+#include <unordered_set>
 
 namespace vmc {
-	App::App() {
+	App::App(const AppOptions& options) : options{ options } {
+		if (vmcDevice.supportsDrawIndirectCount()) {
+			gpuCulling = std::make_unique<GpuCullingSystem>(vmcDevice, startupPipelines);
+			hiZPyramid = std::make_unique<VmcHiZPyramid>(vmcDevice, vmcRenderer.getSwapChainExtent(), startupPipelines);
+		}
+		std::cout << "section culling: " << (gpuCulling ? "gpu, one indirect count draw, hi-z occlusion (toggle with O)" : "cpu, drawIndirectCount not supported")
+			<< std::endl;
+		loadBlockTextures();
+		loadWorld();
+		benchmarkRaycasts();
+		// light isn't saved, it is worked out again in the background
+		std::vector<const Chunk*> chunks;
+		world.forEachChunk([&](const Chunk& chunk) { chunks.push_back(&chunk); });
+		lightingSystem.addChunks(chunks);
 		loadGameObjects();
 	}
 
 	App::~App() { }
 
+	void App::loadBlockTextures() {
+		const auto start = std::chrono::steady_clock::now();
+		// the baked file when there is one this device can sample, otherwise they are made up on the spot
+		Ktx2Image image;
+		std::string error;
+		const bool baked = vmcDevice.supportsTextureCompressionBC() && VmcKtx2File::read(BLOCK_TEXTURES_PATH, image, &error) &&
+			image.width == BlockTextures::SIZE && image.height == BlockTextures::SIZE && image.layerCount == TEXTURE_LAYER_COUNT;
+		if (!baked) {
+			if (!error.empty() && error != "can't be opened") std::cout << "block textures: " << BLOCK_TEXTURES_PATH << " " << error << ", ignoring it" << std::endl;
+			image = {};
+			image.format = VK_FORMAT_R8G8B8A8_SRGB;
+			image.width = BlockTextures::SIZE;
+			image.height = BlockTextures::SIZE;
+			image.layerCount = TEXTURE_LAYER_COUNT;
+			image.levels.push_back(BlockTextures::generate());
+		}
+		blockTextures = std::make_unique<VmcTextureArray>(vmcDevice, uploadManager, image);
+		if (textures.add(blockTextures->getImageView(), blockTextures->getSampler()) != BLOCK_TEXTURE_SLOT) {
+			throw std::runtime_error("block textures have to be the first bindless texture");
+		}
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "block textures: " << (baked ? "baked, " : "generated, bake them with --bake-textures, ") << blockTextures->getLayerCount() << " layers of "
+			<< BlockTextures::SIZE << "x" << BlockTextures::SIZE << " with " << blockTextures->getMipLevels() << " mips, " << blockTextures->getSizeInBytes() / 1024.0
+			<< " KiB, loaded in " << ms << " ms, bindless slot " << BLOCK_TEXTURE_SLOT << std::endl;
+	}
+
 	void App::run() {
-		SimpleRenderSystem simpleRenderSystem{ vmcDevice, vmcRenderer.getSwapChainRenderPass() };
+		SimpleRenderSystem simpleRenderSystem{ vmcDevice, vmcRenderer.getSwapChainRenderPass(), frameRing, textures, startupPipelines, pipelineCompiler };
+		const size_t pipelineCount = startupPipelines.getPendingCount();
+		const double pipelineMs = startupPipelines.build(jobSystem);
+		std::cout << "created " << pipelineCount << " pipelines on " << jobSystem.getWorkerCount() + 1 << " threads in " << pipelineMs << " ms, pipeline cache "
+			<< (pipelineCache.wasLoaded() ? "warm (" + std::to_string(pipelineCache.getLoadedBytes() / 1024) + " KiB)" : std::string{ "cold" }) << std::endl;
+		bool firstFrame = true;
 		VmcCamera camera{};
 		//float dt = 0.0f;
 		//auto startTime = std::chrono::steady_clock::now();
+		auto statsTime = std::chrono::steady_clock::now();
+		// made once the world has settled when benchmarking, the loop ends with its last frame
+		std::unique_ptr<FrameBenchmark> benchmark;
+		std::unique_ptr<VmcGpuTimer> gpuTimer;
+		double warmupMs = 0.0;
 
-		while (!vmcWindow.shouldClose()) {
-			glfwPollEvents();
+		while (!vmcWindow.shouldClose() && !(benchmark && benchmark->isDone())) {
+			const auto frameStart = std::chrono::steady_clock::now();
+			if (!vmcWindow.isHeadless()) glfwPollEvents();
+			if (keyPressed(GLFW_KEY_G, gpuDrawingKeyDown) && gpuCulling) {
+				gpuDrawing = !gpuDrawing;
+				std::cout << "sections drawn " << (gpuDrawing ? "with gpu culling" : "from the cpu, recorded on " + std::to_string(commandRecorder.getThreadCount()) + " threads")
+					<< std::endl;
+			}
+			if (keyPressed(GLFW_KEY_F, wireframeKeyDown) && vmcDevice.supportsWireframe()) {
+				simpleRenderSystem.setWireframe(!simpleRenderSystem.getWireframe());
+				std::cout << "wireframe " << (simpleRenderSystem.getWireframe() ? "on" : "off") << std::endl;
+			}
+			if (keyPressed(GLFW_KEY_O, occlusionKeyDown) && gpuCulling) {
+				occlusionCulling = !occlusionCulling;
+				std::cout << "occlusion culling " << (occlusionCulling ? "on" : "off") << std::endl;
+			}
+			if (keyPressed(GLFW_KEY_C, caveKeyDown)) {
+				caveCulling = !caveCulling;
+				std::cout << "cave culling " << (caveCulling ? "on" : "off") << std::endl;
+			}
+			if (keyPressed(GLFW_KEY_V, occlusionMeshKeyDown) && meshesQueued) {
+				meshingSystem.setAmbientOcclusion(!meshingSystem.getAmbientOcclusion());
+				std::cout << "ambient occlusion " << (meshingSystem.getAmbientOcclusion() ? "on" : "off") << ", remeshing" << std::endl;
+				queueSectionMeshes();
+			}
+			if (keyPressed(GLFW_KEY_E, swarmKeyDown)) toggleEntitySwarm();
+			const bool dig = keyPressed(GLFW_KEY_L, digKeyDown);
+			const bool place = keyPressed(GLFW_KEY_K, placeKeyDown);
+			if ((dig || place) && meshesQueued) {
+				const RayHit hit = raycaster.cast({ cameraPosition(), { .0f, -1.f, .0f }, static_cast<float>(Chunk::HEIGHT) });
+				if (hit.hit) {
+					const glm::ivec3 target = place ? hit.position + hit.normal : hit.position;
+					editBlock(target.x, target.y, target.z, place ? BLOCK_GLOWSTONE : BLOCK_AIR);
+				}
+			}
+			applyLight();
+			remeshDirtySections();
+			updateLods();
+			uploadSectionMeshes();
+			// one batch for everything uploaded this frame, on the graphics queue ahead of the frame that draws it
+			uploadManager.submit();
+			if (options.benchmarkFrames > 0 && !benchmark && !worldSettled() && std::chrono::steady_clock::now() - startTime > BENCHMARK_WARMUP_LIMIT) {
+				vkDeviceWaitIdle(vmcDevice.device());
+				throw std::runtime_error("benchmark: the world didn't settle within " + std::to_string(BENCHMARK_WARMUP_LIMIT.count()) + " s");
+			}
+			if (options.benchmarkFrames > 0 && !benchmark && worldSettled()) {
+				benchmark = std::make_unique<FrameBenchmark>(options.benchmarkFrames);
+				gpuTimer = std::make_unique<VmcGpuTimer>(vmcDevice);
+				warmupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+				std::cout << "benchmark: world ready after " << warmupMs << " ms, timing " << options.benchmarkFrames << " frames"
+					<< (gpuTimer->isSupported() ? "" : ", the graphics queue has no timestamps") << std::endl;
+			}
 			float aspect = vmcRenderer.getAspectRatio();
 			//camera.setOrthographicProjection(-aspect, aspect, -1, 1, -1, 1);
-			camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 10.f);
+			camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 800.f);
+			if (benchmark) {
+				benchmark->setCameraView(camera, cameraPosition(), worldTransform.translation.w);
+			} else {
+				// the world is y up while the renderer is y down, so it is rotated 180 degrees around x
+				camera.setViewTransform({ 1.f, .0f, .0f, .0f }, worldTransform.translation);
+			}
+			if (!drawsOnGpu()) cullSections(camera);
+			cullCaves(camera);
 			//auto stopTime = std::chrono::steady_clock::now();
 			//dt = std::chrono::duration_cast<std::chrono::duration<float>>(stopTime - startTime).count();
 			//startTime = std::chrono::steady_clock::now();
 
 			// the beginFrame function returns a nullptr if the swapchain needs to be recreated
+			// a frame skipped to recreate the swapchain draws nothing, so the benchmark doesn't count it
+			bool drawn = false;
 			if (auto commandbuffer = vmcRenderer.beginFrame()) {
-				vmcRenderer.beginSwapChainRenderPass(commandbuffer);
-				simpleRenderSystem.renderEntities<Rect>(commandbuffer, registry, camera);
-				vmcRenderer.endSwapChainRenderPass(commandbuffer);
+				drawn = true;
+				const int frameIndex = vmcRenderer.getFrameIndex();
+				if (gpuTimer) {
+					// beginFrame waited on this slot's fence, so the frame it last held has its timestamps
+					double gpuMs;
+					if (gpuTimer->read(frameIndex, gpuMs)) benchmark->addGpuFrame(gpuMs);
+					gpuTimer->begin(commandbuffer, frameIndex);
+				}
+				frameRing.beginFrame(frameIndex);
+				commandRecorder.beginFrame(frameIndex);
+				simpleRenderSystem.beginFrame();
+				// cleared whichever path runs, so turning occlusion back on never sees last frame's entities
+				if (gpuCulling) gpuCulling->clearEntities(frameIndex);
+				const bool occlusion = drawsOnGpu() && occlusionCulling;
+				simpleRenderSystem.cullEntities<Rect>(registry, camera, occlusion ? gpuCulling.get() : nullptr);
+				// the compute passes can't be recorded inside a render pass
+				if (drawsOnGpu()) {
+					const VkExtent2D extent = vmcRenderer.getSwapChainExtent();
+					if (extent.width != hiZPyramid->getExtent().width || extent.height != hiZPyramid->getExtent().height) hiZPyramid->resize(extent);
+					gpuCulling->cull(commandbuffer, frameIndex, camera, *hiZPyramid, occlusion);
+				}
+
+				if (drawsOnGpu()) {
+					vmcRenderer.beginSwapChainRenderPass(commandbuffer, occlusion ? SwapChainPass::First : SwapChainPass::Single);
+					simpleRenderSystem.renderSectionsIndirect(commandbuffer, *gpuCulling, meshArena, camera, frameIndex);
+					simpleRenderSystem.renderEntities(commandbuffer, frameIndex);
+					vmcRenderer.endSwapChainRenderPass(commandbuffer);
+				} else {
+					// a draw per section, recorded on every core into secondaries
+					vmcRenderer.beginSwapChainRenderPass(commandbuffer, SwapChainPass::Single, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+					commandRecorder.beginPass(vmcRenderer.getSwapChainRenderPass(), vmcRenderer.getCurrentFramebuffer(), vmcRenderer.getSwapChainExtent());
+					const uint32_t cameraOffset = simpleRenderSystem.writeCamera(camera);
+					commandRecorder.recordParallel(visibleSections.size(), [&](VkCommandBuffer secondary, size_t first, size_t last) {
+						simpleRenderSystem.renderSectionRange(secondary, visibleSections, first, last, meshArena, cameraOffset);
+					});
+					VkCommandBuffer entityCommands = commandRecorder.beginSecondary();
+					simpleRenderSystem.renderEntities(entityCommands, frameIndex);
+					commandRecorder.endSecondary(entityCommands);
+					commandRecorder.execute(commandbuffer);
+					vmcRenderer.endSwapChainRenderPass(commandbuffer);
+				}
+
+				if (occlusion) {
+					// rebuild the pyramid from what was just drawn and give everything last frame's depth hid a second chance
+					hiZPyramid->build(commandbuffer, frameIndex, vmcRenderer.getCurrentDepthImageView(), camera.getProjectionMatrix() * camera.getViewMatrix(),
+						camera.getProjectionMatrix());
+					gpuCulling->cullOccluded(commandbuffer, frameIndex);
+					vmcRenderer.beginSwapChainRenderPass(commandbuffer, SwapChainPass::Second);
+					simpleRenderSystem.renderSectionsIndirect(commandbuffer, *gpuCulling, meshArena, camera, frameIndex, CullPhase::Second);
+					simpleRenderSystem.renderEntities(commandbuffer, frameIndex, CullPhase::Second);
+					vmcRenderer.endSwapChainRenderPass(commandbuffer);
+				}
+				if (gpuTimer) gpuTimer->end(commandbuffer, frameIndex);
+				frameRing.flush();
+				pipelineCompiler.endFrame();
 				vmcRenderer.endFrame();
+				frameNumber++;
+				if (firstFrame) {
+					firstFrame = false;
+					std::cout << "first frame after " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count()
+						<< " ms, pipeline cache " << (pipelineCache.wasLoaded() ? "warm" : "cold") << std::endl;
+				}
+				// edits uploaded this frame are on screen once it is presented
+				for (const auto& time : visibleEdits) {
+					editLatencyStats.add(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - time).count());
+				}
+				visibleEdits.clear();
+			}
+			freeRetiredMeshes();
+			if (benchmark && drawn) benchmark->addCpuFrame(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+
+			if (std::chrono::steady_clock::now() - statsTime > std::chrono::seconds{ 5 }) {
+				statsTime = std::chrono::steady_clock::now();
+				const CullStats& entityStats = simpleRenderSystem.getEntityCullStats();
+				if (drawsOnGpu()) {
+					std::cout << "gpu culling: " << gpuCulling->getVisibleCount() << "/" << gpuCulling->getSectionCount() << " sections visible, occlusion "
+						<< (occlusionCulling ? "on" : "off") << " hid " << gpuCulling->getOccludedSections() << " sections and " << gpuCulling->getOccludedEntities()
+						<< " entities, ";
+				} else {
+					std::cout << "frustum culling: " << sectionCullStats.visible << "/" << sectionCullStats.tested << " sections visible ("
+						<< sectionCullStats.culled() << " culled, " << toString(sectionCuller.getSimdLevel()) << "), ";
+				}
+				if (drawsOnGpu()) caveCullStats.culled = gpuCulling->getCaveCulledSections();
+				std::cout << "cave culling " << (caveCulling ? "on" : "off") << ": reached " << caveCullStats.reached << " sections, culled "
+					<< caveCullStats.culled << ", ";
+				const EntityRenderStats& entityRenderStats = simpleRenderSystem.getEntityStats();
+				std::cout << entityStats.visible << "/" << entityStats.tested << " entities visible in " << entityRenderStats.draws / std::max<uint64_t>(entityRenderStats.frames, 1)
+					<< " instanced draws (" << entityRenderStats.averageCpuMs() << " ms cpu a frame)" << std::endl;
+				const ArenaOccupancy vertexOccupancy = meshArena.getVertexOccupancy();
+				const ArenaOccupancy indexOccupancy = meshArena.getIndexOccupancy();
+				const ArenaStats& arenaStats = meshArena.getStats();
+				std::cout << "mesh arena: " << vertexOccupancy.used << "/" << vertexOccupancy.capacity << " vertices in " << vertexOccupancy.freeRanges
+					<< " free ranges (fragmentation " << vertexOccupancy.fragmentation() << "), " << indexOccupancy.used << "/" << indexOccupancy.capacity
+					<< " indices in " << indexOccupancy.freeRanges << " free ranges (fragmentation " << indexOccupancy.fragmentation() << "), "
+					<< arenaStats.allocations << " allocations avg " << arenaStats.averageAllocateUs() << " us max " << arenaStats.maxAllocateUs << " us, "
+					<< arenaStats.frees << " frees" << std::endl;
+				meshArena.resetStats();
+				if (editLatencyStats.edits > 0) {
+					std::cout << "block edits: " << editLatencyStats.edits << " visible after avg " << editLatencyStats.averageMs() << " ms max "
+						<< editLatencyStats.maxMs << " ms" << std::endl;
+					editLatencyStats = {};
+				}
+				std::cout << "frame ring: " << frameRing.getLastFrameBytes() / 1024 << " KiB last frame, high water " << frameRing.getHighWaterMark() / 1024 << "/"
+					<< frameRing.getFrameSize() / 1024 << " KiB" << std::endl;
+				if (!drawsOnGpu()) {
+					const RecordStats& recordStats = commandRecorder.getStats();
+					std::cout << "recording: " << recordStats.averageMs() << " ms a frame for " << recordStats.draws / std::max<uint64_t>(recordStats.frames, 1)
+						<< " section draws on " << commandRecorder.getThreadCount() << " threads, " << recordStats.secondaries / std::max<uint64_t>(recordStats.frames, 1)
+						<< " secondaries" << std::endl;
+				}
+				const UploadStats& uploadStats = uploadManager.getStats();
+				if (uploadStats.batches > 0) {
+					std::cout << "uploads: " << uploadStats.bytes / (1024.0 * 1024.0) << " MiB in " << uploadStats.copies << " copies over " << uploadStats.batches
+						<< " batches on the " << (uploadManager.usesTransferQueue() ? "transfer" : "graphics") << " queue, " << uploadStats.megabytesPerSecond()
+						<< " MiB/s, stalled " << uploadStats.stallMs << " ms" << std::endl;
+				}
+				uploadManager.resetStats();
+				const PipelineCompileStats& compileStats = pipelineCompiler.getStats();
+				if (compileStats.requested > 0) {
+					std::cout << "pipelines: " << compileStats.compiled << "/" << compileStats.requested << " compiled in the background, avg "
+						<< compileStats.averageCompileMs() << " ms max " << compileStats.maxCompileMs << " ms, " << compileStats.fallbackFrames
+						<< " frames drew with a fallback" << std::endl;
+				}
+				commandRecorder.resetStats();
+				simpleRenderSystem.resetEntityStats();
 			}
 			//auto et = std::chrono::steady_clock::now();
 			//std::cout << 1 / std::chrono::duration_cast<std::chrono::duration<float>>(et - stopTime).count() << " ";
@@ -49,6 +286,20 @@ namespace vmc {
 		}
 		// cpu will wait until all gpu operations have been completed
 		vkDeviceWaitIdle(vmcDevice.device());
+		if (benchmark) {
+			// the last frames in flight haven't been read yet
+			for (int frameIndex = 0; frameIndex < VmcSwapChain::MAX_FRAMES_IN_FLIGHT; frameIndex++) {
+				double gpuMs;
+				if (gpuTimer->read(frameIndex, gpuMs)) benchmark->addGpuFrame(gpuMs);
+			}
+			reportBenchmark(*benchmark, warmupMs);
+		}
+		for (const auto& [frame, mesh] : retiredMeshes) meshArena.free(mesh);
+		retiredMeshes.clear();
+
+		// block edits only live in memory until here, the next start loads whatever was saved
+		const size_t savedChunks = worldStorage.saveDirtyChunks(world);
+		if (savedChunks > 0) std::cout << "storage: saved " << savedChunks << " edited chunks" << std::endl;
 	}
 
 	// draw frame while glfwPollEvents has paused so that we keep drawing as we resize the window
@@ -111,14 +362,423 @@ namespace vmc {
 		for (auto& v : vertices) {
 			v.position += offset;
 		}
-		return std::make_unique<VmcModel>(device, vertices);
+		auto model = std::make_unique<VmcModel>(device, vertices);
+		const MeshOptimizeStats& stats = model->getOptimizeStats();
+		std::cout << "cube model: " << stats.verticesBefore << " -> " << stats.verticesAfter << " vertices, " << stats.triangles << " triangles, acmr "
+			<< stats.acmrBefore() << " -> " << stats.acmrAfter() << std::endl;
+		return model;
 	}
 	void App::loadGameObjects() {
-		std::unique_ptr<VmcModel> cubeModel = createCubeModel(vmcDevice, { .0f, .0f, .0f });
+		cubeModel = createCubeModel(vmcDevice, { .0f, .0f, .0f });
 		auto cubeEntity = registry.create();
 		Rect r;
-		r.model = std::move(cubeModel);
+		r.model = cubeModel;
 		registry.emplace<Rect>(cubeEntity, std::move(r));
 		registry.emplace<Transform>(cubeEntity, Transform{ {.0f, .0f, 1.f, .25f } });
 	}
+
+	void App::toggleEntitySwarm() {
+		if (!swarmEntities.empty()) {
+			for (entt::entity entity : swarmEntities) registry.destroy(entity);
+			swarmEntities.clear();
+			std::cout << "entity swarm removed" << std::endl;
+			return;
+		}
+		// all share the one cube model, so they end up in a single instanced draw. placed relative to the camera
+		// like the other entities, in a box in front of it
+		std::mt19937 random{ WORLD_SEED };
+		std::uniform_real_distribution<float> across{ -60.f, 60.f };
+		std::uniform_real_distribution<float> depth{ 4.f, 160.f };
+		std::uniform_real_distribution<float> shade{ .3f, 1.f };
+		for (uint32_t i = 0; i < ENTITY_SWARM_SIZE; i++) {
+			const entt::entity entity = registry.create();
+			swarmEntities.push_back(entity);
+			Rect r;
+			r.model = cubeModel;
+			r.color = { shade(random), shade(random), shade(random) };
+			registry.emplace<Rect>(entity, std::move(r));
+			Transform transform{ { across(random), across(random) * .5f, depth(random), .25f } };
+			transform.deg = across(random);
+			registry.emplace<Transform>(entity, transform);
+		}
+		std::cout << "entity swarm of " << ENTITY_SWARM_SIZE << " cubes added" << std::endl;
+	}
+
+	void App::loadWorld() {
+		TerrainGenerator generator{ WORLD_SEED };
+		const int side = WORLD_RADIUS * 2;
+		std::vector<std::unique_ptr<Chunk>> chunks(static_cast<size_t>(side) * side);
+		std::vector<char> generated(chunks.size(), 0);
+
+		// each chunk only depends on the seed and its position, so it doesn't matter which worker builds it.
+		// chunks that were saved by an earlier run are read back instead
+		const auto startTime = std::chrono::steady_clock::now();
+		for (int i = 0; i < side * side; i++) {
+			jobSystem.submit([this, &generator, &chunks, &generated, i, side] {
+				const ChunkPos pos{ i % side - WORLD_RADIUS, i / side - WORLD_RADIUS };
+				chunks[i] = worldStorage.loadChunk(pos);
+				if (chunks[i] == nullptr) {
+					chunks[i] = generator.generate(pos);
+					generated[i] = 1;
+				}
+			});
+		}
+		jobSystem.waitIdle();
+		const float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count();
+
+		// combined in a fixed order so the value is the same for every run with this seed
+		uint64_t checksum = 0;
+		std::vector<const Chunk*> newChunks;
+		for (size_t i = 0; i < chunks.size(); i++) {
+			checksum = checksum * 31 + TerrainGenerator::checksum(*chunks[i]);
+			Chunk& chunk = world.insertChunk(std::move(chunks[i]));
+			if (generated[i]) newChunks.push_back(&chunk);
+		}
+		worldStorage.saveChunks(newChunks);
+
+		const size_t chunkCount = world.getChunkCount();
+		const StorageStats storageStats = worldStorage.getStats();
+		std::cout << "terrain: " << chunkCount << " chunks in " << seconds * 1000.f << " ms (" << chunkCount / seconds << " chunks/s, "
+			<< jobSystem.getWorkerCount() << " workers, " << toString(generator.getSimdLevel()) << "), seed " << WORLD_SEED
+			<< " checksum " << std::hex << checksum << std::dec << std::endl;
+		std::cout << "storage: loaded " << storageStats.chunksLoaded << " chunks (" << storageStats.bytesRead / 1024 << " KiB, "
+			<< storageStats.loadMegabytesPerSecond() << " MB/s, " << storageStats.loadChunksPerSecond() << " chunks/s per thread), saved "
+			<< storageStats.chunksSaved << " chunks (" << storageStats.bytesWritten / 1024 << " KiB, " << storageStats.saveMegabytesPerSecond()
+			<< " MB/s, " << storageStats.saveChunksPerSecond() << " chunks/s)" << std::endl;
+		std::cout << "world: " << chunkCount << " chunks, " << world.memoryUsage() / 1024 << " KiB total, "
+			<< world.memoryUsage() / chunkCount << " bytes per chunk" << std::endl;
+	}
+
+	void App::benchmarkRaycasts() {
+		// from anywhere between the caves and well above the surface, so there is a mix of short and long rays
+		constexpr size_t rayCount = 1 << 16;
+		std::mt19937 random{ WORLD_SEED };
+		std::uniform_real_distribution<float> horizontal{ -WORLD_RADIUS * 16.f, WORLD_RADIUS * 16.f };
+		std::uniform_real_distribution<float> height{ 20.f, 120.f };
+		std::uniform_real_distribution<float> unit{ -1.f, 1.f };
+		std::vector<Ray> rays(rayCount);
+		for (Ray& ray : rays) {
+			ray.origin = { horizontal(random), height(random), horizontal(random) };
+			ray.direction = { unit(random), unit(random), unit(random) };
+		}
+
+		std::vector<RayHit> hits;
+		const RaycastStats stats = raycaster.castBatch(jobSystem, rays, hits);
+		std::cout << "raycasts: " << stats.rays << " rays in " << stats.ms << " ms (" << stats.raysPerSecond() << " rays/s on " << jobSystem.getWorkerCount() + 1
+			<< " threads), " << stats.hits << " hits, " << static_cast<double>(stats.steps) / stats.rays << " blocks per ray" << std::endl;
+	}
+
+	glm::vec3 App::cameraPosition() const {
+		// the world is drawn rotated around x and then translated, so the camera sits at (-t.x, t.y, t.z)
+		return { -worldTransform.translation.x, worldTransform.translation.y, worldTransform.translation.z };
+	}
+
+	ChunkPos App::cameraChunk() const {
+		const glm::vec3 cameraPos = cameraPosition();
+		return { static_cast<int>(std::floor(cameraPos.x / ChunkSection::SIZE)), static_cast<int>(std::floor(cameraPos.z / ChunkSection::SIZE)) };
+	}
+
+	int App::chunkLod(ChunkPos pos) const {
+		const int distance = std::max(std::abs(pos.x - lodCenter.x), std::abs(pos.z - lodCenter.z));
+		for (int lod = 0; lod < MAX_LOD; lod++) {
+			if (distance < LOD_DISTANCES[lod]) return lod;
+		}
+		return MAX_LOD;
+	}
+
+	LodInfo App::lodInfo(ChunkPos pos) const {
+		LodInfo info;
+		info.level = chunkLod(pos);
+		info.neighbours = { chunkLod({ pos.x - 1, pos.z }), chunkLod({ pos.x + 1, pos.z }), chunkLod({ pos.x, pos.z - 1 }), chunkLod({ pos.x, pos.z + 1 }) };
+		return info;
+	}
+
+	void App::queueSectionMeshes() {
+		lodCenter = cameraChunk();
+		world.forEachChunk([&](const Chunk& chunk) {
+			const LodInfo lod = lodInfo(chunk.getPos());
+			chunkLods[chunk.getPos()] = lod.level;
+			chunk.forEachSection([&](int y, const ChunkSection& section) {
+				if (section.isEmpty()) return;
+				meshingSystem.requestMesh(world, { chunk.getPos().x, y, chunk.getPos().z }, lod);
+			});
+		});
+		std::cout << "queued " << meshingSystem.getStats().requested << " sections for meshing on " << jobSystem.getWorkerCount() << " workers" << std::endl;
+	}
+
+	void App::applyLight() {
+		static const int faceOffsets[6][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+		// reports go first, everything an edit relit has been published by the time its report shows up, so it is all
+		// drained below and the edit's sections are remeshed once with the right light
+		std::chrono::steady_clock::time_point editTime = std::chrono::steady_clock::now();
+		lightingSystem.drainReports([&](const LightReport& report) {
+			if (report.edit) {
+				std::cout << "light edit at " << report.x << " " << report.y << " " << report.z << ": " << report.cellsTouched << " cells touched in "
+					<< report.ms << " ms" << std::endl;
+				if (pendingEdits.empty()) return;
+				const PendingEdit& edit = pendingEdits.front();
+				markEditDirty(edit.x, edit.y, edit.z, edit.time);
+				editTime = edit.time;
+				pendingEdits.pop_front();
+			} else {
+				std::cout << "lighting: " << report.chunks << " chunks in " << report.ms << " ms, " << report.cellsTouched << " cells lit on "
+					<< jobSystem.getWorkerCount() << " workers" << std::endl;
+			}
+		});
+		lightingSystem.drainUpdates([&](LightUpdate& update) {
+			Chunk* chunk = world.getChunk(update.pos.chunk());
+			if (chunk == nullptr) return;
+			chunk->getLight(update.pos.y) = std::move(update.light);
+			// lower lods are meshed without light
+			if (!meshesQueued || chunkLod(update.pos.chunk()) != 0) return;
+			markDirty(update.pos, editTime);
+			for (int face = 0; face < 6; face++) {
+				if ((update.borderFaces & (1 << face)) == 0) continue;
+				const SectionPos neighbor{ update.pos.x + faceOffsets[face][0], update.pos.y + faceOffsets[face][1], update.pos.z + faceOffsets[face][2] };
+				if (chunkLod(neighbor.chunk()) == 0) markDirty(neighbor, editTime);
+			}
+		});
+
+		if (!meshesQueued && lightingSystem.isIdle()) {
+			queueSectionMeshes();
+			meshesQueued = true;
+		}
+	}
+
+	void App::editBlock(int x, int y, int z, BlockId block) {
+		if (y < 0 || y >= Chunk::HEIGHT || !world.setBlock(x, y, z, block)) return;
+		// nothing is remeshed until the light has caught up, otherwise the new block would show up unlit for a few frames
+		lightingSystem.setBlock(x, y, z, block);
+		pendingEdits.push_back({ x, y, z, std::chrono::steady_clock::now() });
+	}
+
+	void App::markEditDirty(int x, int y, int z, std::chrono::steady_clock::time_point time) {
+		// a block on the border of its section is also read by the meshes next to it, for face culling across the
+		// border and for ambient occlusion, which reaches into the sections across an edge or corner as well
+		const int local[3] = { x & 15, y & 15, z & 15 };
+		for (int dx = -1; dx <= 1; dx++) {
+			if ((dx == -1 && local[0] != 0) || (dx == 1 && local[0] != 15)) continue;
+			for (int dy = -1; dy <= 1; dy++) {
+				if ((dy == -1 && local[1] != 0) || (dy == 1 && local[1] != 15)) continue;
+				for (int dz = -1; dz <= 1; dz++) {
+					if ((dz == -1 && local[2] != 0) || (dz == 1 && local[2] != 15)) continue;
+					markDirty({ (x >> 4) + dx, (y >> 4) + dy, (z >> 4) + dz }, time);
+				}
+			}
+		}
+	}
+
+	void App::markDirty(SectionPos pos, std::chrono::steady_clock::time_point time) {
+		if (pos.y < 0 || pos.y >= Chunk::SECTION_COUNT) return;
+		auto [it, inserted] = dirtySections.emplace(pos, time);
+		if (!inserted && time < it->second) it->second = time;
+	}
+
+	void App::remeshDirtySections() {
+		if (dirtySections.empty()) return;
+		// everything dirtied this frame is meshed as one group and swapped in on the same frame, so a block moving
+		// across a section border never leaves a frame with the old mesh on one side and the new one on the other
+		const uint64_t id = nextRemeshGroup++;
+		RemeshGroup& group = remeshGroups[id];
+		group.editTime = std::chrono::steady_clock::time_point::max();
+		for (const auto& [pos, time] : dirtySections) {
+			const Chunk* chunk = world.getChunk(pos.chunk());
+			// a section that was empty and still is has no mesh to replace
+			if (chunk == nullptr || (chunk->getSection(pos.y).isEmpty() && sectionMeshes.count(pos) == 0)) continue;
+
+			// a section still waiting in an older group is meshed again, so the old group can't finish without this one
+			auto previous = sectionRemeshGroups.find(pos);
+			if (previous != sectionRemeshGroups.end() && previous->second != id) mergeRemeshGroup(previous->second, id);
+			group.editTime = std::min(group.editTime, time);
+			group.waiting.insert(pos);
+			sectionRemeshGroups[pos] = id;
+			meshingSystem.requestMesh(world, pos, lodInfo(pos.chunk()));
+		}
+		dirtySections.clear();
+		if (group.waiting.empty()) remeshGroups.erase(id);
+	}
+
+	void App::mergeRemeshGroup(uint64_t from, uint64_t into) {
+		RemeshGroup source = std::move(remeshGroups[from]);
+		remeshGroups.erase(from);
+		RemeshGroup& target = remeshGroups[into];
+		target.editTime = std::min(target.editTime, source.editTime);
+		for (const SectionPos& pos : source.waiting) {
+			target.waiting.insert(pos);
+			sectionRemeshGroups[pos] = into;
+		}
+		for (MeshResult& result : source.ready) target.ready.push_back(std::move(result));
+	}
+
+	void App::updateLods() {
+		const ChunkPos center = cameraChunk();
+		if (center == lodCenter) return;
+		lodCenter = center;
+
+		std::unordered_set<ChunkPos, ChunkPosHash> changed;
+		for (auto& [pos, lod] : chunkLods) {
+			const int newLod = chunkLod(pos);
+			if (newLod == lod) continue;
+			lod = newLod;
+			changed.insert(pos);
+			changed.insert({ pos.x - 1, pos.z });
+			changed.insert({ pos.x + 1, pos.z });
+			changed.insert({ pos.x, pos.z - 1 });
+			changed.insert({ pos.x, pos.z + 1 });
+		}
+
+		for (const ChunkPos& pos : changed) {
+			const Chunk* chunk = world.getChunk(pos);
+			if (chunk == nullptr) continue;
+			const LodInfo lod = lodInfo(pos);
+			chunk->forEachSection([&](int y, const ChunkSection& section) {
+				if (section.isEmpty()) return;
+				meshingSystem.requestMesh(world, { pos.x, y, pos.z }, lod);
+			});
+		}
+	}
+
+	void App::cullSections(const VmcCamera& camera) {
+		sectionCuller.clear();
+		sectionCuller.reserve(sectionMeshes.size());
+		culledSections.clear();
+		for (const auto& [pos, section] : sectionMeshes) {
+			sectionCuller.add(section.bounds);
+			culledSections.push_back(&section);
+		}
+
+		sectionCullStats = sectionCuller.cull(camera.getFrustum(), visibleIndices);
+		visibleSections.clear();
+		for (uint32_t index : visibleIndices) visibleSections.push_back(culledSections[index]);
+	}
+
+	void App::cullCaves(const VmcCamera& camera) {
+		caveCullStats = {};
+		if (!caveCulling || !caveCuller.search(cameraPosition(), camera.getFrustum())) return;
+		caveCullStats = caveCuller.getStats();
+
+		if (drawsOnGpu()) {
+			reachableSlots.clear();
+			for (const SectionPos& pos : caveCuller.getReached()) {
+				auto it = sectionMeshes.find(pos);
+				if (it != sectionMeshes.end() && it->second.cullSlot != UINT32_MAX) reachableSlots.push_back(it->second.cullSlot);
+			}
+			gpuCulling->restrictToSlots(reachableSlots);
+			return;
+		}
+
+		const size_t frustumVisible = visibleSections.size();
+		visibleSections.erase(std::remove_if(visibleSections.begin(), visibleSections.end(),
+			[&](const SectionMesh* section) { return !caveCuller.isReachable(section->pos); }), visibleSections.end());
+		caveCullStats.culled = static_cast<uint32_t>(frustumVisible - visibleSections.size());
+	}
+
+	bool App::keyPressed(int key, bool& wasDown) {
+		if (vmcWindow.isHeadless()) return false;
+		const bool down = glfwGetKey(vmcWindow.getGLFWwindow(), key) == GLFW_PRESS;
+		const bool pressed = down && !wasDown;
+		wasDown = down;
+		return pressed;
+	}
+
+	bool App::worldSettled() const {
+		return meshesQueued && lightingSystem.isIdle() && meshingSystem.isIdle() && dirtySections.empty() && remeshGroups.empty();
+	}
+
+	void App::reportBenchmark(const FrameBenchmark& benchmark, double warmupMs) {
+		BenchmarkInfo info;
+		info.device = vmcDevice.properties.deviceName;
+		info.width = vmcRenderer.getSwapChainExtent().width;
+		info.height = vmcRenderer.getSwapChainExtent().height;
+		info.headless = vmcWindow.isHeadless();
+		info.culling = drawsOnGpu() ? "gpu" : "cpu";
+		info.warmupMs = warmupMs;
+		if (!benchmark.writeJson(options.benchmarkOutput, info)) throw std::runtime_error("failed to write " + options.benchmarkOutput);
+
+		const FrameTimeSummary cpu = FrameBenchmark::summarize(benchmark.getCpuFrames());
+		const FrameTimeSummary gpu = FrameBenchmark::summarize(benchmark.getGpuFrames());
+		std::cout << "benchmark: " << cpu.frames << " frames, cpu avg " << cpu.averageMs << " ms p99 " << cpu.p99Ms << " ms, ";
+		if (gpu.frames > 0) {
+			std::cout << "gpu avg " << gpu.averageMs << " ms p99 " << gpu.p99Ms << " ms";
+		} else {
+			std::cout << "no gpu timestamps";
+		}
+		std::cout << ", written to " << options.benchmarkOutput << std::endl;
+	}
+
+	void App::retireMesh(const MeshAllocation& mesh) {
+		if (!mesh.empty()) retiredMeshes.emplace_back(frameNumber, mesh);
+	}
+
+	void App::freeRetiredMeshes() {
+		// beginFrame waits on the fence of the frame MAX_FRAMES_IN_FLIGHT frames back, so anything retired before it is unused
+		while (!retiredMeshes.empty() && retiredMeshes.front().first + VmcSwapChain::MAX_FRAMES_IN_FLIGHT < frameNumber) {
+			meshArena.free(retiredMeshes.front().second);
+			retiredMeshes.pop_front();
+		}
+	}
+
+	void App::uploadSectionMeshes() {
+		// meshes are copied into the arena or the staging ring on the main thread, so cap how many a single frame has to upload
+		constexpr size_t maxUploadsPerFrame = 64;
+		const size_t uploaded = meshingSystem.drainResults([&](MeshResult& result) {
+			auto groupId = sectionRemeshGroups.find(result.pos);
+			if (groupId == sectionRemeshGroups.end()) {
+				uploadSectionMesh(result);
+				return;
+			}
+			// held back until the rest of its group is done, the old mesh stays in the meantime
+			const uint64_t id = groupId->second;
+			sectionRemeshGroups.erase(groupId);
+			RemeshGroup& group = remeshGroups[id];
+			group.waiting.erase(result.pos);
+			group.ready.push_back(std::move(result));
+			if (!group.waiting.empty()) return;
+
+			for (const MeshResult& ready : group.ready) uploadSectionMesh(ready);
+			visibleEdits.push_back(group.editTime);
+			remeshGroups.erase(id);
+		}, maxUploadsPerFrame);
+
+		if (uploaded == 0 || !meshingSystem.isIdle()) return;
+
+		const MeshingStats& stats = meshingSystem.getStats();
+		std::cout << "meshed " << meshStats.sections << " sections: " << meshStats.quads << " quads, " << meshStats.vertices << " vertices, "
+			<< meshStats.triangles << " triangles (" << meshStats.naiveVertices << " vertices with one cube per block)" << std::endl;
+		std::cout << "  vertex cache: " << meshOptimizeStats.verticesBefore << " -> " << meshOptimizeStats.verticesAfter << " vertices, acmr "
+			<< meshOptimizeStats.acmrBefore() << " -> " << meshOptimizeStats.acmrAfter() << std::endl;
+		for (int lod = 0; lod <= MAX_LOD; lod++) {
+			std::cout << "  lod " << lod << ": " << meshStats.sectionsPerLod[lod] << " sections, " << meshStats.verticesPerLod[lod] << " vertices, "
+				<< meshStats.trianglesPerLod[lod] << " triangles" << std::endl;
+		}
+		std::cout << "meshing jobs: " << stats.completed << " done, " << stats.cancelled << " cancelled, " << stats.superseded << " superseded, peak queue depth "
+			<< stats.peakQueueDepth << ", latency avg " << stats.averageLatencyMs() << " ms max " << stats.maxLatencyMs << " ms, mesh avg " << stats.averageMeshMs() << " ms ("
+			<< stats.sectionsPerSecond() << " sections/s per worker, ambient occlusion " << (meshingSystem.getAmbientOcclusion() ? "on" : "off") << ")" << std::endl;
+		meshStats = {};
+		meshOptimizeStats = {};
+		meshingSystem.resetStats();
+	}
+
+	void App::uploadSectionMesh(const MeshResult& result) {
+		meshStats.add(result.mesh, result.solidBlocks);
+		meshOptimizeStats.add(result.optimizeStats);
+		caveCuller.setConnectivity(result.pos, result.mesh.connectivity);
+		// the old range is only retired, frames still in flight keep drawing it and the next one draws the new mesh
+		SectionMesh& section = sectionMeshes[result.pos];
+		retireMesh(section.mesh);
+		if (result.mesh.empty()) {
+			if (gpuCulling && section.cullSlot != UINT32_MAX) gpuCulling->removeSection(section.cullSlot);
+			sectionMeshes.erase(result.pos);
+			return;
+		}
+		section.pos = result.pos;
+		section.mesh = meshArena.allocate(result.mesh.vertices, result.mesh.indices);
+		section.bounds = result.mesh.bounds;
+		if (!gpuCulling) return;
+		if (section.cullSlot == UINT32_MAX) {
+			section.cullSlot = gpuCulling->addSection(section.bounds, section.mesh);
+		} else {
+			gpuCulling->updateSection(section.cullSlot, section.bounds, section.mesh);
+		}
+	}
 }
\ No newline at end of file
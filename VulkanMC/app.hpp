@@ -4,20 +4,101 @@
 #include "vmc_game_object.hpp"
 #include "vmc_renderer.hpp"
 #include "vmc_window.hpp"
+#include "vmc_world.hpp"
 #include "physics_system.hpp"
+#include "chunk_mesher.hpp"
+#include "meshing_system.hpp"
+#include "lighting_system.hpp"
+#include "voxel_raycaster.hpp"
+#include "terrain_generator.hpp"
+#include "vmc_job_system.hpp"
+#include "vmc_world_storage.hpp"
+#include "vmc_camera.hpp"
+#include "vmc_frustum.hpp"
+#include "vmc_mesh_arena.hpp"
+#include "vmc_upload_manager.hpp"
+#include "vmc_descriptor_allocator.hpp"
+#include "vmc_bindless_textures.hpp"
+#include "vmc_texture_array.hpp"
+#include "vmc_pipeline.hpp"
+#include "vmc_pipeline_cache.hpp"
+#include "vmc_pipeline_compiler.hpp"
+#include "vmc_ring_buffer.hpp"
+#include "vmc_command_recorder.hpp"
+#include "gpu_culling_system.hpp"
+#include "vmc_hiz_pyramid.hpp"
+#include "vmc_gpu_timer.hpp"
+#include "frame_benchmark.hpp"
 
 
 // std
+#include <algorithm>
+#include <chrono>
+#include <deque>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace vmc {
+	// set from the command line
+	struct AppOptions {
+		// --no-pipeline-cache, starts with an empty pipeline cache to measure a cold start
+		bool loadPipelineCache = true;
+		// --headless, no window or surface, frames go into offscreen images. always benchmarks since nothing else would end it
+		bool headless = false;
+		// --benchmark [frames], times this many frames along a fixed camera path once the world is ready, then quits
+		uint32_t benchmarkFrames = 0;
+		// --benchmark-output <path>, where the frame time stats are written as json
+		std::string benchmarkOutput = "benchmark.json";
+	};
+
+	// from a block edit to the first presented frame with its remeshed sections
+	struct EditLatencyStats {
+		uint64_t edits = 0;
+		double totalMs = 0.0;
+		float maxMs = .0f;
+
+		void add(float ms) {
+			edits++;
+			totalMs += ms;
+			maxMs = std::max(maxMs, ms);
+		}
+		double averageMs() const { return edits == 0 ? 0.0 : totalMs / edits; }
+	};
+
 	class App {
 	public:
 		static constexpr int WIDTH = 800;
 		static constexpr int HEIGHT = 800;
+		static constexpr uint32_t WORLD_SEED = 1337;
+		// chunks generated in each direction around the origin
+		static constexpr int WORLD_RADIUS = 32;
+		// chebyshev distance in chunks from the camera at which each lod starts, anything further uses MAX_LOD
+		static constexpr int LOD_DISTANCES[MAX_LOD] = { 8, 16, 24 };
+		// shared by every section mesh, uint32 indices so a single draw can reach any of the vertices
+		static constexpr uint32_t MESH_ARENA_VERTICES = 2u << 20;
+		static constexpr uint32_t MESH_ARENA_INDICES = 3u << 20;
+		// bytes of the frame ring each frame in flight gets, enough for the instances of the entity swarm
+		static constexpr VkDeviceSize FRAME_RING_SIZE = 8u << 20;
+		// staging for meshes and textures on their way into device local memory, a frame's worth of meshes fits many times
+		static constexpr VkDeviceSize UPLOAD_STAGING_SIZE = 32u << 20;
+		static constexpr const char* PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+		// written by --bake-textures, loaded instead of generating the block textures when it is there
+		static constexpr const char* BLOCK_TEXTURES_PATH = "block_textures.ktx2";
+		// where the block texture array ends up in the bindless set, BLOCK_TEXTURES in default.frag
+		static constexpr uint32_t BLOCK_TEXTURE_SLOT = 0;
+		// bindless sets per descriptor pool, each one takes a whole array of textures
+		static constexpr uint32_t BINDLESS_SETS_PER_POOL = 4;
+		// timed by --benchmark or --headless when no frame count is given
+		static constexpr uint32_t BENCHMARK_FRAMES = 1000;
+		// a benchmark gives up if the world still hasn't settled after this long, headless nothing else would stop it
+		static constexpr std::chrono::seconds BENCHMARK_WARMUP_LIMIT{ 120 };
+		// cubes spawned with E to see how entity rendering holds up
+		static constexpr uint32_t ENTITY_SWARM_SIZE = 100000;
 
-		App();
+		explicit App(const AppOptions& options = {});
 		~App();
 
 		App(const App&) = delete;
@@ -26,13 +107,145 @@ namespace vmc {
 		void run();
 
 	private:
+		void loadBlockTextures();
 		void loadGameObjects();
+		void toggleEntitySwarm();
+		void loadWorld();
+		// casts a fixed set of random rays through the world and prints how many a second get through
+		void benchmarkRaycasts();
+		void queueSectionMeshes();
+		// copies finished light into the world and remeshes what it changed. the first meshes are only queued
+		// once the whole world has been lit, so nothing has to be meshed twice
+		void applyLight();
+		// sets the block and relights around it, the sections it touches are marked dirty once the light is back
+		void editBlock(int x, int y, int z, BlockId block);
+		// the section of the block and the neighbours that read it, when it is on a border
+		void markEditDirty(int x, int y, int z, std::chrono::steady_clock::time_point time);
+		void markDirty(SectionPos pos, std::chrono::steady_clock::time_point time);
+		// one mesh request per dirty section, no matter how many edits touched it this frame
+		void remeshDirtySections();
+		void mergeRemeshGroup(uint64_t from, uint64_t into);
+		void uploadSectionMeshes();
+		void uploadSectionMesh(const MeshResult& result);
+		glm::vec3 cameraPosition() const;
+		ChunkPos cameraChunk() const;
+		int chunkLod(ChunkPos pos) const;
+		LodInfo lodInfo(ChunkPos pos) const;
+		// remeshes every chunk whose lod changed since the camera entered another chunk, plus its neighbours
+		// so the skirts along the new boundary are rebuilt
+		void updateLods();
+		// with gpu culling available and not switched off with G
+		bool drawsOnGpu() const { return gpuCulling && gpuDrawing; }
+		// fills visibleSections with the sections whose mesh bounds are inside the camera frustum
+		void cullSections(const VmcCamera& camera);
+		// drops sections the camera can't see into from the draw list, or restricts gpu culling to the ones it can
+		void cullCaves(const VmcCamera& camera);
+		// true only on the frame the key goes down, never when headless
+		bool keyPressed(int key, bool& wasDown);
+		// lit, meshed and uploaded with nothing left in flight, when the benchmark starts timing
+		bool worldSettled() const;
+		// writes the json and prints the summary of a finished benchmark
+		void reportBenchmark(const FrameBenchmark& benchmark, double warmupMs);
+		void retireMesh(const MeshAllocation& mesh);
+		void freeRetiredMeshes();
 
-		VmcWindow vmcWindow{ WIDTH, HEIGHT, "Vulkan Tutorial" };
+		// first so it is set before anything else starts up, for the time to first frame
+		std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+		AppOptions options;
+		VmcWindow vmcWindow{ WIDTH, HEIGHT, "Vulkan Tutorial", options.headless };
 		VmcDevice vmcDevice{ vmcWindow };
 		VmcRenderer vmcRenderer{ vmcWindow, vmcDevice };
+		// has to outlive every pipeline, it is saved when the app shuts down
+		VmcPipelineCache pipelineCache{ vmcDevice, PIPELINE_CACHE_PATH, options.loadPipelineCache };
+		// every pipeline the renderer needs, created on the job system before the first frame
+		VmcPipelineBatch startupPipelines;
+		VmcUploadManager uploadManager{ vmcDevice, UPLOAD_STAGING_SIZE };
+		VmcMeshArena meshArena{ vmcDevice, uploadManager, MESH_ARENA_VERTICES, MESH_ARENA_INDICES };
+		// update after bind pools, for the bindless texture set
+		VmcDescriptorAllocator bindlessDescriptors{ vmcDevice,
+			{ { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, BINDLESS_SETS_PER_POOL * VmcBindlessTextures::MAX_TEXTURES } },
+			BINDLESS_SETS_PER_POOL, VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT };
+		VmcBindlessTextures textures{ vmcDevice, bindlessDescriptors };
+		// one layer per block face texture, loaded before the world
+		std::unique_ptr<VmcTextureArray> blockTextures;
+		// camera uniforms and entity instances, written fresh every frame
+		VmcRingBuffer frameRing{ vmcDevice, FRAME_RING_SIZE };
+		// null when the device can't do vkCmdDrawIndexedIndirectCount, sections are then culled and drawn from the cpu
+		std::unique_ptr<GpuCullingSystem> gpuCulling;
+		// built from the depth of the first pass every frame, only used with gpu culling
+		std::unique_ptr<VmcHiZPyramid> hiZPyramid;
+		// toggled with O, splits the frame in two passes around the pyramid build
+		bool occlusionCulling = true;
+		bool occlusionKeyDown = false;
+		// off draws the sections from the cpu culled list like on devices without drawIndirectCount
+		bool gpuDrawing = true;
+		bool gpuDrawingKeyDown = false;
+		// toggled with F when the device can draw lines
+		bool wireframeKeyDown = false;
 
+		VmcWorld world;
+		VoxelRaycaster raycaster{ world };
+		VmcWorldStorage worldStorage{ "world" };
+		VmcJobSystem jobSystem;
+		MeshingSystem meshingSystem{ jobSystem };
+		LightingSystem lightingSystem{ jobSystem };
+		// per section draws when culling on the cpu
+		VmcCommandRecorder commandRecorder{ vmcDevice, jobSystem };
+		// pipelines for render states switched on while running, like the wireframe view
+		VmcPipelineCompiler pipelineCompiler{ jobSystem };
+		bool meshesQueued = false;
+		// debug edits under the camera, L digs out the top block and K puts glowstone on it
+		bool digKeyDown = false;
+		bool placeKeyDown = false;
+		// edits the lighting system hasn't reported back yet, in the order they were made
+		struct PendingEdit {
+			int x;
+			int y;
+			int z;
+			std::chrono::steady_clock::time_point time;
+		};
+		std::deque<PendingEdit> pendingEdits;
+		// with the time of the earliest edit behind each
+		std::unordered_map<SectionPos, std::chrono::steady_clock::time_point, SectionPosHash> dirtySections;
+		// sections remeshed together, their results are kept until the last one is in and then uploaded at once
+		struct RemeshGroup {
+			std::chrono::steady_clock::time_point editTime;
+			std::unordered_set<SectionPos, SectionPosHash> waiting;
+			std::vector<MeshResult> ready;
+		};
+		std::unordered_map<uint64_t, RemeshGroup> remeshGroups;
+		std::unordered_map<SectionPos, uint64_t, SectionPosHash> sectionRemeshGroups;
+		uint64_t nextRemeshGroup = 1;
+		// edit times of the groups uploaded this frame
+		std::vector<std::chrono::steady_clock::time_point> visibleEdits;
+		EditLatencyStats editLatencyStats;
+		// toggled with V, remeshes everything so the meshing times of both can be compared
+		bool occlusionMeshKeyDown = false;
+		MeshStats meshStats;
+		MeshOptimizeStats meshOptimizeStats;
+		std::unordered_map<SectionPos, SectionMesh, SectionPosHash> sectionMeshes;
+		std::unordered_map<ChunkPos, int, ChunkPosHash> chunkLods;
+		VmcFrustumCuller sectionCuller;
+		std::vector<const SectionMesh*> culledSections;
+		std::vector<uint32_t> visibleIndices;
+		std::vector<const SectionMesh*> visibleSections;
+		CullStats sectionCullStats;
+		CaveCuller caveCuller{ { -WORLD_RADIUS, 0, -WORLD_RADIUS }, { 2 * WORLD_RADIUS, Chunk::SECTION_COUNT, 2 * WORLD_RADIUS } };
+		CaveCullStats caveCullStats;
+		std::vector<uint32_t> reachableSlots;
+		// toggled with C
+		bool caveCulling = true;
+		bool caveKeyDown = false;
+		ChunkPos lodCenter{ 0, 0 };
+		// replaced meshes may still be read by a frame in flight, so their arena ranges are kept until that frame has finished
+		std::deque<std::pair<uint64_t, MeshAllocation>> retiredMeshes;
+		uint64_t frameNumber = 0;
+		// pushes the flipped world in front of the camera, which sits above the middle of the world
+		Transform worldTransform{ { .0f, 110.f, .0f, 1.f } };
 		entt::registry registry;
+		std::shared_ptr<VmcModel> cubeModel;
+		std::vector<entt::entity> swarmEntities;
+		bool swarmKeyDown = false;
 		std::unique_ptr<PhysicsSystem> physicsSystem;
 	};
 }  // namespace vmc
\ No newline at end of file
@@ -0,0 +1,251 @@
+#include "bc_encoder.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace vmc {
+	static constexpr int BLOCK_TEXELS = 16;
+
+	// the direction the points spread out along the most, by power iteration on their covariance
+	static void principalAxis(const float (*points)[4], int count, int channels, float mean[4], float axis[4]) {
+		for (int c = 0; c < 4; c++) mean[c] = .0f;
+		for (int i = 0; i < count; i++) {
+			for (int c = 0; c < channels; c++) mean[c] += points[i][c];
+		}
+		for (int c = 0; c < channels; c++) mean[c] /= static_cast<float>(count);
+
+		float covariance[4][4]{};
+		for (int i = 0; i < count; i++) {
+			for (int a = 0; a < channels; a++) {
+				for (int b = 0; b < channels; b++) covariance[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+			}
+		}
+
+		for (int c = 0; c < 4; c++) axis[c] = c < channels ? 1.f : .0f;
+		for (int iteration = 0; iteration < 8; iteration++) {
+			float next[4]{};
+			for (int a = 0; a < channels; a++) {
+				for (int b = 0; b < channels; b++) next[a] += covariance[a][b] * axis[b];
+			}
+			float length = .0f;
+			for (int c = 0; c < channels; c++) length += next[c] * next[c];
+			// every point is the same, any axis will do
+			if (length < 1e-8f) return;
+			length = std::sqrt(length);
+			for (int c = 0; c < channels; c++) axis[c] = next[c] / length;
+		}
+	}
+
+	// the two ends of the points along their principal axis
+	static void fitEndpoints(const float (*points)[4], int count, int channels, float low[4], float high[4]) {
+		float mean[4];
+		float axis[4];
+		principalAxis(points, count, channels, mean, axis);
+		float minT = .0f;
+		float maxT = .0f;
+		for (int i = 0; i < count; i++) {
+			float t = .0f;
+			for (int c = 0; c < channels; c++) t += (points[i][c] - mean[c]) * axis[c];
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+		for (int c = 0; c < 4; c++) {
+			low[c] = std::clamp(mean[c] + axis[c] * minT, .0f, 255.f);
+			high[c] = std::clamp(mean[c] + axis[c] * maxT, .0f, 255.f);
+		}
+	}
+
+	static uint16_t to565(const float color[4]) {
+		const uint32_t r = static_cast<uint32_t>(color[0] * 31.f / 255.f + .5f);
+		const uint32_t g = static_cast<uint32_t>(color[1] * 63.f / 255.f + .5f);
+		const uint32_t b = static_cast<uint32_t>(color[2] * 31.f / 255.f + .5f);
+		return static_cast<uint16_t>(r << 11 | g << 5 | b);
+	}
+
+	static void from565(uint16_t packed, int color[3]) {
+		const int r = packed >> 11;
+		const int g = (packed >> 5) & 63;
+		const int b = packed & 31;
+		color[0] = r << 3 | r >> 2;
+		color[1] = g << 2 | g >> 4;
+		color[2] = b << 3 | b >> 2;
+	}
+
+	void BcEncoder::encodeBlock(BcFormat format, const uint8_t* texels, uint8_t* out) {
+		if (format == BcFormat::BC1) {
+			encodeBc1(texels, out);
+		}
+		else {
+			encodeBc7(texels, out);
+		}
+	}
+
+	void BcEncoder::encodeImageBlock(BcFormat format, const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, uint8_t* out) {
+		uint8_t texels[BLOCK_TEXELS * 4];
+		for (uint32_t y = 0; y < BLOCK_SIZE; y++) {
+			for (uint32_t x = 0; x < BLOCK_SIZE; x++) {
+				const uint32_t sx = std::min(bx * BLOCK_SIZE + x, width - 1);
+				const uint32_t sy = std::min(by * BLOCK_SIZE + y, height - 1);
+				std::memcpy(&texels[(y * BLOCK_SIZE + x) * 4], &rgba[(size_t{ sy } * width + sx) * 4], 4);
+			}
+		}
+		encodeBlock(format, texels, out);
+	}
+
+	void BcEncoder::encodeBc1(const uint8_t* texels, uint8_t* out) {
+		float points[BLOCK_TEXELS][4];
+		int opaqueCount = 0;
+		bool cutout = false;
+		for (int i = 0; i < BLOCK_TEXELS; i++) {
+			if (texels[i * 4 + 3] < ALPHA_CUTOFF) {
+				cutout = true;
+				continue;
+			}
+			for (int c = 0; c < 4; c++) points[opaqueCount][c] = texels[i * 4 + c];
+			opaqueCount++;
+		}
+
+		uint16_t color0 = 0;
+		uint16_t color1 = 0;
+		if (opaqueCount > 0) {
+			float low[4];
+			float high[4];
+			fitEndpoints(points, opaqueCount, 3, low, high);
+			color0 = to565(high);
+			color1 = to565(low);
+		}
+		// color0 > color1 picks the four color mode, otherwise it is three colors and transparent black
+		if (cutout ? color0 > color1 : color0 < color1) std::swap(color0, color1);
+
+		int palette[4][3];
+		from565(color0, palette[0]);
+		from565(color1, palette[1]);
+		const int paletteSize = color0 > color1 ? 4 : 3;
+		for (int c = 0; c < 3; c++) {
+			if (paletteSize == 4) {
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+			else {
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			}
+		}
+
+		uint32_t indices = 0;
+		for (int i = 0; i < BLOCK_TEXELS; i++) {
+			uint32_t best = 3;
+			if (texels[i * 4 + 3] >= ALPHA_CUTOFF) {
+				int bestError = INT32_MAX;
+				for (int p = 0; p < paletteSize; p++) {
+					int error = 0;
+					for (int c = 0; c < 3; c++) {
+						const int d = texels[i * 4 + c] - palette[p][c];
+						error += d * d;
+					}
+					if (error < bestError) {
+						bestError = error;
+						best = static_cast<uint32_t>(p);
+					}
+				}
+			}
+			indices |= best << (i * 2);
+		}
+
+		out[0] = static_cast<uint8_t>(color0);
+		out[1] = static_cast<uint8_t>(color0 >> 8);
+		out[2] = static_cast<uint8_t>(color1);
+		out[3] = static_cast<uint8_t>(color1 >> 8);
+		for (int i = 0; i < 4; i++) out[4 + i] = static_cast<uint8_t>(indices >> (i * 8));
+	}
+
+	// fills a bc7 block lsb first
+	struct BitWriter {
+		uint8_t* out;
+		uint32_t position = 0;
+
+		void write(uint32_t value, uint32_t bits) {
+			for (uint32_t i = 0; i < bits; i++, position++) {
+				if ((value >> i) & 1) out[position / 8] |= static_cast<uint8_t>(1u << (position % 8));
+			}
+		}
+	};
+
+	// 7 bits per channel plus a p bit shared by the endpoint's channels, whichever p bit lands closer
+	static void quantizeMode6Endpoint(const float color[4], uint32_t quantized[4], uint32_t& pBit) {
+		float bestError = -1.f;
+		for (uint32_t p = 0; p < 2; p++) {
+			uint32_t candidate[4];
+			float error = .0f;
+			for (int c = 0; c < 4; c++) {
+				candidate[c] = static_cast<uint32_t>(std::clamp(std::lround((color[c] - p) / 2.f), 0l, 127l));
+				const float d = static_cast<float>(candidate[c] << 1 | p) - color[c];
+				error += d * d;
+			}
+			if (bestError < .0f || error < bestError) {
+				bestError = error;
+				pBit = p;
+				std::memcpy(quantized, candidate, sizeof(candidate));
+			}
+		}
+	}
+
+	void BcEncoder::encodeBc7(const uint8_t* texels, uint8_t* out) {
+		static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		float points[BLOCK_TEXELS][4];
+		for (int i = 0; i < BLOCK_TEXELS; i++) {
+			for (int c = 0; c < 4; c++) points[i][c] = texels[i * 4 + c];
+		}
+		float low[4];
+		float high[4];
+		fitEndpoints(points, BLOCK_TEXELS, 4, low, high);
+
+		uint32_t endpoints[2][4];
+		uint32_t pBits[2];
+		quantizeMode6Endpoint(low, endpoints[0], pBits[0]);
+		quantizeMode6Endpoint(high, endpoints[1], pBits[1]);
+
+		int palette[16][4];
+		for (int c = 0; c < 4; c++) {
+			const int e0 = static_cast<int>(endpoints[0][c] << 1 | pBits[0]);
+			const int e1 = static_cast<int>(endpoints[1][c] << 1 | pBits[1]);
+			for (int i = 0; i < 16; i++) palette[i][c] = ((64 - weights[i]) * e0 + weights[i] * e1 + 32) >> 6;
+		}
+
+		uint32_t indices[BLOCK_TEXELS];
+		for (int i = 0; i < BLOCK_TEXELS; i++) {
+			int bestError = INT32_MAX;
+			for (uint32_t p = 0; p < 16; p++) {
+				int error = 0;
+				for (int c = 0; c < 4; c++) {
+					const int d = texels[i * 4 + c] - palette[p][c];
+					error += d * d;
+				}
+				if (error < bestError) {
+					bestError = error;
+					indices[i] = p;
+				}
+			}
+		}
+
+		// the first texel's index only has 3 bits, so its top bit has to be 0. swapping the endpoints mirrors the palette
+		if (indices[0] >= 8) {
+			std::swap(endpoints[0], endpoints[1]);
+			std::swap(pBits[0], pBits[1]);
+			for (uint32_t& index : indices) index = 15 - index;
+		}
+
+		std::memset(out, 0, 16);
+		BitWriter writer{ out };
+		writer.write(1u << 6, 7);
+		for (int c = 0; c < 4; c++) {
+			writer.write(endpoints[0][c], 7);
+			writer.write(endpoints[1][c], 7);
+		}
+		writer.write(pBits[0], 1);
+		writer.write(pBits[1], 1);
+		for (int i = 0; i < BLOCK_TEXELS; i++) writer.write(indices[i], i == 0 ? 3 : 4);
+	}
+}
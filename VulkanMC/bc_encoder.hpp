@@ -0,0 +1,38 @@
+#pragma once
+
+// std
+#include <cstdint>
+
+namespace vmc {
+	enum class BcFormat {
+		// 8 bytes a block, 565 endpoints and 2 bit indices. cutout texels use the three color mode's transparent index
+		BC1,
+		// 16 bytes a block, always mode 6: one rgba subset with 7 bit endpoints, a p bit each and 4 bit indices
+		BC7
+	};
+
+	// block compression on the cpu, one 4x4 block at a time so callers can spread the blocks over threads.
+	// endpoints come from the principal axis of the block's colors, which is fast and good enough for textures this
+	// small, an exhaustive search would take far longer for little gain
+	class BcEncoder {
+	public:
+		static constexpr uint32_t BLOCK_SIZE = 4;
+		// texels with less alpha are cut out
+		static constexpr uint8_t ALPHA_CUTOFF = 128;
+
+		static uint32_t blockBytes(BcFormat format) { return format == BcFormat::BC1 ? 8 : 16; }
+		// bytes of a whole image, partial blocks at the edges included
+		static uint64_t imageBytes(BcFormat format, uint32_t width, uint32_t height) {
+			return uint64_t{ blockBytes(format) } * ((width + 3) / 4) * ((height + 3) / 4);
+		}
+
+		// texels are 16 rgba8 values row by row, out gets blockBytes(format) bytes
+		static void encodeBlock(BcFormat format, const uint8_t* texels, uint8_t* out);
+		// the 4x4 block at bx, by of a tightly packed rgba8 image, texels past the edge repeat the last row or column
+		static void encodeImageBlock(BcFormat format, const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, uint8_t* out);
+
+	private:
+		static void encodeBc1(const uint8_t* texels, uint8_t* out);
+		static void encodeBc7(const uint8_t* texels, uint8_t* out);
+	};
+}
@@ -0,0 +1,91 @@
+#include "block_textures.hpp"
+
+#include <glm/glm.hpp>
+// std
+#include <cmath>
+
+namespace vmc {
+	// linear colors, what the blocks looked like before they had textures
+	static const glm::vec3 layerColors[TEXTURE_LAYER_COUNT] = {
+		{ 1.f, 1.f, 1.f },     // none
+		{ .5f, .5f, .5f },     // stone
+		{ .45f, .3f, .18f },   // dirt
+		{ .3f, .65f, .2f },    // grass top
+		{ .45f, .3f, .18f },   // grass side, grass along the top edge
+		{ .85f, .8f, .55f },   // sand
+		{ .15f, .3f, .8f },    // water
+		{ .2f, .2f, .2f },     // bedrock
+		{ 1.f, .85f, .45f },   // glowstone
+	};
+
+	// 0 to 1, the same for the same texel every time
+	static float texelNoise(uint32_t layer, uint32_t x, uint32_t y) {
+		uint32_t h = layer * 0x9e3779b1u ^ x * 0x85ebca6bu ^ y * 0xc2b2ae35u;
+		h ^= h >> 16;
+		h *= 0x7feb352du;
+		h ^= h >> 15;
+		h *= 0x846ca68bu;
+		h ^= h >> 16;
+		return static_cast<float>(h & 0xffff) / 65535.f;
+	}
+
+	static uint8_t toSrgb(float linear) {
+		linear = glm::clamp(linear, 0.f, 1.f);
+		const float srgb = linear <= .0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.f / 2.4f) - .055f;
+		return static_cast<uint8_t>(srgb * 255.f + .5f);
+	}
+
+	static glm::vec3 texel(uint32_t layer, uint32_t x, uint32_t y) {
+		const float noise = texelNoise(layer, x, y);
+		switch (layer) {
+		case TEXTURE_NONE:
+			return layerColors[layer];
+		case TEXTURE_GRASS_SIDE: {
+			// a ragged strip of grass hanging over the dirt
+			const uint32_t fringe = 2 + static_cast<uint32_t>(texelNoise(layer, x, 0) * 3.f);
+			const uint32_t base = y < fringe ? TEXTURE_GRASS_TOP : TEXTURE_DIRT;
+			return layerColors[base] * (.85f + .3f * noise);
+		}
+		case TEXTURE_WATER:
+			return layerColors[layer] * (.92f + .16f * noise);
+		case TEXTURE_BEDROCK:
+			return layerColors[layer] * (.4f + 1.2f * noise);
+		case TEXTURE_GLOWSTONE:
+			return layerColors[layer] * (noise < .25f ? .7f : 1.f);
+		default:
+			return layerColors[layer] * (.85f + .3f * noise);
+		}
+	}
+
+	uint32_t BlockTextures::layer(BlockId block, int axis, int side) {
+		switch (block) {
+		case BLOCK_STONE: return TEXTURE_STONE;
+		case BLOCK_DIRT: return TEXTURE_DIRT;
+		case BLOCK_GRASS:
+			if (axis != 1) return TEXTURE_GRASS_SIDE;
+			return side == 1 ? TEXTURE_GRASS_TOP : TEXTURE_DIRT;
+		case BLOCK_SAND: return TEXTURE_SAND;
+		case BLOCK_WATER: return TEXTURE_WATER;
+		case BLOCK_BEDROCK: return TEXTURE_BEDROCK;
+		case BLOCK_GLOWSTONE: return TEXTURE_GLOWSTONE;
+		default: return TEXTURE_NONE;
+		}
+	}
+
+	std::vector<uint8_t> BlockTextures::generate() {
+		std::vector<uint8_t> pixels;
+		pixels.reserve(size_t{ TEXTURE_LAYER_COUNT } * SIZE * SIZE * 4);
+		for (uint32_t layer = 0; layer < TEXTURE_LAYER_COUNT; layer++) {
+			for (uint32_t y = 0; y < SIZE; y++) {
+				for (uint32_t x = 0; x < SIZE; x++) {
+					const glm::vec3 color = texel(layer, x, y);
+					pixels.push_back(toSrgb(color.x));
+					pixels.push_back(toSrgb(color.y));
+					pixels.push_back(toSrgb(color.z));
+					pixels.push_back(255);
+				}
+			}
+		}
+		return pixels;
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "vmc_chunk.hpp"
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace vmc {
+	// layers of the block texture array. layer 0 is plain white, so geometry without a texture like the entity
+	// cubes keeps its vertex colors
+	enum BlockTextureLayer : uint32_t {
+		TEXTURE_NONE = 0,
+		TEXTURE_STONE,
+		TEXTURE_DIRT,
+		TEXTURE_GRASS_TOP,
+		TEXTURE_GRASS_SIDE,
+		TEXTURE_SAND,
+		TEXTURE_WATER,
+		TEXTURE_BEDROCK,
+		TEXTURE_GLOWSTONE,
+		TEXTURE_LAYER_COUNT
+	};
+
+	// the block textures, made up from a few colors and some noise since there are no image assets
+	class BlockTextures {
+	public:
+		// texels along each side of a layer
+		static constexpr uint32_t SIZE = 16;
+
+		// the layer a face of block is drawn with. axis is 0 to 2 for x, y and z, side 0 is the face towards -axis
+		static uint32_t layer(BlockId block, int axis, int side);
+		// rgba8 texels in srgb, TEXTURE_LAYER_COUNT layers of SIZE x SIZE one after the other
+		static std::vector<uint8_t> generate();
+	};
+}
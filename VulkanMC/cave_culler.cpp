@@ -0,0 +1,125 @@
+#include "cave_culler.hpp"
+
+namespace vmc {
+	static constexpr int faceOffsets[SectionConnectivity::FACE_COUNT][3] = {
+		{ -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 }
+	};
+
+	static int oppositeFace(int face) { return face ^ 1; }
+
+	SectionConnectivity SectionConnectivity::compute(const std::bitset<ChunkSection::VOLUME>& open) {
+		constexpr int N = ChunkSection::SIZE;
+		SectionConnectivity connectivity;
+		if (open.none()) return connectivity;
+		if (open.all()) return all();
+
+		std::bitset<ChunkSection::VOLUME> visited;
+		std::vector<int> stack;
+		stack.reserve(ChunkSection::VOLUME);
+		for (int start = 0; start < ChunkSection::VOLUME; start++) {
+			if (!open[start] || visited[start]) continue;
+
+			// every face this region of open blocks touches
+			int faces = 0;
+			visited[start] = true;
+			stack.push_back(start);
+			while (!stack.empty()) {
+				const int i = stack.back();
+				stack.pop_back();
+				const int x = i & 15;
+				const int y = i >> 8;
+				const int z = (i >> 4) & 15;
+				if (x == 0) faces |= 1 << 0;
+				if (x == N - 1) faces |= 1 << 1;
+				if (y == 0) faces |= 1 << 2;
+				if (y == N - 1) faces |= 1 << 3;
+				if (z == 0) faces |= 1 << 4;
+				if (z == N - 1) faces |= 1 << 5;
+
+				for (const auto& offset : faceOffsets) {
+					const int nx = x + offset[0];
+					const int ny = y + offset[1];
+					const int nz = z + offset[2];
+					if (nx < 0 || nx >= N || ny < 0 || ny >= N || nz < 0 || nz >= N) continue;
+					const int neighbour = ChunkSection::index(nx, ny, nz);
+					if (!open[neighbour] || visited[neighbour]) continue;
+					visited[neighbour] = true;
+					stack.push_back(neighbour);
+				}
+			}
+
+			for (int a = 0; a < FACE_COUNT; a++) {
+				if (!(faces & (1 << a))) continue;
+				for (int b = a; b < FACE_COUNT; b++) {
+					if (faces & (1 << b)) connectivity.connect(a, b);
+				}
+			}
+		}
+		return connectivity;
+	}
+
+	CaveCuller::CaveCuller(SectionPos origin, SectionPos size) : origin{ origin }, size{ size } {
+		const size_t count = static_cast<size_t>(size.x) * size.y * size.z;
+		connectivity.assign(count, SectionConnectivity::all());
+		visitedSearch.assign(count, 0);
+	}
+
+	bool CaveCuller::contains(SectionPos pos) const {
+		return pos.x >= origin.x && pos.x < origin.x + size.x && pos.y >= origin.y && pos.y < origin.y + size.y
+			&& pos.z >= origin.z && pos.z < origin.z + size.z;
+	}
+
+	uint32_t CaveCuller::indexOf(SectionPos pos) const {
+		return static_cast<uint32_t>(((pos.y - origin.y) * size.z + (pos.z - origin.z)) * size.x + (pos.x - origin.x));
+	}
+
+	void CaveCuller::setConnectivity(SectionPos pos, const SectionConnectivity& sectionConnectivity) {
+		if (contains(pos)) connectivity[indexOf(pos)] = sectionConnectivity;
+	}
+
+	bool CaveCuller::isReachable(SectionPos pos) const {
+		return contains(pos) && visitedSearch[indexOf(pos)] == searchNumber;
+	}
+
+	bool CaveCuller::search(const glm::vec3& cameraPos, const Frustum& frustum) {
+		constexpr int N = ChunkSection::SIZE;
+		const glm::ivec3 camera = glm::ivec3{ glm::floor(cameraPos / static_cast<float>(N)) };
+		const SectionPos start{ camera.x, camera.y, camera.z };
+		stats = {};
+		reached.clear();
+		if (!contains(start)) return false;
+
+		searchNumber++;
+		queue.clear();
+		queue.push_back({ indexOf(start), SectionConnectivity::FACE_COUNT, 0 });
+		visitedSearch[indexOf(start)] = searchNumber;
+		reached.push_back(start);
+
+		// the queue only grows, so the front is just an index
+		for (size_t front = 0; front < queue.size(); front++) {
+			const Node node = queue[front];
+			const SectionPos pos = reached[front];
+			const SectionConnectivity& sectionConnectivity = connectivity[node.index];
+
+			for (int face = 0; face < SectionConnectivity::FACE_COUNT; face++) {
+				if (node.directions & (1 << oppositeFace(face))) continue;
+				if (node.entered != SectionConnectivity::FACE_COUNT && !sectionConnectivity.connects(node.entered, face)) continue;
+
+				const SectionPos next{ pos.x + faceOffsets[face][0], pos.y + faceOffsets[face][1], pos.z + faceOffsets[face][2] };
+				if (!contains(next)) continue;
+				const uint32_t nextIndex = indexOf(next);
+				if (visitedSearch[nextIndex] == searchNumber) continue;
+
+				const glm::vec3 min{ static_cast<float>(next.x * N), static_cast<float>(next.y * N), static_cast<float>(next.z * N) };
+				if (!frustum.intersects({ min, min + static_cast<float>(N) })) continue;
+
+				visitedSearch[nextIndex] = searchNumber;
+				queue.push_back({ nextIndex, static_cast<uint8_t>(oppositeFace(face)), static_cast<uint8_t>(node.directions | (1 << face)) });
+				reached.push_back(next);
+			}
+		}
+
+		stats.reached = static_cast<uint32_t>(reached.size());
+		return true;
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "vmc_chunk.hpp"
+#include "vmc_frustum.hpp"
+
+// std
+#include <bitset>
+#include <cstdint>
+#include <vector>
+
+namespace vmc {
+	// which faces of a section can be seen from which others through its open (non solid) blocks. faces are in the
+	// order -x, +x, -y, +y, -z, +z like everywhere else in the mesher
+	struct SectionConnectivity {
+		static constexpr int FACE_COUNT = 6;
+
+		// bit from * 6 + to, always symmetric
+		uint64_t bits = 0;
+
+		static SectionConnectivity all() { return { (uint64_t{ 1 } << (FACE_COUNT * FACE_COUNT)) - 1 }; }
+		// flood fills the open blocks, every face a connected region of them touches can see every other one of those
+		static SectionConnectivity compute(const std::bitset<ChunkSection::VOLUME>& open);
+
+		bool connects(int from, int to) const { return (bits >> (from * FACE_COUNT + to)) & 1; }
+		void connect(int a, int b) { bits |= (uint64_t{ 1 } << (a * FACE_COUNT + b)) | (uint64_t{ 1 } << (b * FACE_COUNT + a)); }
+	};
+
+	struct CaveCullStats {
+		// sections the search walked through, meshed or not
+		uint32_t reached = 0;
+		// meshed sections that were in the frustum but couldn't be reached, counted by whoever draws them
+		uint32_t culled = 0;
+	};
+
+	// skips sections that can't be seen from the camera's section, e.g. the cave system under the player. every frame
+	// a breadth first search starts at the camera and steps into a neighbour only when the face it came in through
+	// connects to the face it leaves by, the neighbour is inside the frustum and the step doesn't go back against
+	// a direction the path already took. sections nobody reported connectivity for are treated as open
+	class CaveCuller {
+	public:
+		// covers size sections starting at origin, the search never leaves that box
+		CaveCuller(SectionPos origin, SectionPos size);
+
+		void setConnectivity(SectionPos pos, const SectionConnectivity& connectivity);
+
+		// returns false when the camera is outside of the box, nothing is culled then
+		bool search(const glm::vec3& cameraPos, const Frustum& frustum);
+		// only valid after a successful search
+		bool isReachable(SectionPos pos) const;
+		const std::vector<SectionPos>& getReached() const { return reached; }
+		const CaveCullStats& getStats() const { return stats; }
+
+	private:
+		struct Node {
+			uint32_t index;
+			// the face the section was entered through, FACE_COUNT for the camera's section
+			uint8_t entered;
+			// a bit for every face a step of the path so far went out through
+			uint8_t directions;
+		};
+
+		bool contains(SectionPos pos) const;
+		uint32_t indexOf(SectionPos pos) const;
+
+		SectionPos origin;
+		SectionPos size;
+		std::vector<SectionConnectivity> connectivity;
+		// the search that last reached each section, so nothing has to be cleared between frames
+		std::vector<uint32_t> visitedSearch;
+		uint32_t searchNumber = 0;
+		std::vector<Node> queue;
+		std::vector<SectionPos> reached;
+		CaveCullStats stats;
+	};
+}
@@ -0,0 +1,295 @@
+#include "chunk_mesher.hpp"
+#include "block_textures.hpp"
+
+// std
+#include <algorithm>
+#include <bitset>
+
+namespace vmc {
+	// fake directional lighting so neighbouring faces can be told apart, in the order -x, +x, -y, +y, -z, +z
+	static const float faceShade[6] = { .8f, .8f, .5f, 1.f, .65f, .65f };
+
+	// how bright a face lit at each level looks, a little ambient light keeps pitch black caves readable
+	static float lightBrightness(int level) {
+		const float f = static_cast<float>(level) / MAX_LIGHT;
+		return .08f + .92f * f / (4.f - 3.f * f);
+	}
+
+	static bool isFaceVisible(BlockId block, BlockId neighbour) {
+		return block != BLOCK_AIR && !isSolidBlock(neighbour) && block != neighbour;
+	}
+
+	// picks the block that stands in for a cell of size^3 blocks, read through get(x, y, z)
+	template<typename F>
+	static BlockId downsampleCell(F&& get, int x0, int y0, int z0, int size) {
+		int solid = 0;
+		int water = 0;
+		BlockId top = BLOCK_AIR;
+		for (int y = y0 + size - 1; y >= y0; y--) {
+			for (int z = z0; z < z0 + size; z++) {
+				for (int x = x0; x < x0 + size; x++) {
+					const BlockId block = get(x, y, z);
+					if (isSolidBlock(block)) {
+						if (solid == 0) top = block;
+						solid++;
+					}
+					else if (block == BLOCK_WATER) {
+						water++;
+					}
+				}
+			}
+		}
+
+		const int half = size * size * size / 2;
+		if (solid >= half) return top;
+		if (solid + water >= half && water > 0) return BLOCK_WATER;
+		return BLOCK_AIR;
+	}
+
+	void ChunkMesher::gather(const VmcWorld& world, SectionPos pos, MeshInput& input, const LodInfo& lod) {
+		constexpr int N = ChunkSection::SIZE;
+		input.pos = pos;
+		input.lod = lod.level;
+		const int scale = 1 << lod.level;
+		const int cells = input.cells();
+
+		// the 3x3 columns around the section, so the border doesn't need a hash lookup per block
+		const Chunk* columns[3][3];
+		for (int dz = -1; dz <= 1; dz++) {
+			for (int dx = -1; dx <= 1; dx++) {
+				columns[dz + 1][dx + 1] = world.getChunk({ pos.x + dx, pos.z + dz });
+			}
+		}
+
+		const Chunk* center = columns[1][1];
+		std::array<BlockId, ChunkSection::VOLUME> blocks;
+		const bool hasCenter = center != nullptr && pos.y >= 0 && pos.y < Chunk::SECTION_COUNT;
+		if (hasCenter) {
+			center->getSection(pos.y).unpack(blocks.data());
+		}
+		else {
+			input.blocks.fill(BLOCK_AIR);
+		}
+		input.light.fill(static_cast<uint8_t>(MAX_LIGHT << 4));
+
+		if (hasCenter && scale == 1) {
+			const SectionLight& light = center->getLight(pos.y);
+			for (int y = 0; y < N; y++) {
+				for (int z = 0; z < N; z++) {
+					std::copy_n(&blocks[ChunkSection::index(0, y, z)], N, &input.blocks[MeshInput::index(0, y, z)]);
+					for (int x = 0; x < N; x++) {
+						const int i = ChunkSection::index(x, y, z);
+						input.light[MeshInput::index(x, y, z)] = static_cast<uint8_t>((light.sky.get(i) << 4) | light.block.get(i));
+					}
+				}
+			}
+		}
+		else if (hasCenter) {
+			auto get = [&](int x, int y, int z) { return blocks[ChunkSection::index(x, y, z)]; };
+			for (int y = 0; y < cells; y++) {
+				for (int z = 0; z < cells; z++) {
+					for (int x = 0; x < cells; x++) {
+						input.blocks[MeshInput::index(x, y, z)] = downsampleCell(get, x * scale, y * scale, z * scale, scale);
+					}
+				}
+			}
+		}
+
+		// x, y, z in blocks relative to the section and allowed to run one cell past it on every side
+		auto getWorld = [&](int x, int y, int z) -> BlockId {
+			const int cx = x < 0 ? 0 : (x >= N ? 2 : 1);
+			const int cz = z < 0 ? 0 : (z >= N ? 2 : 1);
+			const Chunk* chunk = columns[cz][cx];
+			if (chunk == nullptr) return BLOCK_AIR;
+			return chunk->getBlock(x & (N - 1), pos.y * N + y, z & (N - 1));
+		};
+		auto getWorldLight = [&](int x, int y, int z) -> uint8_t {
+			const Chunk* chunk = columns[z < 0 ? 0 : (z >= N ? 2 : 1)][x < 0 ? 0 : (x >= N ? 2 : 1)];
+			if (chunk == nullptr) return static_cast<uint8_t>(MAX_LIGHT << 4);
+			const int worldY = pos.y * N + y;
+			return static_cast<uint8_t>((chunk->getSkyLight(x & (N - 1), worldY, z & (N - 1)) << 4) | chunk->getBlockLight(x & (N - 1), worldY, z & (N - 1)));
+		};
+
+		for (int y = -1; y <= cells; y++) {
+			for (int z = -1; z <= cells; z++) {
+				for (int x = -1; x <= cells; x++) {
+					const bool border = x < 0 || x >= cells || y < 0 || y >= cells || z < 0 || z >= cells;
+					if (!border) continue;
+
+					// leave the border empty towards a column meshed at another level so the faces there become a skirt
+					const int side = x < 0 ? 0 : (x >= cells ? 1 : (z < 0 ? 2 : (z >= cells ? 3 : -1)));
+					if (side >= 0 && lod.neighbours[side] != lod.level) {
+						input.blocks[MeshInput::index(x, y, z)] = BLOCK_AIR;
+						continue;
+					}
+
+					if (scale == 1) {
+						input.blocks[MeshInput::index(x, y, z)] = getWorld(x, y, z);
+						input.light[MeshInput::index(x, y, z)] = getWorldLight(x, y, z);
+					}
+					else {
+						input.blocks[MeshInput::index(x, y, z)] = downsampleCell(getWorld, x * scale, y * scale, z * scale, scale);
+					}
+				}
+			}
+		}
+	}
+
+	// packs the occlusion of the four corners of a face, in the order (-u, -v), (+u, -v), (+u, +v), (-u, +v) with 2 bits
+	// each. front is the block in front of the face, a corner is darker for each solid block touching it there and
+	// fully dark when both sides are solid, whatever the block between them
+	static uint32_t faceOcclusion(const MeshInput& input, const int front[3], int u, int v) {
+		static const int corners[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+		auto solid = [&](int du, int dv) {
+			int p[3] = { front[0], front[1], front[2] };
+			p[u] += du;
+			p[v] += dv;
+			return isSolidBlock(input.get(p[0], p[1], p[2])) ? 1 : 0;
+		};
+
+		uint32_t packed = 0;
+		for (int k = 0; k < 4; k++) {
+			const int sideU = solid(corners[k][0], 0);
+			const int sideV = solid(0, corners[k][1]);
+			const int level = sideU && sideV ? 0 : 3 - sideU - sideV - solid(corners[k][0], corners[k][1]);
+			packed |= static_cast<uint32_t>(level) << (k * 2);
+		}
+		return packed;
+	}
+
+	void ChunkMesher::mesh(const MeshInput& input, ChunkMeshData& out, bool ambientOcclusion) {
+		constexpr int MAX_CELLS = ChunkSection::SIZE;
+		const int N = input.cells();
+		const float scale = static_cast<float>(1 << input.lod);
+		out.pos = input.pos;
+		out.lod = input.lod;
+		out.vertices.clear();
+		out.indices.clear();
+
+		const glm::vec3 origin{ static_cast<float>(input.pos.x * MAX_CELLS), static_cast<float>(input.pos.y * MAX_CELLS), static_cast<float>(input.pos.z * MAX_CELLS) };
+		// the block in the low 16 bits, the light in front of the face in the next 4 and the corner occlusion in the
+		// 8 above those. 0 where there is no face
+		std::array<uint32_t, MAX_CELLS * MAX_CELLS> mask;
+		const uint32_t openCorners = 0xffu << 20;
+
+		for (int axis = 0; axis < 3; axis++) {
+			const int u = (axis + 1) % 3;
+			const int v = (axis + 2) % 3;
+
+			for (int side = 0; side < 2; side++) {
+				const int dir = side == 0 ? -1 : 1;
+				const float shade = faceShade[axis * 2 + side];
+
+				for (int slice = 0; slice < N; slice++) {
+					// every face in this slice that is not hidden by the block in front of it
+					int p[3];
+					for (int j = 0; j < N; j++) {
+						for (int i = 0; i < N; i++) {
+							p[axis] = slice;
+							p[u] = i;
+							p[v] = j;
+							const BlockId block = input.get(p[0], p[1], p[2]);
+							p[axis] += dir;
+							const BlockId neighbour = input.get(p[0], p[1], p[2]);
+							if (!isFaceVisible(block, neighbour)) {
+								mask[j * N + i] = 0;
+								continue;
+							}
+							const uint32_t occlusion = ambientOcclusion ? faceOcclusion(input, p, u, v) << 20 : openCorners;
+							mask[j * N + i] = block | (uint32_t{ input.getLight(p[0], p[1], p[2]) } << 16) | occlusion;
+						}
+					}
+
+					// grow each unvisited face as far as possible along u, then along v while whole rows still match
+					for (int j = 0; j < N; j++) {
+						for (int i = 0; i < N;) {
+							const uint32_t face = mask[j * N + i];
+							if (face == 0) {
+								i++;
+								continue;
+							}
+
+							// the corners of a merged quad are interpolated across all of it, so only faces with the same
+							// occlusion in every corner can be merged without stretching the shadows
+							const uint32_t occlusion = (face >> 20) & 0xff;
+							const bool mergeable = occlusion == 0x00 || occlusion == 0x55 || occlusion == 0xaa || occlusion == 0xff;
+							int w = 1;
+							while (mergeable && i + w < N && mask[j * N + i + w] == face) w++;
+
+							int h = 1;
+							for (; mergeable && j + h < N; h++) {
+								bool rowMatches = true;
+								for (int k = 0; k < w; k++) {
+									if (mask[(j + h) * N + i + k] != face) {
+										rowMatches = false;
+										break;
+									}
+								}
+								if (!rowMatches) break;
+							}
+
+							glm::vec3 base{ 0.f };
+							base[axis] = static_cast<float>(slice + side) * scale;
+							base[u] = static_cast<float>(i) * scale;
+							base[v] = static_cast<float>(j) * scale;
+							glm::vec3 du{ 0.f };
+							du[u] = static_cast<float>(w) * scale;
+							glm::vec3 dv{ 0.f };
+							dv[v] = static_cast<float>(h) * scale;
+
+							// the block's look comes from its texture, the vertices only carry how lit the face is
+							const glm::vec3 faceColor{ shade * lightBrightness(static_cast<int>((face >> 16) & 15)) };
+							const uint32_t layer = BlockTextures::layer(static_cast<BlockId>(face & 0xffff), axis, side);
+							uint32_t corners[4];
+							for (int k = 0; k < 4; k++) corners[k] = (occlusion >> (k * 2)) & 3;
+							const uint32_t first = static_cast<uint32_t>(out.vertices.size());
+							out.vertices.push_back({ origin + base, faceColor, corners[0], layer });
+							out.vertices.push_back({ origin + base + du, faceColor, corners[1], layer });
+							out.vertices.push_back({ origin + base + du + dv, faceColor, corners[2], layer });
+							out.vertices.push_back({ origin + base + dv, faceColor, corners[3], layer });
+
+							// split along the brighter diagonal, otherwise a single dark corner bleeds across half the quad
+							const uint32_t a = corners[0] + corners[2] >= corners[1] + corners[3] ? first : first + 1;
+							const uint32_t b = a == first ? first + 1 : first + 2;
+							const uint32_t c = a == first ? first + 2 : first + 3;
+							const uint32_t d = a == first ? first + 3 : first;
+							// keep the winding counter clockwise when seen from the side the face points towards
+							if (side == 1) {
+								out.indices.insert(out.indices.end(), { a, b, c, a, c, d });
+							}
+							else {
+								out.indices.insert(out.indices.end(), { a, c, b, a, d, c });
+							}
+
+							for (int dy = 0; dy < h; dy++) {
+								std::fill_n(&mask[(j + dy) * N + i], w, 0u);
+							}
+							i += w;
+						}
+					}
+				}
+			}
+		}
+
+		out.connectivity = SectionConnectivity::all();
+		if (input.lod == 0) {
+			std::bitset<ChunkSection::VOLUME> open;
+			for (int y = 0; y < MAX_CELLS; y++) {
+				for (int z = 0; z < MAX_CELLS; z++) {
+					for (int x = 0; x < MAX_CELLS; x++) {
+						open[ChunkSection::index(x, y, z)] = !isSolidBlock(input.get(x, y, z));
+					}
+				}
+			}
+			out.connectivity = SectionConnectivity::compute(open);
+		}
+
+		if (!out.vertices.empty()) {
+			out.bounds.min = out.bounds.max = out.vertices[0].position;
+			for (const VmcModel::Vertex& vertex : out.vertices) {
+				out.bounds.min = glm::min(out.bounds.min, vertex.position);
+				out.bounds.max = glm::max(out.bounds.max, vertex.position);
+			}
+		}
+	}
+}
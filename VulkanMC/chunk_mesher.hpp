@@ -0,0 +1,111 @@
+#pragma once
+
+#include "cave_culler.hpp"
+#include "vmc_mesh_arena.hpp"
+#include "vmc_model.hpp"
+#include "vmc_world.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace vmc {
+	// each level halves the mesh resolution, lod 1 meshes every 2x2x2 blocks as a single cell and lod 3 every 8x8x8
+	static constexpr int MAX_LOD = 3;
+
+	struct LodInfo {
+		int level = 0;
+		// levels of the columns at -x, +x, -z and +z. faces towards a column with a different level are always
+		// emitted, so the two meshes are both closed off at the seam and there is never a crack to see through
+		std::array<int, 4> neighbours{};
+	};
+
+	// the blocks of one section plus a one block border taken from the neighbouring sections, so that faces on
+	// the edge of a section can be culled against whatever is on the other side
+	struct MeshInput {
+		static constexpr int SIZE = ChunkSection::SIZE + 2;
+		static constexpr int VOLUME = SIZE * SIZE * SIZE;
+
+		SectionPos pos{};
+		int lod = 0;
+		std::array<BlockId, VOLUME> blocks{};
+		// sky light in the high nibble and block light in the low one. only gathered at lod 0, lower levels are
+		// lit as if they were out in the open
+		std::array<uint8_t, VOLUME> light{};
+
+		// cells per side, the layout keeps the lod 0 stride so lower levels just use the start of each row
+		int cells() const { return ChunkSection::SIZE >> lod; }
+
+		// x, y, z are section local cells and may be -1 or cells() to read the border
+		static int index(int x, int y, int z) { return ((y + 1) * SIZE + (z + 1)) * SIZE + (x + 1); }
+		BlockId get(int x, int y, int z) const { return blocks[index(x, y, z)]; }
+		// the brighter of the two
+		uint8_t getLight(int x, int y, int z) const {
+			const uint8_t packed = light[index(x, y, z)];
+			return std::max<uint8_t>(packed >> 4, packed & 15);
+		}
+	};
+
+	struct ChunkMeshData {
+		SectionPos pos{};
+		int lod = 0;
+		std::vector<VmcModel::Vertex> vertices;
+		std::vector<uint32_t> indices;
+		// world space, tighter than the section itself whenever the surface doesn't fill it
+		Aabb bounds{};
+		// set even when there is nothing to draw, a solid section is what blocks the view. lower lods may close
+		// up passages when downsampling, so they always count as open
+		SectionConnectivity connectivity = SectionConnectivity::all();
+
+		bool empty() const { return indices.empty(); }
+	};
+
+	struct MeshStats {
+		uint64_t sections = 0;
+		uint64_t quads = 0;
+		uint64_t vertices = 0;
+		uint64_t triangles = 0;
+		// what createCubeModel style meshing (36 vertices per block, no culling) would have produced
+		uint64_t naiveVertices = 0;
+		std::array<uint64_t, MAX_LOD + 1> sectionsPerLod{};
+		std::array<uint64_t, MAX_LOD + 1> verticesPerLod{};
+		std::array<uint64_t, MAX_LOD + 1> trianglesPerLod{};
+
+		void add(const ChunkMeshData& mesh, uint32_t solidBlocks) {
+			sections++;
+			quads += mesh.indices.size() / 6;
+			vertices += mesh.vertices.size();
+			triangles += mesh.indices.size() / 3;
+			naiveVertices += uint64_t{ 36 } * solidBlocks;
+			sectionsPerLod[mesh.lod]++;
+			verticesPerLod[mesh.lod] += mesh.vertices.size();
+			trianglesPerLod[mesh.lod] += mesh.indices.size() / 3;
+		}
+	};
+
+	// a section mesh that has been uploaded into the mesh arena
+	struct SectionMesh {
+		SectionPos pos{};
+		MeshAllocation mesh{};
+		Aabb bounds{};
+		// where the section is stored for gpu culling, if that is in use
+		uint32_t cullSlot = UINT32_MAX;
+	};
+
+	// turns sections into indexed triangle meshes. faces between two solid blocks are never emitted, and the
+	// remaining faces are greedily merged into the largest rectangles of the same block type and light per slice.
+	// a face is as bright as the light in the block in front of it
+	class ChunkMesher {
+	public:
+		// copies a section and its border out of the world, unloaded neighbours read as air in full sky light. above lod 0 every cell
+		// is reduced to a single block: solid when at least half of it is solid, using the highest solid block so
+		// grass stays on top, otherwise water when at least half is water or water and solid
+		static void gather(const VmcWorld& world, SectionPos pos, MeshInput& input, const LodInfo& lod = LodInfo{});
+		// also works out which faces of the section connect for cave culling. with ambient occlusion every quad
+		// corner is darkened by the blocks around it, faces only merge when all their corners agree
+		static void mesh(const MeshInput& input, ChunkMeshData& out, bool ambientOcclusion = true);
+	};
+}
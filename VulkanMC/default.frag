@@ -1,15 +1,29 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout (location = 0) out vec4 outColor;
 layout (location = 0) in vec3 fragColor;
+layout (location = 1) flat in uint fragTextureLayer;
+layout (location = 2) in vec3 fragPosition;
 
-layout(push_constant) uniform Push {
-	mat4 transform;
-	vec3 color;
-} push;
-
+// every texture, bound once per pass. set 0 is the camera
+layout(set = 1, binding = 0) uniform sampler2DArray textures[];
 
+// slot of the block texture array, App::BLOCK_TEXTURE_SLOT
+const uint BLOCK_TEXTURES = 0u;
 
 void main() {
-  outColor = vec4(fragColor, 1.0);
-} 
\ No newline at end of file
+	// faces are flat, so the screen space derivatives of the position give their normal and the two axes along
+	// the face are the texture coordinates. one block is one tile, a greedy quad just repeats it
+	vec3 normal = abs(cross(dFdx(fragPosition), dFdy(fragPosition)));
+	vec2 uv;
+	if (normal.y >= normal.x && normal.y >= normal.z) {
+		uv = fragPosition.xz;
+	}
+	else {
+		// side faces stand upright, texture rows run down
+		uv = vec2(normal.x > normal.z ? fragPosition.z : fragPosition.x, -fragPosition.y);
+	}
+	vec3 albedo = texture(textures[BLOCK_TEXTURES], vec3(uv, float(fragTextureLayer))).rgb;
+	outColor = vec4(fragColor * albedo, 1.0);
+}
@@ -2,20 +2,30 @@
 
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 color;
+layout(location = 2) in uint ambientOcclusion;
+layout(location = 3) in uint textureLayer;
 layout(location = 0) out vec3 fragColor;
+layout(location = 1) flat out uint fragTextureLayer;
+// world space, the fragment shader works out texture coordinates from it
+layout(location = 2) out vec3 fragPosition;
 
-layout(push_constant) uniform Push {
+// from the frame ring, bound with a dynamic offset
+layout(set = 0, binding = 0) uniform Camera {
 	vec4 quaternion;
 	vec4 translate;
 	mat4 projectionMatrix;
-	vec3 color;
-} push;
+} camera;
+
+// how much light reaches a corner with 0 to 3 open blocks around it
+const float occlusionCurve[4] = float[](0.45, 0.65, 0.82, 1.0);
 
 vec3 qrot(vec4 q, vec3 v) 
 { 
     return v + 2.0*cross(q.xyz, cross(q.xyz,v) + q.w*v);
 }
 void main() {
-  gl_Position = push.projectionMatrix * vec4(push.translate.w * qrot(push.quaternion, position) + push.translate.xyz, 1.0);
-	fragColor = color;
+  gl_Position = camera.projectionMatrix * vec4(camera.translate.w * qrot(camera.quaternion, position) + camera.translate.xyz, 1.0);
+	fragColor = color * occlusionCurve[min(ambientOcclusion, 3u)];
+	fragTextureLayer = textureLayer;
+	fragPosition = position;
 } 
\ No newline at end of file
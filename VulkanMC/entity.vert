@@ -0,0 +1,33 @@
+#version 450
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in uint ambientOcclusion;
+layout(location = 3) in uint textureLayer;
+// per instance, laid out like VmcModel::Instance
+layout(location = 4) in vec4 instanceQuaternion;
+layout(location = 5) in vec4 instanceTranslate;
+layout(location = 6) in vec4 instanceColor;
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) flat out uint fragTextureLayer;
+layout(location = 2) out vec3 fragPosition;
+
+// from the frame ring, only the projection is used since the instances are relative to the camera
+layout(set = 0, binding = 0) uniform Camera {
+	vec4 quaternion;
+	vec4 translate;
+	mat4 projectionMatrix;
+} camera;
+
+const float occlusionCurve[4] = float[](0.45, 0.65, 0.82, 1.0);
+
+vec3 qrot(vec4 q, vec3 v)
+{
+	return v + 2.0*cross(q.xyz, cross(q.xyz,v) + q.w*v);
+}
+void main() {
+	gl_Position = camera.projectionMatrix * vec4(instanceTranslate.w * qrot(instanceQuaternion, position) + instanceTranslate.xyz, 1.0);
+	fragColor = color * instanceColor.rgb * occlusionCurve[min(ambientOcclusion, 3u)];
+	fragTextureLayer = textureLayer;
+	fragPosition = position;
+}
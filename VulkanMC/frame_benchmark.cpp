@@ -0,0 +1,88 @@
+#include "frame_benchmark.hpp"
+
+#include <glm/gtc/constants.hpp>
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+
+namespace vmc {
+	void FrameBenchmark::setCameraView(VmcCamera& camera, const glm::vec3& position, float scale) const {
+		// the flip around x after a turn of yaw around y, (1, 0, 0, 0) * (0, sin(yaw / 2), 0, cos(yaw / 2))
+		const float yaw = glm::two_pi<float>() * getFrame() / std::max(frameCount, 1u);
+		const glm::vec4 quaternion{ std::cos(yaw / 2.f), .0f, std::sin(yaw / 2.f), .0f };
+		// the camera ends up at the origin of view space
+		camera.setViewTransform(quaternion, glm::vec4{ -scale * VmcCamera::rotate(quaternion, position), scale });
+	}
+
+	static double percentile(const std::vector<double>& sorted, double p) {
+		const size_t index = static_cast<size_t>(std::ceil(p * sorted.size()));
+		return sorted[std::min(sorted.size() - 1, index == 0 ? 0 : index - 1)];
+	}
+
+	FrameTimeSummary FrameBenchmark::summarize(std::vector<double> ms) {
+		FrameTimeSummary summary;
+		if (ms.empty()) return summary;
+		std::sort(ms.begin(), ms.end());
+		summary.frames = ms.size();
+		summary.averageMs = std::accumulate(ms.begin(), ms.end(), 0.0) / ms.size();
+		summary.minMs = ms.front();
+		summary.maxMs = ms.back();
+		summary.p50Ms = percentile(ms, .5);
+		summary.p95Ms = percentile(ms, .95);
+		summary.p99Ms = percentile(ms, .99);
+		return summary;
+	}
+
+	static std::string jsonString(const std::string& value) {
+		std::string escaped = "\"";
+		for (char c : value) {
+			if (c == '"' || c == '\\') escaped += '\\';
+			if (static_cast<unsigned char>(c) < 0x20) continue;
+			escaped += c;
+		}
+		return escaped + "\"";
+	}
+
+	static void writeSummary(std::ostream& out, const FrameTimeSummary& summary) {
+		out << "{ \"frames\": " << summary.frames << ", \"avg_ms\": " << summary.averageMs << ", \"min_ms\": " << summary.minMs << ", \"max_ms\": "
+			<< summary.maxMs << ", \"p50_ms\": " << summary.p50Ms << ", \"p95_ms\": " << summary.p95Ms << ", \"p99_ms\": " << summary.p99Ms << " }";
+	}
+
+	std::string FrameBenchmark::toJson(const BenchmarkInfo& info) const {
+		const FrameTimeSummary cpu = summarize(cpuFrameMs);
+		const FrameTimeSummary gpu = summarize(gpuFrameMs);
+		std::ostringstream out;
+		out << "{\n";
+		out << "\t\"device\": " << jsonString(info.device) << ",\n";
+		out << "\t\"width\": " << info.width << ",\n";
+		out << "\t\"height\": " << info.height << ",\n";
+		out << "\t\"headless\": " << (info.headless ? "true" : "false") << ",\n";
+		out << "\t\"culling\": " << jsonString(info.culling) << ",\n";
+		out << "\t\"warmup_ms\": " << info.warmupMs << ",\n";
+		out << "\t\"requested_frames\": " << frameCount << ",\n";
+		out << "\t\"frames\": " << cpu.frames << ",\n";
+		out << "\t\"fps\": " << (cpu.averageMs > 0.0 ? 1000.0 / cpu.averageMs : 0.0) << ",\n";
+		out << "\t\"cpu\": ";
+		writeSummary(out, cpu);
+		out << ",\n\t\"gpu\": ";
+		if (gpu.frames == 0) {
+			out << "null";
+		}
+		else {
+			writeSummary(out, gpu);
+		}
+		out << "\n}\n";
+		return out.str();
+	}
+
+	bool FrameBenchmark::writeJson(const std::string& path, const BenchmarkInfo& info) const {
+		std::ofstream file(path, std::ios::trunc);
+		if (!file.is_open()) return false;
+		file << toJson(info);
+		return static_cast<bool>(file);
+	}
+}
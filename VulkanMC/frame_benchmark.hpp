@@ -0,0 +1,67 @@
+#pragma once
+
+#include "vmc_camera.hpp"
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vmc {
+	struct FrameTimeSummary {
+		size_t frames = 0;
+		double averageMs = 0.0;
+		double minMs = 0.0;
+		double maxMs = 0.0;
+		double p50Ms = 0.0;
+		double p95Ms = 0.0;
+		double p99Ms = 0.0;
+	};
+
+	// how the run was set up, written next to its results
+	struct BenchmarkInfo {
+		std::string device;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		bool headless = false;
+		// "gpu" or "cpu" section culling
+		std::string culling;
+		// from startup until the world was lit, meshed and uploaded and the timed frames began
+		double warmupMs = 0.0;
+	};
+
+	// a fixed number of frames along the same camera path every run, so runs on different machines and builds can be
+	// compared. the camera turns once around where it stands, yaw only, so it never crosses into another chunk and
+	// nothing is remeshed for a new lod while frames are timed
+	class FrameBenchmark {
+	public:
+		explicit FrameBenchmark(uint32_t frameCount) : frameCount{ frameCount } {}
+
+		// points the camera at position the way it faces on the current frame, scale is the world scale. same
+		// convention as App, the world is rotated 180 degrees around x to go from y up to y down
+		void setCameraView(VmcCamera& camera, const glm::vec3& position, float scale) const;
+
+		// wall time of a whole frame on the main thread, waits on the gpu included
+		void addCpuFrame(double ms) { cpuFrameMs.push_back(ms); }
+		// arrives a couple of frames after its cpu frame, once that frame's fence has been waited on
+		void addGpuFrame(double ms) { gpuFrameMs.push_back(ms); }
+
+		uint32_t getFrame() const { return static_cast<uint32_t>(cpuFrameMs.size()); }
+		uint32_t getFrameCount() const { return frameCount; }
+		bool isDone() const { return getFrame() >= frameCount; }
+		const std::vector<double>& getCpuFrames() const { return cpuFrameMs; }
+		const std::vector<double>& getGpuFrames() const { return gpuFrameMs; }
+
+		static FrameTimeSummary summarize(std::vector<double> ms);
+		// frames is how many were measured, which is less than requested_frames when the window was closed early. gpu is
+		// null when there were no timestamps
+		std::string toJson(const BenchmarkInfo& info) const;
+		// false when the file can't be written
+		bool writeJson(const std::string& path, const BenchmarkInfo& info) const;
+
+	private:
+		uint32_t frameCount;
+		std::vector<double> cpuFrameMs;
+		std::vector<double> gpuFrameMs;
+	};
+}
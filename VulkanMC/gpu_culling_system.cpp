@@ -0,0 +1,389 @@
+#include "gpu_culling_system.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace vmc {
+	// matches Cull in cull_sections.comp, std140
+	struct CullUniforms {
+		glm::vec4 planes[6];
+		glm::mat4 occluderViewProjection[2];
+		glm::mat4 occluderProjection[2];
+		glm::vec2 pyramidSize;
+		uint32_t pyramidLevels;
+		uint32_t occlusion;
+		uint32_t sectionSlots;
+		uint32_t entityCount;
+		uint32_t caveCulling;
+	};
+
+	struct CullPushConstants {
+		uint32_t phase;
+	};
+
+	// sections, draws, counts, uniforms, pyramid, occluded flags, entities, entity draws, reachable slots, entity instances
+	static constexpr uint32_t BINDING_COUNT = 10;
+	static constexpr uint32_t PYRAMID_BINDING = 4;
+
+	static VkDescriptorType bindingType(uint32_t binding) {
+		if (binding == 3) return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		if (binding == PYRAMID_BINDING) return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	}
+
+	GpuCullingSystem::GpuCullingSystem(VmcDevice& device, VmcPipelineBatch& pipelines) : vmcDevice{ device } {
+		for (FrameResources& frame : frames) {
+			void* mapped = nullptr;
+			vmcDevice.createBuffer(sizeof(GpuSectionRecord) * VkDeviceSize{ MAX_SECTIONS }, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VMA_MEMORY_USAGE_CPU_TO_GPU, &frame.sectionBuffer, &frame.sectionMemory, &mapped);
+			frame.mappedSections = static_cast<GpuSectionRecord*>(mapped);
+
+			// one half for each phase
+			vmcDevice.createBuffer(sizeof(VkDrawIndexedIndirectCommand) * VkDeviceSize{ 2 * MAX_SECTIONS },
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY, &frame.drawBuffer, &frame.drawMemory);
+
+			// read back on the cpu for the stats, so it lives in host memory
+			vmcDevice.createBuffer(sizeof(Counts), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VMA_MEMORY_USAGE_GPU_TO_CPU, &frame.countBuffer, &frame.countMemory, &mapped);
+			frame.mappedCounts = static_cast<Counts*>(mapped);
+			*frame.mappedCounts = Counts{};
+
+			vmcDevice.createBuffer(sizeof(CullUniforms), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU,
+				&frame.uniformBuffer, &frame.uniformMemory, &frame.mappedUniforms);
+
+			vmcDevice.createBuffer(sizeof(uint32_t) * VkDeviceSize{ MAX_SECTIONS + MAX_ENTITIES }, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VMA_MEMORY_USAGE_GPU_ONLY, &frame.occludedBuffer, &frame.occludedMemory);
+
+			vmcDevice.createBuffer(sizeof(GpuEntityRecord) * VkDeviceSize{ MAX_ENTITIES }, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VMA_MEMORY_USAGE_CPU_TO_GPU, &frame.entityBuffer, &frame.entityMemory, &mapped);
+			frame.mappedEntities = static_cast<GpuEntityRecord*>(mapped);
+
+			// a command per group for each phase, written on the cpu with no instances and counted up by the cull
+			vmcDevice.createBuffer(sizeof(VkDrawIndexedIndirectCommand) * VkDeviceSize{ 2 * MAX_ENTITY_GROUPS },
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, &frame.entityDrawBuffer, &frame.entityDrawMemory,
+				&mapped);
+			frame.mappedEntityDraws = static_cast<VkDrawIndexedIndirectCommand*>(mapped);
+
+			vmcDevice.createBuffer(sizeof(VmcModel::Instance) * VkDeviceSize{ 2 * MAX_ENTITIES }, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+				VMA_MEMORY_USAGE_GPU_ONLY, &frame.entityInstanceBuffer, &frame.entityInstanceMemory);
+
+			vmcDevice.createBuffer(sizeof(uint32_t) * VkDeviceSize{ MAX_SECTIONS / 32 }, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU,
+				&frame.reachableBuffer, &frame.reachableMemory, &mapped);
+			frame.mappedReachable = static_cast<uint32_t*>(mapped);
+		}
+		reachableSlots.resize(MAX_SECTIONS / 32);
+
+		createDescriptors();
+		createPipelineLayout();
+		pipelines.add([this] { createPipeline(); });
+	}
+
+	GpuCullingSystem::~GpuCullingSystem() {
+		cullPipeline = nullptr;
+		vkDestroyPipelineLayout(vmcDevice.device(), pipelineLayout, nullptr);
+		vkDestroyDescriptorPool(vmcDevice.device(), descriptorPool, nullptr);
+		vkDestroyDescriptorSetLayout(vmcDevice.device(), descriptorSetLayout, nullptr);
+		for (FrameResources& frame : frames) {
+			vmaDestroyBuffer(vmcDevice.vmaAllocator, frame.sectionBuffer, frame.sectionMemory);
+			vmaDestroyBuffer(vmcDevice.vmaAllocator, frame.drawBuffer, frame.drawMemory);
+			vmaDestroyBuffer(vmcDevice.vmaAllocator, frame.countBuffer, frame.countMemory);
+			vmaDestroyBuffer(vmcDevice.vmaAllocator, frame.uniformBuffer, frame.uniformMemory);
+			vmaDestroyBuffer(vmcDevice.vmaAllocator, frame.occludedBuffer, frame.occludedMemory);
+			vmaDestroyBuffer(vmcDevice.vmaAllocator, frame.entityBuffer, frame.entityMemory);
+			vmaDestroyBuffer(vmcDevice.vmaAllocator, frame.entityDrawBuffer, frame.entityDrawMemory);
+			vmaDestroyBuffer(vmcDevice.vmaAllocator, frame.entityInstanceBuffer, frame.entityInstanceMemory);
+			vmaDestroyBuffer(vmcDevice.vmaAllocator, frame.reachableBuffer, frame.reachableMemory);
+		}
+	}
+
+	void GpuCullingSystem::createDescriptors() {
+		VkDescriptorSetLayoutBinding bindings[BINDING_COUNT]{};
+		for (uint32_t i = 0; i < BINDING_COUNT; i++) {
+			bindings[i].binding = i;
+			bindings[i].descriptorType = bindingType(i);
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = BINDING_COUNT;
+		layoutInfo.pBindings = bindings;
+		if (vkCreateDescriptorSetLayout(vmcDevice.device(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create culling descriptor set layout");
+		}
+
+		VkDescriptorPoolSize poolSizes[3]{};
+		poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolSizes[0].descriptorCount = (BINDING_COUNT - 2) * VmcSwapChain::MAX_FRAMES_IN_FLIGHT;
+		poolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		poolSizes[1].descriptorCount = VmcSwapChain::MAX_FRAMES_IN_FLIGHT;
+		poolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		poolSizes[2].descriptorCount = VmcSwapChain::MAX_FRAMES_IN_FLIGHT;
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.maxSets = VmcSwapChain::MAX_FRAMES_IN_FLIGHT;
+		poolInfo.poolSizeCount = 3;
+		poolInfo.pPoolSizes = poolSizes;
+		if (vkCreateDescriptorPool(vmcDevice.device(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create culling descriptor pool");
+		}
+
+		for (FrameResources& frame : frames) {
+			VkDescriptorSetAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			allocInfo.descriptorPool = descriptorPool;
+			allocInfo.descriptorSetCount = 1;
+			allocInfo.pSetLayouts = &descriptorSetLayout;
+			if (vkAllocateDescriptorSets(vmcDevice.device(), &allocInfo, &frame.descriptorSet) != VK_SUCCESS) {
+				throw std::runtime_error("failed to allocate culling descriptor set");
+			}
+
+			// the pyramid is written every cull since it is recreated when the window is resized
+			VkDescriptorBufferInfo bufferInfos[BINDING_COUNT]{};
+			bufferInfos[0] = { frame.sectionBuffer, 0, VK_WHOLE_SIZE };
+			bufferInfos[1] = { frame.drawBuffer, 0, VK_WHOLE_SIZE };
+			bufferInfos[2] = { frame.countBuffer, 0, VK_WHOLE_SIZE };
+			bufferInfos[3] = { frame.uniformBuffer, 0, VK_WHOLE_SIZE };
+			bufferInfos[5] = { frame.occludedBuffer, 0, VK_WHOLE_SIZE };
+			bufferInfos[6] = { frame.entityBuffer, 0, VK_WHOLE_SIZE };
+			bufferInfos[7] = { frame.entityDrawBuffer, 0, VK_WHOLE_SIZE };
+			bufferInfos[8] = { frame.reachableBuffer, 0, VK_WHOLE_SIZE };
+			bufferInfos[9] = { frame.entityInstanceBuffer, 0, VK_WHOLE_SIZE };
+
+			VkWriteDescriptorSet writes[BINDING_COUNT - 1]{};
+			uint32_t writeCount = 0;
+			for (uint32_t i = 0; i < BINDING_COUNT; i++) {
+				if (i == PYRAMID_BINDING) continue;
+				VkWriteDescriptorSet& write = writes[writeCount++];
+				write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				write.dstSet = frame.descriptorSet;
+				write.dstBinding = i;
+				write.descriptorCount = 1;
+				write.descriptorType = bindingType(i);
+				write.pBufferInfo = &bufferInfos[i];
+			}
+			vkUpdateDescriptorSets(vmcDevice.device(), writeCount, writes, 0, nullptr);
+		}
+	}
+
+	void GpuCullingSystem::createPipelineLayout() {
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(CullPushConstants);
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+		if (vkCreatePipelineLayout(vmcDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create culling pipeline layout");
+		}
+	}
+
+	void GpuCullingSystem::createPipeline() {
+		cullPipeline = std::make_unique<VmcPipeline>(vmcDevice, "cull_sections.comp.spv", pipelineLayout);
+	}
+
+	uint32_t GpuCullingSystem::addSection(const Aabb& bounds, const MeshAllocation& mesh) {
+		uint32_t slot;
+		if (!freeSlots.empty()) {
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else {
+			if (records.size() == MAX_SECTIONS) throw std::runtime_error("too many sections for gpu culling");
+			slot = static_cast<uint32_t>(records.size());
+			records.emplace_back();
+		}
+		sectionCount++;
+		updateSection(slot, bounds, mesh);
+		return slot;
+	}
+
+	void GpuCullingSystem::updateSection(uint32_t slot, const Aabb& bounds, const MeshAllocation& mesh) {
+		GpuSectionRecord& record = records[slot];
+		record.boundsMin = glm::vec4{ bounds.min, .0f };
+		record.boundsMax = glm::vec4{ bounds.max, .0f };
+		record.indexCount = mesh.indexCount;
+		record.firstIndex = mesh.firstIndex;
+		record.vertexOffset = static_cast<int32_t>(mesh.firstVertex);
+		markDirty(slot);
+	}
+
+	void GpuCullingSystem::removeSection(uint32_t slot) {
+		records[slot] = GpuSectionRecord{};
+		markDirty(slot);
+		freeSlots.push_back(slot);
+		sectionCount--;
+	}
+
+	void GpuCullingSystem::markDirty(uint32_t slot) {
+		for (FrameResources& frame : frames) frame.dirtySlots.push_back(slot);
+	}
+
+	void GpuCullingSystem::clearEntities(int frameIndex) {
+		entityGroups.clear();
+		entityCount = 0;
+		entityFrame = frameIndex;
+	}
+
+	uint32_t GpuCullingSystem::addEntityGroup(uint32_t indexCount) {
+		if (entityGroups.size() == MAX_ENTITY_GROUPS) throw std::runtime_error("too many entity groups for gpu culling");
+		entityGroups.push_back({ indexCount, entityCount });
+		return static_cast<uint32_t>(entityGroups.size() - 1);
+	}
+
+	void GpuCullingSystem::addEntity(const Aabb& viewBounds, const VmcModel::Instance& instance) {
+		if (entityCount == MAX_ENTITIES) throw std::runtime_error("too many entities for gpu culling");
+		GpuEntityRecord& record = frames[entityFrame].mappedEntities[entityCount++];
+		record.boundsMin = glm::vec4{ viewBounds.min, .0f };
+		record.boundsMax = glm::vec4{ viewBounds.max, .0f };
+		record.group = static_cast<uint32_t>(entityGroups.size() - 1);
+		record.groupFirst = entityGroups.back().first;
+		record.instance = instance;
+	}
+
+	void GpuCullingSystem::restrictToSlots(const std::vector<uint32_t>& slots) {
+		std::fill(reachableSlots.begin(), reachableSlots.end(), 0u);
+		for (uint32_t slot : slots) reachableSlots[slot >> 5] |= 1u << (slot & 31);
+		restricted = true;
+	}
+
+	void GpuCullingSystem::dispatch(VkCommandBuffer commandBuffer, const FrameResources& frame, CullPhase phase) {
+		const uint32_t invocations = static_cast<uint32_t>(records.size()) + entityCount;
+		if (invocations == 0) return;
+
+		CullPushConstants push{};
+		push.phase = static_cast<uint32_t>(phase);
+		cullPipeline->bind(commandBuffer);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &frame.descriptorSet, 0, nullptr);
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &push);
+		vkCmdDispatch(commandBuffer, (invocations + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+		// the draws and counts are consumed by the indirect draws, the counts are also read back on the host and the
+		// entity instances are read as vertices
+		VkBufferMemoryBarrier drawBarriers[4]{};
+		for (VkBufferMemoryBarrier& barrier : drawBarriers) {
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.offset = 0;
+			barrier.size = VK_WHOLE_SIZE;
+		}
+		drawBarriers[0].buffer = frame.drawBuffer;
+		drawBarriers[1].buffer = frame.countBuffer;
+		drawBarriers[2].buffer = frame.entityDrawBuffer;
+		drawBarriers[3].buffer = frame.entityInstanceBuffer;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 4, drawBarriers, 0, nullptr);
+	}
+
+	void GpuCullingSystem::cull(VkCommandBuffer commandBuffer, int frameIndex, const VmcCamera& camera, const VmcHiZPyramid& pyramid, bool occlusion) {
+		FrameResources& frame = frames[frameIndex];
+
+		// beginFrame waited on this frame's fence, so the counts from its last use are final
+		vmaInvalidateAllocation(vmcDevice.vmaAllocator, frame.countMemory, 0, VK_WHOLE_SIZE);
+		const Counts& counts = *frame.mappedCounts;
+		visibleCount = counts.drawCount[0] + counts.drawCount[1];
+		occludedSections = counts.occludedSections;
+		occludedEntities = counts.occludedEntities;
+		caveCulledSections = counts.caveCulled;
+
+		for (uint32_t slot : frame.dirtySlots) frame.mappedSections[slot] = records[slot];
+		frame.dirtySlots.clear();
+		vmaFlushAllocation(vmcDevice.vmaAllocator, frame.sectionMemory, 0, VK_WHOLE_SIZE);
+		// the records were written by addEntity already, the instance counts start at 0 in both phases
+		vmaFlushAllocation(vmcDevice.vmaAllocator, frame.entityMemory, 0, sizeof(GpuEntityRecord) * VkDeviceSize{ entityCount });
+		for (uint32_t phase = 0; phase < 2; phase++) {
+			for (size_t group = 0; group < entityGroups.size(); group++) {
+				frame.mappedEntityDraws[phase * MAX_ENTITY_GROUPS + group] = { entityGroups[group].indexCount, 0, 0, 0, 0 };
+			}
+		}
+		vmaFlushAllocation(vmcDevice.vmaAllocator, frame.entityDrawMemory, 0, VK_WHOLE_SIZE);
+
+		// the first phase projects into the pyramid of the last frame, the second into the one built from this frame
+		CullUniforms uniforms{};
+		for (int i = 0; i < 6; i++) uniforms.planes[i] = camera.getFrustum().planes[i];
+		uniforms.occluderViewProjection[0] = pyramid.getViewProjection();
+		uniforms.occluderProjection[0] = pyramid.getProjection();
+		uniforms.occluderViewProjection[1] = camera.getProjectionMatrix() * camera.getViewMatrix();
+		uniforms.occluderProjection[1] = camera.getProjectionMatrix();
+		uniforms.pyramidSize = { static_cast<float>(pyramid.getExtent().width), static_cast<float>(pyramid.getExtent().height) };
+		uniforms.pyramidLevels = pyramid.getLevelCount();
+		uniforms.occlusion = occlusion && pyramid.isBuilt() ? 1 : 0;
+		uniforms.sectionSlots = static_cast<uint32_t>(records.size());
+		uniforms.entityCount = entityCount;
+		uniforms.caveCulling = restricted ? 1 : 0;
+		if (restricted) {
+			std::memcpy(frame.mappedReachable, reachableSlots.data(), sizeof(uint32_t) * reachableSlots.size());
+			vmaFlushAllocation(vmcDevice.vmaAllocator, frame.reachableMemory, 0, VK_WHOLE_SIZE);
+			restricted = false;
+		}
+		std::memcpy(frame.mappedUniforms, &uniforms, sizeof(CullUniforms));
+		vmaFlushAllocation(vmcDevice.vmaAllocator, frame.uniformMemory, 0, VK_WHOLE_SIZE);
+
+		VkDescriptorImageInfo pyramidInfo{ pyramid.getSampler(), pyramid.getImageView(), VK_IMAGE_LAYOUT_GENERAL };
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = frame.descriptorSet;
+		write.dstBinding = PYRAMID_BINDING;
+		write.descriptorCount = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write.pImageInfo = &pyramidInfo;
+		vkUpdateDescriptorSets(vmcDevice.device(), 1, &write, 0, nullptr);
+
+		vkCmdFillBuffer(commandBuffer, frame.countBuffer, 0, sizeof(Counts), 0);
+
+		VkBufferMemoryBarrier clearBarrier{};
+		clearBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		clearBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		clearBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		clearBarrier.buffer = frame.countBuffer;
+		clearBarrier.offset = 0;
+		clearBarrier.size = VK_WHOLE_SIZE;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &clearBarrier, 0, nullptr);
+
+		dispatch(commandBuffer, frame, CullPhase::First);
+	}
+
+	void GpuCullingSystem::cullOccluded(VkCommandBuffer commandBuffer, int frameIndex) {
+		const FrameResources& frame = frames[frameIndex];
+
+		// the occluded flags and the counts written by the first phase
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		dispatch(commandBuffer, frame, CullPhase::Second);
+	}
+
+	void GpuCullingSystem::drawVisible(VkCommandBuffer commandBuffer, int frameIndex, CullPhase phase) {
+		const FrameResources& frame = frames[frameIndex];
+		const uint32_t index = static_cast<uint32_t>(phase);
+		vkCmdDrawIndexedIndirectCount(commandBuffer, frame.drawBuffer, sizeof(VkDrawIndexedIndirectCommand) * VkDeviceSize{ index * MAX_SECTIONS },
+			frame.countBuffer, sizeof(uint32_t) * index, MAX_SECTIONS, sizeof(VkDrawIndexedIndirectCommand));
+	}
+
+	void GpuCullingSystem::drawEntityGroup(VkCommandBuffer commandBuffer, int frameIndex, uint32_t group, CullPhase phase) {
+		const FrameResources& frame = frames[frameIndex];
+		const uint32_t index = static_cast<uint32_t>(phase);
+		// bound at the group's range instead of using firstInstance, which needs drawIndirectFirstInstance
+		const VkDeviceSize offset = sizeof(VmcModel::Instance) * VkDeviceSize{ index * MAX_ENTITIES + entityGroups[group].first };
+		vkCmdBindVertexBuffers(commandBuffer, 1, 1, &frame.entityInstanceBuffer, &offset);
+		vkCmdDrawIndexedIndirect(commandBuffer, frame.entityDrawBuffer, sizeof(VkDrawIndexedIndirectCommand) * VkDeviceSize{ index * MAX_ENTITY_GROUPS + group }, 1,
+			sizeof(VkDrawIndexedIndirectCommand));
+	}
+}
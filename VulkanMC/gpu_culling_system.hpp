@@ -0,0 +1,170 @@
+#pragma once
+
+#include "vmc_camera.hpp"
+#include "vmc_device.hpp"
+#include "vmc_frustum.hpp"
+#include "vmc_hiz_pyramid.hpp"
+#include "vmc_mesh_arena.hpp"
+#include "vmc_model.hpp"
+#include "vmc_pipeline.hpp"
+#include "vmc_swap_chain.hpp"
+
+// std
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace vmc {
+	// matches Section in cull_sections.comp
+	struct GpuSectionRecord {
+		glm::vec4 boundsMin{ .0f };
+		glm::vec4 boundsMax{ .0f };
+		uint32_t indexCount = 0;
+		uint32_t firstIndex = 0;
+		int32_t vertexOffset = 0;
+		uint32_t padding = 0;
+	};
+
+	// matches Entity in cull_sections.comp
+	struct GpuEntityRecord {
+		glm::vec4 boundsMin{ .0f };
+		glm::vec4 boundsMax{ .0f };
+		uint32_t group = 0;
+		// where the group's visible instances start in the instance buffer
+		uint32_t groupFirst = 0;
+		uint32_t padding[2]{};
+		VmcModel::Instance instance;
+	};
+
+	// with occlusion culling everything hidden by last frame's depth is skipped in the first phase, the pyramid is
+	// rebuilt from what that drew and the second phase draws whatever turns out to be visible after all, so
+	// geometry that comes out from behind something shows up the same frame instead of popping in a frame late
+	enum class CullPhase { First, Second };
+
+	// frustum and occlusion culls every section on the gpu. the bounds and draw ranges of all sections live in a
+	// storage buffer, a compute pass appends a VkDrawIndexedIndirectCommand for each visible one and the whole world
+	// is then drawn with a single vkCmdDrawIndexedIndirectCount, so the cpu cost no longer depends on how many
+	// sections there are. entities only get the occlusion test, they are frustum culled on the cpu before
+	class GpuCullingSystem {
+	public:
+		static constexpr uint32_t MAX_SECTIONS = 1 << 16;
+		static constexpr uint32_t MAX_ENTITIES = 1 << 17;
+		// entities sharing a model are drawn with one instanced draw per group
+		static constexpr uint32_t MAX_ENTITY_GROUPS = 1 << 8;
+		static constexpr uint32_t WORKGROUP_SIZE = 64;
+
+		// the culling pipeline is added to pipelines, cull can't be called until it has been built
+		GpuCullingSystem(VmcDevice& device, VmcPipelineBatch& pipelines);
+		~GpuCullingSystem();
+
+		GpuCullingSystem(const GpuCullingSystem&) = delete;
+		GpuCullingSystem& operator=(const GpuCullingSystem&) = delete;
+
+		// returns the slot the section is stored in, throws if every slot is taken
+		uint32_t addSection(const Aabb& bounds, const MeshAllocation& mesh);
+		void updateSection(uint32_t slot, const Aabb& bounds, const MeshAllocation& mesh);
+		void removeSection(uint32_t slot);
+
+		// entities move, so they are handed over again every frame before cull, straight into that frame's buffer.
+		// they go in by group, every entity added after addEntityGroup belongs to it. bounds are relative to the camera
+		void clearEntities(int frameIndex);
+		// returns the group to draw the entities with
+		uint32_t addEntityGroup(uint32_t indexCount);
+		void addEntity(const Aabb& viewBounds, const VmcModel::Instance& instance);
+		// limits the next cull to these section slots, e.g. the ones the cave culling search reached. without a
+		// call before cull every section is considered
+		void restrictToSlots(const std::vector<uint32_t>& slots);
+
+		// records the first phase for this frame, has to be outside of a render pass. without occlusion only the
+		// frustum is tested and there is no second phase
+		void cull(VkCommandBuffer commandBuffer, int frameIndex, const VmcCamera& camera, const VmcHiZPyramid& pyramid, bool occlusion);
+		// records the second phase, after the pyramid was built from the first pass
+		void cullOccluded(VkCommandBuffer commandBuffer, int frameIndex);
+		// inside the render pass, with the section pipeline, push constants and mesh arena already bound
+		void drawVisible(VkCommandBuffer commandBuffer, int frameIndex, CullPhase phase = CullPhase::First);
+		// inside the render pass, with the entity pipeline, push constants and the group's model already bound. binds
+		// the instances that passed the test in this phase and draws them
+		void drawEntityGroup(VkCommandBuffer commandBuffer, int frameIndex, uint32_t group, CullPhase phase);
+
+		uint32_t getSectionCount() const { return sectionCount; }
+		// the counts are read back when the frame slot comes around again, so they lag MAX_FRAMES_IN_FLIGHT frames behind
+		uint32_t getVisibleCount() const { return visibleCount; }
+		uint32_t getOccludedSections() const { return occludedSections; }
+		uint32_t getOccludedEntities() const { return occludedEntities; }
+		// inside the frustum but left out by restrictToSlots
+		uint32_t getCaveCulledSections() const { return caveCulledSections; }
+
+	private:
+		// matches Counts in cull_sections.comp
+		struct Counts {
+			uint32_t drawCount[2];
+			uint32_t occludedSections;
+			uint32_t occludedEntities;
+			uint32_t caveCulled;
+		};
+
+		struct FrameResources {
+			VkBuffer sectionBuffer;
+			VmaAllocation sectionMemory;
+			GpuSectionRecord* mappedSections = nullptr;
+			VkBuffer drawBuffer;
+			VmaAllocation drawMemory;
+			VkBuffer countBuffer;
+			VmaAllocation countMemory;
+			Counts* mappedCounts = nullptr;
+			VkBuffer uniformBuffer;
+			VmaAllocation uniformMemory;
+			void* mappedUniforms = nullptr;
+			VkBuffer occludedBuffer;
+			VmaAllocation occludedMemory;
+			VkBuffer entityBuffer;
+			VmaAllocation entityMemory;
+			GpuEntityRecord* mappedEntities = nullptr;
+			VkBuffer entityDrawBuffer;
+			VmaAllocation entityDrawMemory;
+			VkDrawIndexedIndirectCommand* mappedEntityDraws = nullptr;
+			// the visible instances of every group, compacted by the cull and read as a vertex buffer
+			VkBuffer entityInstanceBuffer;
+			VmaAllocation entityInstanceMemory;
+			VkBuffer reachableBuffer;
+			VmaAllocation reachableMemory;
+			uint32_t* mappedReachable = nullptr;
+			VkDescriptorSet descriptorSet;
+			// slots changed since this frame's copy of the records was last written
+			std::vector<uint32_t> dirtySlots;
+		};
+
+		void createDescriptors();
+		void createPipelineLayout();
+		void createPipeline();
+		void markDirty(uint32_t slot);
+		void dispatch(VkCommandBuffer commandBuffer, const FrameResources& frame, CullPhase phase);
+
+		VmcDevice& vmcDevice;
+		VkDescriptorSetLayout descriptorSetLayout;
+		VkDescriptorPool descriptorPool;
+		VkPipelineLayout pipelineLayout;
+		std::unique_ptr<VmcPipeline> cullPipeline;
+		std::array<FrameResources, VmcSwapChain::MAX_FRAMES_IN_FLIGHT> frames;
+
+		// every frame keeps its own copy of the records so changing one never races a frame that is still culling
+		std::vector<GpuSectionRecord> records;
+		std::vector<uint32_t> freeSlots;
+		struct EntityGroup {
+			uint32_t indexCount;
+			uint32_t first;
+		};
+		std::vector<EntityGroup> entityGroups;
+		uint32_t entityCount = 0;
+		int entityFrame = 0;
+		// a bit per slot, only uploaded when restricted is set
+		std::vector<uint32_t> reachableSlots;
+		bool restricted = false;
+		uint32_t sectionCount = 0;
+		uint32_t visibleCount = 0;
+		uint32_t occludedSections = 0;
+		uint32_t occludedEntities = 0;
+		uint32_t caveCulledSections = 0;
+	};
+}
@@ -0,0 +1,257 @@
+#include "light_engine.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+
+namespace vmc {
+	static constexpr int N = ChunkSection::SIZE;
+
+	// in the order -x, +x, -y, +y, -z, +z
+	static const int faceOffsets[6][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+	static constexpr int FACE_DOWN = 2;
+
+	// the level light arrives with after moving through face into a block
+	static uint8_t propagated(LightChannel channel, uint8_t level, int face, BlockId into) {
+		if (isSolidBlock(into)) return 0;
+		if (channel == LightChannel::Sky && face == FACE_DOWN && level == MAX_LIGHT && lightAbsorption(into) == 0) return MAX_LIGHT;
+		const int next = level - 1 - lightAbsorption(into);
+		return static_cast<uint8_t>(next > 0 ? next : 0);
+	}
+
+	static NibbleArray& channelOf(SectionLight& light, LightChannel channel) {
+		return channel == LightChannel::Sky ? light.sky : light.block;
+	}
+
+	Chunk* LightEngine::chunkAt(int x, int z) {
+		const ChunkPos pos = VmcWorld::toChunkPos(x, z);
+		if (cachedChunk == nullptr || pos != cachedPos) {
+			cachedChunk = world.getChunk(pos);
+			cachedPos = pos;
+		}
+		if (confinedTo != nullptr && cachedChunk != confinedTo) return nullptr;
+		return cachedChunk;
+	}
+
+	uint8_t LightEngine::getLight(LightChannel channel, Chunk& chunk, int x, int y, int z) const {
+		const int localX = VmcWorld::toLocal(x);
+		const int localZ = VmcWorld::toLocal(z);
+		return channel == LightChannel::Sky ? chunk.getSkyLight(localX, y, localZ) : chunk.getBlockLight(localX, y, localZ);
+	}
+
+	void LightEngine::setLight(LightChannel channel, Chunk& chunk, int x, int y, int z, uint8_t level) {
+		const int localX = VmcWorld::toLocal(x);
+		const int localY = y & (N - 1);
+		const int localZ = VmcWorld::toLocal(z);
+		channelOf(chunk.getLight(y >> 4), channel).set(ChunkSection::index(localX, localY, localZ), level);
+		cellsTouched++;
+		if (!trackChanges) return;
+
+		const uint8_t faces = static_cast<uint8_t>((localX == 0 ? 1 : 0) | (localX == N - 1 ? 2 : 0) | (localY == 0 ? 4 : 0) |
+			(localY == N - 1 ? 8 : 0) | (localZ == 0 ? 16 : 0) | (localZ == N - 1 ? 32 : 0));
+		changedSections[{ x >> 4, y >> 4, z >> 4 }] |= faces;
+	}
+
+	void LightEngine::propagateAdd(LightChannel channel) {
+		for (size_t head = 0; head < addQueue.size(); head++) {
+			const LightNode node = addQueue[head];
+			Chunk* chunk = chunkAt(node.x, node.z);
+			if (chunk == nullptr) continue;
+			// the node only says where to look, the level may have gone up since it was queued
+			const uint8_t level = getLight(channel, *chunk, node.x, node.y, node.z);
+			if (level <= 1) continue;
+
+			for (int face = 0; face < 6; face++) {
+				const int x = node.x + faceOffsets[face][0];
+				const int y = node.y + faceOffsets[face][1];
+				const int z = node.z + faceOffsets[face][2];
+				if (y < 0 || y >= Chunk::HEIGHT) continue;
+				Chunk* neighbour = chunkAt(x, z);
+				if (neighbour == nullptr) continue;
+
+				const uint8_t next = propagated(channel, level, face, neighbour->getBlock(VmcWorld::toLocal(x), y, VmcWorld::toLocal(z)));
+				if (next > getLight(channel, *neighbour, x, y, z)) {
+					setLight(channel, *neighbour, x, y, z, next);
+					addQueue.push_back({ x, y, z, next });
+				}
+			}
+		}
+		addQueue.clear();
+	}
+
+	void LightEngine::propagateRemove(LightChannel channel) {
+		for (size_t head = 0; head < removeQueue.size(); head++) {
+			const LightNode node = removeQueue[head];
+			for (int face = 0; face < 6; face++) {
+				const int x = node.x + faceOffsets[face][0];
+				const int y = node.y + faceOffsets[face][1];
+				const int z = node.z + faceOffsets[face][2];
+				if (y < 0 || y >= Chunk::HEIGHT) continue;
+				Chunk* neighbour = chunkAt(x, z);
+				if (neighbour == nullptr) continue;
+				const uint8_t level = getLight(channel, *neighbour, x, y, z);
+				if (level == 0) continue;
+
+				const BlockId block = neighbour->getBlock(VmcWorld::toLocal(x), y, VmcWorld::toLocal(z));
+				const uint8_t source = channel == LightChannel::Block ? lightEmission(block) : 0;
+				if (level > source && level <= propagated(channel, node.level, face, block)) {
+					// may have come from the light that is going away, so it goes too and only keeps what it gives off itself
+					setLight(channel, *neighbour, x, y, z, source);
+					removeQueue.push_back({ x, y, z, level });
+					if (source > 0) addQueue.push_back({ x, y, z, source });
+				}
+				else {
+					// lit from somewhere else, it fills the hole back in once the removal is done
+					addQueue.push_back({ x, y, z, level });
+				}
+			}
+		}
+		removeQueue.clear();
+	}
+
+	void LightEngine::relight(LightChannel channel, int x, int y, int z, BlockId block) {
+		Chunk* chunk = chunkAt(x, z);
+		const uint8_t old = getLight(channel, *chunk, x, y, z);
+		const uint8_t source = channel == LightChannel::Block ? lightEmission(block) : 0;
+		if (old != source) setLight(channel, *chunk, x, y, z, source);
+		if (old > source) removeQueue.push_back({ x, y, z, old });
+		if (source > 0) addQueue.push_back({ x, y, z, source });
+		propagateRemove(channel);
+
+		if (!isSolidBlock(block)) {
+			// let the neighbours flow back into the block, the queue only needs to know where they are
+			for (int face = 0; face < 6; face++) {
+				const int ny = y + faceOffsets[face][1];
+				if (ny >= 0 && ny < Chunk::HEIGHT) addQueue.push_back({ x + faceOffsets[face][0], ny, z + faceOffsets[face][2], 0 });
+			}
+			// nothing is stored for the open sky above the world
+			if (channel == LightChannel::Sky && y == Chunk::HEIGHT - 1) {
+				const uint8_t fromSky = propagated(channel, MAX_LIGHT, FACE_DOWN, block);
+				if (fromSky > getLight(channel, *chunk, x, y, z)) {
+					setLight(channel, *chunk, x, y, z, fromSky);
+					addQueue.push_back({ x, y, z, fromSky });
+				}
+			}
+		}
+		propagateAdd(channel);
+	}
+
+	void LightEngine::lightChunk(ChunkPos pos) {
+		cachedChunk = nullptr;
+		Chunk* chunk = world.getChunk(pos);
+		if (chunk == nullptr) return;
+		confinedTo = chunk;
+		trackChanges = false;
+		const int baseX = pos.x * N;
+		const int baseZ = pos.z * N;
+
+		int top = -1;
+		for (int i = 0; i < Chunk::SECTION_COUNT; i++) {
+			if (!chunk->getSection(i).isEmpty()) top = i;
+		}
+		// everything above the highest block is open sky
+		for (int i = 0; i < Chunk::SECTION_COUNT; i++) {
+			chunk->getLight(i).sky.fill(i > top ? MAX_LIGHT : 0);
+			chunk->getLight(i).block.fill(0);
+		}
+
+		// straight down from the sky until something stops it. skyTop is the lowest block the full strength run reaches
+		std::array<int, ChunkSection::AREA> skyTop;
+		for (int z = 0; z < N; z++) {
+			for (int x = 0; x < N; x++) {
+				int& columnTop = skyTop[z * N + x];
+				columnTop = (top + 1) * N;
+				uint8_t level = MAX_LIGHT;
+				for (int y = columnTop - 1; y >= 0; y--) {
+					level = propagated(LightChannel::Sky, level, FACE_DOWN, chunk->getBlock(x, y, z));
+					if (level == 0) break;
+					setLight(LightChannel::Sky, *chunk, baseX + x, y, baseZ + z, level);
+					if (level == MAX_LIGHT) columnTop = y;
+					else if (level > 1) addQueue.push_back({ baseX + x, y, baseZ + z, level });
+				}
+			}
+		}
+		// full strength blocks beside a column the sky doesn't reach as far down in spread sideways into it
+		for (int z = 0; z < N; z++) {
+			for (int x = 0; x < N; x++) {
+				int lowest = skyTop[z * N + x];
+				int highest = lowest;
+				if (x > 0) highest = std::max(highest, skyTop[z * N + x - 1]);
+				if (x < N - 1) highest = std::max(highest, skyTop[z * N + x + 1]);
+				if (z > 0) highest = std::max(highest, skyTop[(z - 1) * N + x]);
+				if (z < N - 1) highest = std::max(highest, skyTop[(z + 1) * N + x]);
+				for (int y = lowest; y < highest; y++) addQueue.push_back({ baseX + x, y, baseZ + z, MAX_LIGHT });
+			}
+		}
+		propagateAdd(LightChannel::Sky);
+
+		for (int i = 0; i <= top; i++) {
+			const ChunkSection& section = chunk->getSection(i);
+			bool emits = false;
+			for (BlockId id = 0; id < BLOCK_COUNT; id++) {
+				if (lightEmission(id) > 0 && section.contains(id)) emits = true;
+			}
+			if (!emits) continue;
+			section.forEachBlock([&](int x, int y, int z, BlockId id) {
+				const uint8_t emission = lightEmission(id);
+				if (emission == 0) return;
+				setLight(LightChannel::Block, *chunk, baseX + x, i * N + y, baseZ + z, emission);
+				addQueue.push_back({ baseX + x, i * N + y, baseZ + z, emission });
+			});
+		}
+		propagateAdd(LightChannel::Block);
+
+		confinedTo = nullptr;
+		trackChanges = true;
+		for (int i = 0; i < Chunk::SECTION_COUNT; i++) {
+			chunk->getLight(i).compact();
+			changedSections[{ pos.x, i, pos.z }] |= 0x3f;
+		}
+	}
+
+	void LightEngine::stitchChunk(ChunkPos pos) {
+		cachedChunk = nullptr;
+		Chunk* chunk = world.getChunk(pos);
+		if (chunk == nullptr) return;
+
+		// -x, +x, -z, +z
+		static const int sideOffsets[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+		for (LightChannel channel : { LightChannel::Sky, LightChannel::Block }) {
+			for (const auto& offset : sideOffsets) {
+				Chunk* neighbour = world.getChunk({ pos.x + offset[0], pos.z + offset[1] });
+				if (neighbour == nullptr) continue;
+
+				for (int i = 0; i < Chunk::SECTION_COUNT; i++) {
+					const NibbleArray& mine = channelOf(chunk->getLight(i), channel);
+					const NibbleArray& theirs = channelOf(neighbour->getLight(i), channel);
+					// within a level of each other on both sides, nothing can flow across
+					if (mine.isUniform() && theirs.isUniform() && mine.getUniform() <= theirs.getUniform() + 1 &&
+						theirs.getUniform() <= mine.getUniform() + 1) continue;
+
+					for (int y = i * N; y < (i + 1) * N; y++) {
+						for (int t = 0; t < N; t++) {
+							// the block on our side of the seam, the neighbour's is one further along the offset
+							const int x = pos.x * N + (offset[0] < 0 ? 0 : (offset[0] > 0 ? N - 1 : t));
+							const int z = pos.z * N + (offset[1] < 0 ? 0 : (offset[1] > 0 ? N - 1 : t));
+							const uint8_t ours = getLight(channel, *chunk, x, y, z);
+							const uint8_t across = getLight(channel, *neighbour, x + offset[0], y, z + offset[1]);
+							if (across > ours + 1) addQueue.push_back({ x + offset[0], y, z + offset[1], across });
+							else if (ours > across + 1) addQueue.push_back({ x, y, z, ours });
+						}
+					}
+				}
+			}
+			propagateAdd(channel);
+		}
+	}
+
+	void LightEngine::blockChanged(int x, int y, int z) {
+		cachedChunk = nullptr;
+		if (y < 0 || y >= Chunk::HEIGHT) return;
+		Chunk* chunk = chunkAt(x, z);
+		if (chunk == nullptr) return;
+		const BlockId block = chunk->getBlock(VmcWorld::toLocal(x), y, VmcWorld::toLocal(z));
+		relight(LightChannel::Sky, x, y, z, block);
+		relight(LightChannel::Block, x, y, z, block);
+	}
+}
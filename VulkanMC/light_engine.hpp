@@ -0,0 +1,69 @@
+#pragma once
+
+#include "vmc_world.hpp"
+
+// std
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace vmc {
+	enum class LightChannel { Sky, Block };
+
+	// flood fills sky light and block light through a world. sky light comes down from above the world at full
+	// strength and keeps it going straight down through air, anything else loses a level per block plus the
+	// absorption of the block it moves into. every write is tracked so callers know which sections to remesh.
+	// an edit only relights what it affects: light the old block let through is removed with a second flood
+	// (which collects whatever still has a source on its border) and then refilled from there.
+	// not thread safe, one engine per world and only ever used from one thread at a time
+	class LightEngine {
+	public:
+		explicit LightEngine(VmcWorld& world) : world{ world } {}
+
+		LightEngine(const LightEngine&) = delete;
+		LightEngine& operator=(const LightEngine&) = delete;
+
+		// lights a column that was just added to the world from its own blocks only, nothing outside it is read or
+		// written. stitchChunk then lets light flow between it and the loaded columns around it
+		void lightChunk(ChunkPos pos);
+		void stitchChunk(ChunkPos pos);
+		// the block at x, y, z has already been replaced in the world
+		void blockChanged(int x, int y, int z);
+
+		// sections written since the last clear, with a bit per face (-x, +x, -y, +y, -z, +z) that is set when
+		// a cell on that face changed, the mesh of the section behind it reads that cell too
+		const std::unordered_map<SectionPos, uint8_t, SectionPosHash>& getChangedSections() const { return changedSections; }
+		void clearChangedSections() { changedSections.clear(); }
+		// light writes since the last reset, both channels
+		uint64_t getCellsTouched() const { return cellsTouched; }
+		void resetCellsTouched() { cellsTouched = 0; }
+
+	private:
+		struct LightNode {
+			int x;
+			int y;
+			int z;
+			uint8_t level;
+		};
+
+		Chunk* chunkAt(int x, int z);
+		uint8_t getLight(LightChannel channel, Chunk& chunk, int x, int y, int z) const;
+		void setLight(LightChannel channel, Chunk& chunk, int x, int y, int z, uint8_t level);
+		void propagateAdd(LightChannel channel);
+		void propagateRemove(LightChannel channel);
+		void relight(LightChannel channel, int x, int y, int z, BlockId block);
+
+		VmcWorld& world;
+		// the last column looked up, floods mostly stay within one
+		Chunk* cachedChunk = nullptr;
+		ChunkPos cachedPos{ 0, 0 };
+		// set while lighting a single column, the floods then stop at its sides
+		const Chunk* confinedTo = nullptr;
+		bool trackChanges = true;
+
+		std::vector<LightNode> addQueue;
+		std::vector<LightNode> removeQueue;
+		std::unordered_map<SectionPos, uint8_t, SectionPosHash> changedSections;
+		uint64_t cellsTouched = 0;
+	};
+}
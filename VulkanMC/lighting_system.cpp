@@ -0,0 +1,132 @@
+#include "lighting_system.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+
+namespace vmc {
+	using Clock = std::chrono::steady_clock;
+
+	static float millisecondsSince(Clock::time_point start) {
+		return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+	}
+
+	LightingSystem::~LightingSystem() {
+		// jobs hold a pointer to this and keep going until every command is done
+		jobSystem.waitIdle();
+	}
+
+	void LightingSystem::addChunks(const std::vector<const Chunk*>& chunks) {
+		if (chunks.empty()) return;
+		Command command;
+		for (const Chunk* chunk : chunks) {
+			auto copy = std::make_unique<Chunk>(chunk->getPos());
+			for (int i = 0; i < Chunk::SECTION_COUNT; i++) copy->getSection(i) = chunk->getSection(i);
+			command.chunks.push_back(std::move(copy));
+		}
+		submit(std::move(command));
+	}
+
+	void LightingSystem::setBlock(int x, int y, int z, BlockId block) {
+		Command command;
+		command.x = x;
+		command.y = y;
+		command.z = z;
+		command.block = block;
+		submit(std::move(command));
+	}
+
+	void LightingSystem::submit(Command command) {
+		// counted before the push so process() can't miss it between its last pop and clearing scheduled
+		pendingCommands.fetch_add(1);
+		commands.push(std::move(command));
+		schedule();
+	}
+
+	void LightingSystem::schedule() {
+		if (scheduled.exchange(true)) return;
+		jobSystem.submit([this] { process(); });
+	}
+
+	void LightingSystem::process() {
+		Command command;
+		while (commands.pop(command)) {
+			if (!command.chunks.empty()) {
+				// picks up the remaining commands itself once the batch is done
+				lightChunks(std::move(command.chunks));
+				return;
+			}
+
+			const Clock::time_point start = Clock::now();
+			engine.resetCellsTouched();
+			if (world.setBlock(command.x, command.y, command.z, command.block)) engine.blockChanged(command.x, command.y, command.z);
+			publish(engine.getChangedSections());
+			engine.clearChangedSections();
+
+			LightReport report;
+			report.edit = true;
+			report.x = command.x;
+			report.y = command.y;
+			report.z = command.z;
+			report.cellsTouched = engine.getCellsTouched();
+			report.ms = millisecondsSince(start);
+			reports.push(report);
+			pendingCommands.fetch_sub(1);
+		}
+
+		scheduled.store(false);
+		if (pendingCommands.load() > 0) schedule();
+	}
+
+	void LightingSystem::lightChunks(std::vector<std::unique_ptr<Chunk>> chunks) {
+		const Clock::time_point start = Clock::now();
+		auto positions = std::make_shared<std::vector<ChunkPos>>();
+		for (auto& chunk : chunks) {
+			positions->push_back(chunk->getPos());
+			world.insertChunk(std::move(chunk));
+		}
+
+		// a column on its own only ever touches itself, so each job gets an engine of its own and the seams between
+		// the columns are done by the last job to finish
+		auto remaining = std::make_shared<std::atomic<size_t>>(positions->size());
+		auto cellsTouched = std::make_shared<std::atomic<uint64_t>>(0);
+		for (size_t first = 0; first < positions->size(); first += CHUNKS_PER_JOB) {
+			jobSystem.submit([this, positions, remaining, cellsTouched, first, start] {
+				const size_t last = std::min(first + CHUNKS_PER_JOB, positions->size());
+				LightEngine columnEngine{ world };
+				for (size_t i = first; i < last; i++) columnEngine.lightChunk((*positions)[i]);
+				cellsTouched->fetch_add(columnEngine.getCellsTouched());
+				if (remaining->fetch_sub(last - first) != last - first) return;
+
+				engine.resetCellsTouched();
+				for (const ChunkPos& pos : *positions) engine.stitchChunk(pos);
+				std::unordered_map<SectionPos, uint8_t, SectionPosHash> changed = engine.getChangedSections();
+				engine.clearChangedSections();
+				for (const ChunkPos& pos : *positions) {
+					for (int y = 0; y < Chunk::SECTION_COUNT; y++) changed[{ pos.x, y, pos.z }] |= 0x3f;
+				}
+				publish(changed);
+
+				LightReport report;
+				report.chunks = static_cast<uint32_t>(positions->size());
+				report.cellsTouched = cellsTouched->load() + engine.getCellsTouched();
+				report.ms = millisecondsSince(start);
+				reports.push(report);
+				pendingCommands.fetch_sub(1);
+				process();
+			});
+		}
+	}
+
+	void LightingSystem::publish(const std::unordered_map<SectionPos, uint8_t, SectionPosHash>& sections) {
+		for (const auto& [pos, faces] : sections) {
+			const Chunk* chunk = world.getChunk(pos.chunk());
+			if (chunk == nullptr || pos.y < 0 || pos.y >= Chunk::SECTION_COUNT) continue;
+			LightUpdate update;
+			update.pos = pos;
+			update.light = chunk->getLight(pos.y);
+			update.borderFaces = faces;
+			updates.push(std::move(update));
+		}
+	}
+}
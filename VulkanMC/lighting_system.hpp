@@ -0,0 +1,102 @@
+#pragma once
+
+#include "light_engine.hpp"
+#include "vmc_job_system.hpp"
+#include "vmc_mpsc_queue.hpp"
+
+// std
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace vmc {
+	// the new light of a section, copied out of the lighting system's world
+	struct LightUpdate {
+		SectionPos pos{};
+		SectionLight light;
+		// faces (-x, +x, -y, +y, -z, +z) with a changed cell on them, the meshes behind those read it too
+		uint8_t borderFaces = 0;
+	};
+
+	// what a batch of chunks or a single edit cost
+	struct LightReport {
+		uint32_t chunks = 0;
+		bool edit = false;
+		int x = 0;
+		int y = 0;
+		int z = 0;
+		uint64_t cellsTouched = 0;
+		float ms = .0f;
+	};
+
+	// runs the light engine on the job system. it keeps its own copy of the blocks, so the main thread can keep
+	// reading and editing the world while light is being worked out. commands are worked through one at a time
+	// and in order by a single job, except that the columns of a batch of new chunks are lit in parallel before
+	// being stitched together. results come back through lock free queues and are applied on the main thread
+	class LightingSystem {
+	public:
+		// columns lit by one job when a batch of chunks comes in
+		static constexpr size_t CHUNKS_PER_JOB = 16;
+
+		explicit LightingSystem(VmcJobSystem& jobSystem) : jobSystem{ jobSystem } {}
+		~LightingSystem();
+
+		LightingSystem(const LightingSystem&) = delete;
+		LightingSystem& operator=(const LightingSystem&) = delete;
+
+		// the blocks are copied right away, light flows into and out of chunks that were added before
+		void addChunks(const std::vector<const Chunk*>& chunks);
+		// the block has to be set in the world as well, this only relights
+		void setBlock(int x, int y, int z, BlockId block);
+
+		// calls apply(LightUpdate&) for every section whose light changed, the light can be moved out
+		template<typename F>
+		size_t drainUpdates(F&& apply) {
+			size_t applied = 0;
+			LightUpdate update;
+			while (updates.pop(update)) {
+				apply(update);
+				applied++;
+			}
+			return applied;
+		}
+		// calls report(const LightReport&) for every command that has been worked through
+		template<typename F>
+		void drainReports(F&& report) {
+			LightReport result;
+			while (reports.pop(result)) report(result);
+		}
+
+		bool isIdle() const { return pendingCommands.load() == 0 && updates.size() == 0 && reports.size() == 0; }
+
+	private:
+		// adds chunks, or sets a block when there are none
+		struct Command {
+			std::vector<std::unique_ptr<Chunk>> chunks;
+			int x = 0;
+			int y = 0;
+			int z = 0;
+			BlockId block = BLOCK_AIR;
+		};
+
+		void submit(Command command);
+		void schedule();
+		// runs on a worker, scheduled makes sure there is never more than one at a time
+		void process();
+		void lightChunks(std::vector<std::unique_ptr<Chunk>> chunks);
+		void publish(const std::unordered_map<SectionPos, uint8_t, SectionPosHash>& sections);
+
+		VmcJobSystem& jobSystem;
+		VmcMpscQueue<Command> commands;
+		VmcMpscQueue<LightUpdate> updates;
+		VmcMpscQueue<LightReport> reports;
+		std::atomic<size_t> pendingCommands{ 0 };
+		std::atomic<bool> scheduled{ false };
+
+		// only touched by whichever job currently holds scheduled
+		VmcWorld world;
+		LightEngine engine{ world };
+	};
+}
@@ -1,11 +1,57 @@
 #include "app.hpp"
+#include "block_textures.hpp"
+#include "texture_baker.hpp"
+#include "vmc_job_system.hpp"
 
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
-int main()
+#include <string>
+
+// builds the block texture ktx2 file the game loads on start, without opening a window
+static int bakeTextures(const vmc::TextureBakeOptions& options) {
+	vmc::VmcJobSystem jobSystem;
+	vmc::TextureBaker baker{ jobSystem };
+	try {
+		const vmc::TextureBakeStats stats = baker.bake(vmc::BlockTextures::generate(), vmc::BlockTextures::SIZE, vmc::TEXTURE_LAYER_COUNT, options);
+		std::cout << "baked " << options.outputPath << " as " << (options.format == vmc::BcFormat::BC1 ? "bc1" : "bc7") << " in " << stats.totalMs
+			<< " ms (mips " << stats.mipMs << " ms, encode " << stats.encodeMs << " ms on " << jobSystem.getWorkerCount() + 1 << " threads), "
+			<< stats.layers << " layers, " << stats.levels << " levels, " << stats.blocks << " blocks, " << stats.fileBytes / 1024.0
+			<< " KiB from " << stats.sourceBytes / 1024.0 << " KiB, " << stats.compressionRatio() << "x smaller" << std::endl;
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << '\n';
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv)
 {
-	vmc::App app{};
+	vmc::AppOptions options;
+	bool bake = false;
+	vmc::TextureBakeOptions bakeOptions;
+	bakeOptions.outputPath = vmc::App::BLOCK_TEXTURES_PATH;
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--no-pipeline-cache") == 0) options.loadPipelineCache = false;
+		if (std::strcmp(argv[i], "--bake-textures") == 0) {
+			bake = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-') bakeOptions.outputPath = argv[++i];
+		}
+		if (std::strcmp(argv[i], "--bc1") == 0) bakeOptions.format = vmc::BcFormat::BC1;
+		if (std::strcmp(argv[i], "--headless") == 0) options.headless = true;
+		if (std::strcmp(argv[i], "--benchmark") == 0) {
+			options.benchmarkFrames = vmc::App::BENCHMARK_FRAMES;
+			if (i + 1 < argc && argv[i + 1][0] != '-') options.benchmarkFrames = static_cast<uint32_t>(std::max(1l, std::strtol(argv[++i], nullptr, 10)));
+		}
+		if (std::strcmp(argv[i], "--benchmark-output") == 0 && i + 1 < argc) options.benchmarkOutput = argv[++i];
+	}
+	if (options.headless && options.benchmarkFrames == 0) options.benchmarkFrames = vmc::App::BENCHMARK_FRAMES;
+	if (bake) return bakeTextures(bakeOptions);
+
+	vmc::App app{ options };
 	try {
 		app.run();
 	}
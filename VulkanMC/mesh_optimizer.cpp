@@ -0,0 +1,137 @@
+#include "mesh_optimizer.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+
+namespace vmc {
+	// the modelled lru cache is bigger than any real one so the score still rewards vertices that might be in it
+	static constexpr int LRU_SIZE = 32;
+	static constexpr float CACHE_DECAY_POWER = 1.5f;
+	static constexpr float LAST_TRIANGLE_SCORE = .75f;
+	static constexpr float VALENCE_BOOST_SCALE = 2.f;
+	static constexpr float VALENCE_BOOST_POWER = .5f;
+
+	// vertices used by the last triangle get a fixed score so the next triangle doesn't just reuse the same edge,
+	// after that the score falls off with cache position. vertices with few triangles left get boosted so they are
+	// finished off instead of leaving lone triangles behind
+	static float vertexScore(int cachePosition, uint32_t remainingTriangles) {
+		if (remainingTriangles == 0) return -1.f;
+
+		float score = .0f;
+		if (cachePosition >= 0) {
+			if (cachePosition < 3) {
+				score = LAST_TRIANGLE_SCORE;
+			}
+			else {
+				const float scaler = 1.f / (LRU_SIZE - 3);
+				score = std::pow(1.f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+			}
+		}
+		return score + VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTriangles), -VALENCE_BOOST_POWER);
+	}
+
+	void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) {
+		const size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0) return;
+
+		// triangles of each vertex as one flat array, a vertex's list shrinks as its triangles are emitted
+		std::vector<uint32_t> remaining(vertexCount, 0);
+		for (uint32_t index : indices) remaining[index]++;
+		std::vector<uint32_t> offsets(vertexCount + 1, 0);
+		for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + remaining[v];
+		std::vector<uint32_t> adjacency(indices.size());
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t t = 0; t < triangleCount; t++) {
+			for (int k = 0; k < 3; k++) adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+		}
+
+		std::vector<int> cachePosition(vertexCount, -1);
+		std::vector<float> scores(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++) scores[v] = vertexScore(-1, remaining[v]);
+
+		std::vector<float> triangleScores(triangleCount);
+		std::vector<char> emitted(triangleCount, 0);
+		for (size_t t = 0; t < triangleCount; t++) {
+			triangleScores[t] = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+		}
+
+		std::vector<uint32_t> output;
+		output.reserve(indices.size());
+		// three spare slots so the new triangle can be pushed in front before the tail is cut off
+		uint32_t cache[LRU_SIZE + 3];
+		int cacheCount = 0;
+		size_t scanCursor = 0;
+
+		size_t best = std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin();
+		for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+			if (best == SIZE_MAX) {
+				// nothing in the cache has triangles left, carry on with the next unused one
+				while (emitted[scanCursor]) scanCursor++;
+				best = scanCursor;
+			}
+
+			const uint32_t* triangle = &indices[best * 3];
+			output.insert(output.end(), triangle, triangle + 3);
+			emitted[best] = 1;
+
+			// take the triangle out of its vertices' lists
+			for (int k = 0; k < 3; k++) {
+				const uint32_t v = triangle[k];
+				uint32_t* begin = &adjacency[offsets[v]];
+				uint32_t* end = begin + remaining[v];
+				*std::find(begin, end, static_cast<uint32_t>(best)) = end[-1];
+				remaining[v]--;
+			}
+
+			// move the triangle's vertices to the front of the cache
+			uint32_t newCache[LRU_SIZE + 3];
+			int newCount = 0;
+			for (int k = 0; k < 3; k++) newCache[newCount++] = triangle[k];
+			for (int i = 0; i < cacheCount; i++) {
+				const uint32_t v = cache[i];
+				if (v != triangle[0] && v != triangle[1] && v != triangle[2]) newCache[newCount++] = v;
+			}
+
+			// rescore everything that was in the cache, vertices that dropped out get -1 as their position
+			for (int i = 0; i < newCount; i++) {
+				const uint32_t v = newCache[i];
+				cachePosition[v] = i < LRU_SIZE ? i : -1;
+				scores[v] = vertexScore(cachePosition[v], remaining[v]);
+			}
+			cacheCount = std::min(newCount, LRU_SIZE);
+			std::copy(newCache, newCache + cacheCount, cache);
+
+			// the next triangle is the best one touching a vertex whose score changed
+			best = SIZE_MAX;
+			float bestScore = -1.f;
+			for (int i = 0; i < newCount; i++) {
+				const uint32_t v = newCache[i];
+				for (uint32_t a = offsets[v]; a < offsets[v] + remaining[v]; a++) {
+					const uint32_t t = adjacency[a];
+					const float score = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+					triangleScores[t] = score;
+					if (score > bestScore) {
+						bestScore = score;
+						best = t;
+					}
+				}
+			}
+		}
+
+		indices = std::move(output);
+	}
+
+	uint64_t MeshOptimizer::countCacheMisses(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize) {
+		// a vertex is in the fifo if it was inserted within the last cacheSize misses
+		std::vector<uint64_t> insertedAt(vertexCount, 0);
+		uint64_t misses = 0;
+		for (uint32_t index : indices) {
+			if (insertedAt[index] == 0 || misses - insertedAt[index] + 1 > static_cast<uint64_t>(cacheSize)) {
+				misses++;
+				insertedAt[index] = misses;
+			}
+		}
+		return misses;
+	}
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace vmc {
+	// counts for one or more meshes, acmr (average cache miss ratio) is post transform cache misses per triangle with a
+	// fifo cache of MeshOptimizer::FIFO_SIZE entries, 3 means nothing is reused and .5 is about the best a grid can get
+	struct MeshOptimizeStats {
+		uint64_t verticesBefore = 0;
+		uint64_t verticesAfter = 0;
+		uint64_t triangles = 0;
+		uint64_t cacheMissesBefore = 0;
+		uint64_t cacheMissesAfter = 0;
+
+		double acmrBefore() const { return triangles == 0 ? 0.0 : static_cast<double>(cacheMissesBefore) / triangles; }
+		double acmrAfter() const { return triangles == 0 ? 0.0 : static_cast<double>(cacheMissesAfter) / triangles; }
+
+		void add(const MeshOptimizeStats& other) {
+			verticesBefore += other.verticesBefore;
+			verticesAfter += other.verticesAfter;
+			triangles += other.triangles;
+			cacheMissesBefore += other.cacheMissesBefore;
+			cacheMissesAfter += other.cacheMissesAfter;
+		}
+	};
+
+	// index buffer optimizations that work on any vertex type, vertices are compared byte for byte so the type should
+	// not have padding
+	class MeshOptimizer {
+	public:
+		static constexpr int FIFO_SIZE = 16;
+
+		// merges identical vertices. indices may be empty, in which case every three vertices are a triangle
+		template<typename V>
+		static void deduplicate(std::vector<V>& vertices, std::vector<uint32_t>& indices);
+		// reorders triangles with tom forsyth's linear speed vertex cache optimization
+		static void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+		// reorders vertices into the order they are first used so fetches walk through memory
+		template<typename V>
+		static void optimizeVertexFetch(std::vector<V>& vertices, std::vector<uint32_t>& indices);
+		// misses of a fifo cache of cacheSize vertices, the way most gpus have worked since the post transform cache
+		static uint64_t countCacheMisses(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize = FIFO_SIZE);
+
+		// all of the above in order, the stats are filled in from before and after
+		template<typename V>
+		static MeshOptimizeStats optimize(std::vector<V>& vertices, std::vector<uint32_t>& indices);
+
+	private:
+		template<typename V>
+		struct VertexHash {
+			size_t operator()(const V& v) const {
+				// fnv-1a
+				const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&v);
+				size_t hash = 14695981039346656037ull;
+				for (size_t i = 0; i < sizeof(V); i++) hash = (hash ^ bytes[i]) * 1099511628211ull;
+				return hash;
+			}
+		};
+
+		template<typename V>
+		struct VertexEqual {
+			bool operator()(const V& a, const V& b) const { return std::memcmp(&a, &b, sizeof(V)) == 0; }
+		};
+	};
+
+	template<typename V>
+	void MeshOptimizer::deduplicate(std::vector<V>& vertices, std::vector<uint32_t>& indices) {
+		if (indices.empty()) {
+			indices.resize(vertices.size());
+			for (size_t i = 0; i < indices.size(); i++) indices[i] = static_cast<uint32_t>(i);
+		}
+
+		std::unordered_map<V, uint32_t, VertexHash<V>, VertexEqual<V>> unique;
+		unique.reserve(vertices.size());
+		std::vector<uint32_t> remap(vertices.size());
+		std::vector<V> merged;
+		merged.reserve(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++) {
+			auto [it, inserted] = unique.emplace(vertices[i], static_cast<uint32_t>(merged.size()));
+			if (inserted) merged.push_back(vertices[i]);
+			remap[i] = it->second;
+		}
+
+		for (uint32_t& index : indices) index = remap[index];
+		vertices = std::move(merged);
+	}
+
+	template<typename V>
+	void MeshOptimizer::optimizeVertexFetch(std::vector<V>& vertices, std::vector<uint32_t>& indices) {
+		constexpr uint32_t unused = UINT32_MAX;
+		std::vector<uint32_t> remap(vertices.size(), unused);
+		std::vector<V> ordered;
+		ordered.reserve(vertices.size());
+		for (uint32_t& index : indices) {
+			if (remap[index] == unused) {
+				remap[index] = static_cast<uint32_t>(ordered.size());
+				ordered.push_back(vertices[index]);
+			}
+			index = remap[index];
+		}
+		// vertices no triangle uses are dropped
+		vertices = std::move(ordered);
+	}
+
+	template<typename V>
+	MeshOptimizeStats MeshOptimizer::optimize(std::vector<V>& vertices, std::vector<uint32_t>& indices) {
+		MeshOptimizeStats stats;
+		stats.verticesBefore = vertices.size();
+		stats.triangles = (indices.empty() ? vertices.size() : indices.size()) / 3;
+		// without indices every vertex is its own cache miss
+		stats.cacheMissesBefore = indices.empty() ? vertices.size() : countCacheMisses(indices, vertices.size());
+
+		deduplicate(vertices, indices);
+		optimizeVertexCache(indices, vertices.size());
+		optimizeVertexFetch(vertices, indices);
+
+		stats.verticesAfter = vertices.size();
+		stats.cacheMissesAfter = countCacheMisses(indices, vertices.size());
+		return stats;
+	}
+}
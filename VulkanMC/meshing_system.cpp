@@ -0,0 +1,84 @@
+#include "meshing_system.hpp"
+
+// std
+#include <algorithm>
+
+namespace vmc {
+	using Clock = std::chrono::steady_clock;
+
+	static float millisecondsBetween(Clock::time_point start, Clock::time_point end) {
+		return std::chrono::duration<float, std::milli>(end - start).count();
+	}
+
+	MeshingSystem::~MeshingSystem() {
+		// jobs hold a pointer to this, so everything has to be finished before the queue goes away
+		for (auto& [pos, token] : cancelTokens) token->store(true, std::memory_order_relaxed);
+		jobSystem.waitIdle();
+	}
+
+	void MeshingSystem::requestMesh(const VmcWorld& world, SectionPos pos, const LodInfo& lod) {
+		auto& token = cancelTokens[pos.chunk()];
+		if (token == nullptr) {
+			token = std::make_shared<std::atomic<bool>>(false);
+		}
+
+		const uint64_t generation = nextGeneration++;
+		latestGeneration[pos] = generation;
+
+		auto input = std::make_unique<MeshInput>();
+		ChunkMesher::gather(world, pos, *input, lod);
+
+		uint32_t solidBlocks = 0;
+		if (const Chunk* chunk = world.getChunk(pos.chunk())) {
+			if (pos.y >= 0 && pos.y < Chunk::SECTION_COUNT) solidBlocks = chunk->getSection(pos.y).getNonAirCount();
+		}
+
+		stats.requested++;
+		const size_t depth = inFlight.fetch_add(1, std::memory_order_relaxed) + 1 + results.size();
+		stats.peakQueueDepth = std::max(stats.peakQueueDepth, depth);
+
+		const Clock::time_point queuedAt = Clock::now();
+		// std::function needs a copyable callable, so the input goes in through a shared_ptr
+		std::shared_ptr<MeshInput> sharedInput = std::move(input);
+		jobSystem.submit([this, sharedInput, token, generation, solidBlocks, queuedAt, ambientOcclusion = ambientOcclusion] {
+			MeshResult result;
+			result.pos = sharedInput->pos;
+			result.generation = generation;
+			result.solidBlocks = solidBlocks;
+			result.cancelled = token;
+
+			const Clock::time_point start = Clock::now();
+			result.queueMs = millisecondsBetween(queuedAt, start);
+			// still pushed when cancelled so the counters on the render thread stay in sync
+			if (!token->load(std::memory_order_relaxed)) {
+				ChunkMesher::mesh(*sharedInput, result.mesh, ambientOcclusion);
+				if (!result.mesh.empty()) result.optimizeStats = VmcModel::optimize(result.mesh.vertices, result.mesh.indices);
+			}
+			result.meshMs = millisecondsBetween(start, Clock::now());
+
+			results.push(std::move(result));
+			inFlight.fetch_sub(1, std::memory_order_relaxed);
+		});
+	}
+
+	bool MeshingSystem::acceptResult(const MeshResult& result) {
+		if (result.cancelled->load(std::memory_order_relaxed)) {
+			stats.cancelled++;
+			return false;
+		}
+
+		auto it = latestGeneration.find(result.pos);
+		if (it == latestGeneration.end() || it->second != result.generation) {
+			stats.superseded++;
+			return false;
+		}
+		latestGeneration.erase(it);
+
+		const float latencyMs = result.queueMs + result.meshMs;
+		stats.completed++;
+		stats.totalLatencyMs += latencyMs;
+		stats.totalMeshMs += result.meshMs;
+		stats.maxLatencyMs = std::max(stats.maxLatencyMs, latencyMs);
+		return true;
+	}
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "chunk_mesher.hpp"
+#include "vmc_job_system.hpp"
+#include "vmc_mpsc_queue.hpp"
+
+// std
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+namespace vmc {
+	struct MeshResult {
+		SectionPos pos{};
+		uint64_t generation = 0;
+		uint32_t solidBlocks = 0;
+		// already deduplicated and in vertex cache order, so it can be uploaded without optimizing again
+		ChunkMeshData mesh;
+		MeshOptimizeStats optimizeStats;
+		std::shared_ptr<std::atomic<bool>> cancelled;
+		// time spent waiting in a worker deque and time spent meshing
+		float queueMs = .0f;
+		float meshMs = .0f;
+	};
+
+	struct MeshingStats {
+		uint64_t requested = 0;
+		uint64_t completed = 0;
+		// results thrown away because the system was shutting down or a newer request for the section came in
+		uint64_t cancelled = 0;
+		uint64_t superseded = 0;
+		size_t peakQueueDepth = 0;
+		double totalLatencyMs = 0.0;
+		float maxLatencyMs = .0f;
+		double totalMeshMs = 0.0;
+
+		double averageLatencyMs() const { return completed == 0 ? 0.0 : totalLatencyMs / completed; }
+		double averageMeshMs() const { return completed == 0 ? 0.0 : totalMeshMs / completed; }
+		// how many sections a single worker gets through
+		double sectionsPerSecond() const { return totalMeshMs == 0.0 ? 0.0 : completed * 1000.0 / totalMeshMs; }
+	};
+
+	// meshes sections on the job system. the world is only read on the calling thread (the section and its border
+	// are copied into a MeshInput before the job is queued), finished meshes come back through a lock free queue and
+	// are handed out on the render thread so gpu buffers are only ever created there
+	class MeshingSystem {
+	public:
+		explicit MeshingSystem(VmcJobSystem& jobSystem) : jobSystem{ jobSystem } {}
+		~MeshingSystem();
+
+		MeshingSystem(const MeshingSystem&) = delete;
+		MeshingSystem& operator=(const MeshingSystem&) = delete;
+
+		// requesting a section that is still being meshed supersedes the older job, which is also how a section
+		// switches to another lod
+		void requestMesh(const VmcWorld& world, SectionPos pos, const LodInfo& lod = LodInfo{});
+		// only applies to meshes requested afterwards
+		void setAmbientOcclusion(bool enabled) { ambientOcclusion = enabled; }
+		bool getAmbientOcclusion() const { return ambientOcclusion; }
+
+		// calls upload(MeshResult&) for up to maxResults finished meshes, returns how many were uploaded. the mesh can be
+		// moved out to upload later
+		template<typename F>
+		size_t drainResults(F&& upload, size_t maxResults = SIZE_MAX) {
+			size_t uploaded = 0;
+			MeshResult result;
+			while (uploaded < maxResults && results.pop(result)) {
+				if (!acceptResult(result)) continue;
+				upload(result);
+				uploaded++;
+			}
+			return uploaded;
+		}
+
+		// jobs that are queued or running plus finished meshes waiting to be drained
+		size_t getQueueDepth() const { return inFlight.load(std::memory_order_relaxed) + results.size(); }
+		bool isIdle() const { return getQueueDepth() == 0; }
+		const MeshingStats& getStats() const { return stats; }
+		void resetStats() { stats = {}; }
+
+	private:
+		bool acceptResult(const MeshResult& result);
+
+		VmcJobSystem& jobSystem;
+		VmcMpscQueue<MeshResult> results;
+		std::atomic<size_t> inFlight{ 0 };
+
+		// everything below is only touched on the thread that requests and drains
+		std::unordered_map<ChunkPos, std::shared_ptr<std::atomic<bool>>, ChunkPosHash> cancelTokens;
+		std::unordered_map<SectionPos, uint64_t, SectionPosHash> latestGeneration;
+		uint64_t nextGeneration = 1;
+		bool ambientOcclusion = true;
+		MeshingStats stats;
+	};
+}
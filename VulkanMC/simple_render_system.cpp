@@ -16,14 +16,19 @@ namespace vmc {
 
 
 	SimpleRenderSystem* app;
-	SimpleRenderSystem::SimpleRenderSystem(VmcDevice& device, VkRenderPass renderPass) : vmcDevice{ device } {
+	SimpleRenderSystem::SimpleRenderSystem(VmcDevice& device, VkRenderPass renderPass, VmcRingBuffer& frameRing, VmcBindlessTextures& textures,
+		VmcPipelineBatch& pipelines, VmcPipelineCompiler& pipelineCompiler)
+		: vmcDevice{ device }, frameRing{ frameRing }, textures{ textures }, pipelineCompiler{ pipelineCompiler }, renderPass{ renderPass } {
 		createPipelineLayout();
-		createPipeline(renderPass);
+		pipelines.add([this, renderPass] { createPipeline(renderPass); });
+		pipelines.add([this, renderPass] { createEntityPipeline(renderPass); });
 		app = this;
 	}
 
 	SimpleRenderSystem::~SimpleRenderSystem() {
 		app = nullptr;
+		// the wireframe job may still be creating its pipeline with this layout
+		if (wireframeRequested) pipelineCompiler.wait(wireframePipeline);
 		vkDestroyPipelineLayout(vmcDevice.device(), pipelineLayout, nullptr);
 	}
 
@@ -32,17 +37,14 @@ namespace vmc {
 	//}
 
 	void SimpleRenderSystem::createPipelineLayout() {
-		VkPushConstantRange pushConstantRange{};
-		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-		pushConstantRange.offset = 0;
-		pushConstantRange.size = sizeof(simplePushConstantData);
-
+		// set 0 is the frame ring, the camera is read from it with a dynamic offset. set 1 holds every texture
+		VkDescriptorSetLayout setLayouts[2] = { frameRing.getDescriptorSetLayout(), textures.getDescriptorSetLayout() };
 		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipelineLayoutInfo.setLayoutCount = 0;
-		pipelineLayoutInfo.pSetLayouts = nullptr;
-		pipelineLayoutInfo.pushConstantRangeCount = 1;
-		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+		pipelineLayoutInfo.setLayoutCount = 2;
+		pipelineLayoutInfo.pSetLayouts = setLayouts;
+		pipelineLayoutInfo.pushConstantRangeCount = 0;
+		pipelineLayoutInfo.pPushConstantRanges = nullptr;
 		if (vkCreatePipelineLayout(vmcDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create pipeline layout");
 		}
@@ -58,5 +60,133 @@ namespace vmc {
 		vmcPipeline = std::make_unique<VmcPipeline>(vmcDevice, "default.vert.spv", "default.frag.spv", pipelineConfig);
 	}
 
+	void SimpleRenderSystem::createEntityPipeline(VkRenderPass renderPass) {
+		PipelineConfigInfo pipelineConfig{};
+		VmcPipeline::defaultPipelineConfigInfo(pipelineConfig);
+		pipelineConfig.bindingDescriptions.push_back(VmcModel::Instance::getBindingDescription());
+		const auto instanceAttributes = VmcModel::Instance::getAttributeDescriptions();
+		pipelineConfig.attributeDescriptions.insert(pipelineConfig.attributeDescriptions.end(), instanceAttributes.begin(), instanceAttributes.end());
+		pipelineConfig.renderPass = renderPass;
+		pipelineConfig.pipelineLayout = pipelineLayout;
+		entityPipeline = std::make_unique<VmcPipeline>(vmcDevice, "entity.vert.spv", "default.frag.spv", pipelineConfig);
+	}
+
+	uint32_t SimpleRenderSystem::writeCamera(const VmcCamera& camera) {
+		// every section shares the same transform since the meshes already hold world positions
+		CameraUniforms uniforms{};
+		uniforms.quaternion = camera.getViewQuaternion();
+		uniforms.translate = camera.getViewTranslate();
+		uniforms.projectionMatrix = camera.getProjectionMatrix();
+		return frameRing.writeUniform(uniforms).offset;
+	}
+
+	void SimpleRenderSystem::beginFrame() {
+		sectionPipeline = wireframe ? &pipelineCompiler.get(wireframePipeline, *vmcPipeline) : vmcPipeline.get();
+	}
+
+	void SimpleRenderSystem::setWireframe(bool enabled) {
+		wireframe = enabled;
+		if (!enabled || wireframeRequested) return;
+		wireframeRequested = true;
+		// same layout and render pass as the solid one, so that one can stand in for it. copied, not read through this
+		// on the worker
+		wireframePipeline = pipelineCompiler.request([&device = vmcDevice, renderPass = renderPass, pipelineLayout = pipelineLayout] {
+			PipelineConfigInfo pipelineConfig{};
+			VmcPipeline::defaultPipelineConfigInfo(pipelineConfig);
+			pipelineConfig.rasterizationInfo.polygonMode = VK_POLYGON_MODE_LINE;
+			pipelineConfig.renderPass = renderPass;
+			pipelineConfig.pipelineLayout = pipelineLayout;
+			return std::make_unique<VmcPipeline>(device, "default.vert.spv", "default.frag.spv", pipelineConfig);
+		});
+	}
+
+	void SimpleRenderSystem::bindSections(VkCommandBuffer commandBuffer, VmcMeshArena& meshArena, uint32_t cameraOffset) {
+		sectionPipeline->bind(commandBuffer);
+		frameRing.bind(commandBuffer, pipelineLayout, 0, cameraOffset);
+		// the only texture binding of the pass, sections just pick their layer
+		textures.bind(commandBuffer, pipelineLayout, 1);
+		meshArena.bind(commandBuffer);
+	}
+
+	void SimpleRenderSystem::renderSections(VkCommandBuffer& commandBuffer, const std::vector<const SectionMesh*>& sections, VmcMeshArena& meshArena, const VmcCamera& camera) {
+		renderSectionRange(commandBuffer, sections, 0, sections.size(), meshArena, writeCamera(camera));
+	}
 
+	void SimpleRenderSystem::renderSectionRange(VkCommandBuffer commandBuffer, const std::vector<const SectionMesh*>& sections, size_t first, size_t last,
+		VmcMeshArena& meshArena, uint32_t cameraOffset) {
+		bindSections(commandBuffer, meshArena, cameraOffset);
+		for (size_t i = first; i < last; i++) {
+			meshArena.draw(commandBuffer, sections[i]->mesh);
+		}
+	}
+
+	void SimpleRenderSystem::renderSectionsIndirect(VkCommandBuffer& commandBuffer, GpuCullingSystem& gpuCulling, VmcMeshArena& meshArena, const VmcCamera& camera, int frameIndex,
+		CullPhase phase) {
+		bindSections(commandBuffer, meshArena, writeCamera(camera));
+		gpuCulling.drawVisible(commandBuffer, frameIndex, phase);
+	}
+
+	void SimpleRenderSystem::writeEntityInstances() {
+		// counting sort, so every group ends up in one run of instances
+		entityGroups.assign(entityModels.size(), EntityGroup{});
+		for (const auto& [model, group] : entityModels) entityGroups[group].model = model;
+		for (uint32_t group : entityGroupOf) entityGroups[group].count++;
+		uint32_t first = 0;
+		for (EntityGroup& group : entityGroups) {
+			group.first = first;
+			first += group.count;
+		}
+		const uint32_t count = static_cast<uint32_t>(visibleInstances.size());
+		entityOrder.resize(count);
+		std::vector<uint32_t> cursors(entityGroups.size());
+		for (size_t group = 0; group < entityGroups.size(); group++) cursors[group] = entityGroups[group].first;
+		for (uint32_t i = 0; i < count; i++) entityOrder[cursors[entityGroupOf[i]]++] = i;
+
+		entityStats.frames++;
+		entityStats.entities += count;
+		entityStats.draws += entityGroups.size();
+
+		if (entityOcclusion != nullptr) {
+			for (EntityGroup& group : entityGroups) {
+				group.occlusionGroup = entityOcclusion->addEntityGroup(group.model->getIndexCount());
+				for (uint32_t i = group.first; i < group.first + group.count; i++) {
+					entityOcclusion->addEntity(visibleBounds[entityOrder[i]], visibleInstances[entityOrder[i]]);
+				}
+			}
+			return;
+		}
+
+		if (count == 0) return;
+		const RingAllocation allocation = frameRing.allocateVertices(sizeof(VmcModel::Instance) * VkDeviceSize{ count });
+		VmcModel::Instance* instances = static_cast<VmcModel::Instance*>(allocation.data);
+		for (uint32_t i = 0; i < count; i++) instances[i] = visibleInstances[entityOrder[i]];
+		entityInstanceOffset = allocation.offset;
+	}
+
+	void SimpleRenderSystem::renderEntities(VkCommandBuffer& commandBuffer, int frameIndex, CullPhase phase) {
+		// without occlusion everything is drawn in the first phase
+		if (entityGroups.empty() || (entityOcclusion == nullptr && phase == CullPhase::Second)) return;
+		const auto start = std::chrono::steady_clock::now();
+
+		// the instances are already relative to the camera, so only the projection is used
+		entityPipeline->bind(commandBuffer);
+		CameraUniforms uniforms{};
+		uniforms.projectionMatrix = entityProjection;
+		frameRing.bind(commandBuffer, pipelineLayout, 0, frameRing.writeUniform(uniforms).offset);
+		textures.bind(commandBuffer, pipelineLayout, 1);
+		for (const EntityGroup& group : entityGroups) {
+			group.model->bind(commandBuffer);
+			if (entityOcclusion != nullptr) {
+				// the instance count is whatever survived the occlusion test in this phase
+				entityOcclusion->drawEntityGroup(commandBuffer, frameIndex, group.occlusionGroup, phase);
+			}
+			else {
+				const VkDeviceSize offset = entityInstanceOffset + sizeof(VmcModel::Instance) * VkDeviceSize{ group.first };
+				const VkBuffer ringBuffer = frameRing.getBuffer();
+				vkCmdBindVertexBuffers(commandBuffer, 1, 1, &ringBuffer, &offset);
+				group.model->drawInstanced(commandBuffer, group.count);
+			}
+		}
+		entityStats.cpuMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
 }
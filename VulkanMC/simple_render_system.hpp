@@ -1,63 +1,192 @@
 #pragma once
 
 #include "vmc_pipeline.hpp"
+#include "vmc_pipeline_compiler.hpp"
+#include "vmc_bindless_textures.hpp"
 #include "vmc_device.hpp"
 #include "vmc_model.hpp"
 #include "vmc_camera.hpp"
+#include "chunk_mesher.hpp"
+#include "gpu_culling_system.hpp"
+#include "vmc_mesh_arena.hpp"
+#include "vmc_ring_buffer.hpp"
 
 #include "types.hpp"
 #include <entt/entt.hpp>
 // std
+#include <chrono>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 
 namespace vmc {
-	struct simplePushConstantData {
-		glm::vec4 quaternion{};
-		alignas(16) glm::vec4 translate{};
-		alignas(16) glm::mat4 projectionMatrix{};
-		glm::vec3 color{};
+	// matches Camera in default.vert and entity.vert, std140. written to the frame ring once per pass
+	struct CameraUniforms {
+		glm::vec4 quaternion{ .0f, .0f, .0f, 1.f };
+		glm::vec4 translate{ .0f, .0f, .0f, 1.f };
+		glm::mat4 projectionMatrix{ 1.f };
 	};
+	struct EntityRenderStats {
+		uint64_t frames = 0;
+		uint64_t entities = 0;
+		uint64_t draws = 0;
+		// culling, grouping, writing the instances and recording the draws
+		float cpuMs = .0f;
+
+		double averageCpuMs() const { return frames == 0 ? 0.0 : cpuMs / frames; }
+	};
+
 	class SimpleRenderSystem {
 	public:
-		SimpleRenderSystem(VmcDevice& device, VkRenderPass renderPass);
+		// the camera and the entity instances of every frame go through frameRing, textures are sampled out of the
+		// bindless set. the pipelines are added to pipelines and nothing can be drawn until it has been built, ones for
+		// other render states come from pipelineCompiler
+		SimpleRenderSystem(VmcDevice& device, VkRenderPass renderPass, VmcRingBuffer& frameRing, VmcBindlessTextures& textures,
+			VmcPipelineBatch& pipelines, VmcPipelineCompiler& pipelineCompiler);
 		~SimpleRenderSystem();
 
 		SimpleRenderSystem(const SimpleRenderSystem&) = delete;
 		SimpleRenderSystem& operator=(const SimpleRenderSystem&) = delete;
 
+		// entities are culled against the camera's view frustum, each one is bounded by a box around the sphere its
+		// model can rotate in. the visible ones are grouped by model and their instances written out for this frame,
+		// with occlusion they are handed to gpu culling instead, so this has to run after GpuCullingSystem::clearEntities and
+		// before GpuCullingSystem::cull
 		template<typename... Args>
-		void renderEntities(VkCommandBuffer& commandBuffer, entt::registry& registry, const VmcCamera& camera) {
-			vmcPipeline->bind(commandBuffer);
+		void cullEntities(entt::registry& registry, const VmcCamera& camera, GpuCullingSystem* occlusion = nullptr) {
+			const auto start = std::chrono::steady_clock::now();
+			entityCullStats = {};
+			entityOcclusion = occlusion;
+			entityProjection = camera.getProjectionMatrix();
+			entityModels.clear();
+			lastEntityModel = nullptr;
+			entityGroupOf.clear();
+			visibleInstances.clear();
+			visibleBounds.clear();
 			([&]
 				{
 					auto views = registry.view<Args, Transform>();
+					entityCuller.clear();
+					culledEntities.clear();
+					entityBounds.clear();
 					for (auto& entity : views) {
+						auto& obj = views.get<Args>(entity);
+						auto& transform = views.get<Transform>(entity);
+						const Aabb& bounds = obj.model->getBounds();
+						const float radius = transform.translation.w * glm::length(glm::max(glm::abs(bounds.min), glm::abs(bounds.max)));
+						const glm::vec3 center{ transform.translation };
+						entityBounds.push_back({ center - radius, center + radius });
+						entityCuller.add(entityBounds.back());
+						culledEntities.push_back(entity);
+					}
+
+					const CullStats stats = entityCuller.cull(camera.getViewFrustum(), visibleEntities);
+					entityCullStats.tested += stats.tested;
+					entityCullStats.visible += stats.visible;
 
+					for (uint32_t index : visibleEntities) {
+						const entt::entity entity = culledEntities[index];
 						auto& obj = views.get<Args>(entity);
 						auto& transform = views.get<Transform>(entity);
 						//auto const& gravity = views.get<Gravity>(entity);
-						simplePushConstantData push{};
-						push.color = obj.color;
-						push.quaternion = transform.getQuaternion(0.01f);
-						push.translate = transform.translation;
-						push.projectionMatrix = camera.getProjectionMatrix();
-
-						vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(simplePushConstantData), &push);
-						obj.model->bind(commandBuffer);
-						obj.model->draw(commandBuffer);
+						VmcModel::Instance instance;
+						instance.quaternion = transform.getQuaternion(0.01f);
+						instance.translate = transform.translation;
+						instance.color = glm::vec4{ obj.color, 1.f };
+						entityGroupOf.push_back(entityGroup(obj.model.get()));
+						visibleInstances.push_back(instance);
+						visibleBounds.push_back(entityBounds[index]);
 					}
 
 				} (), ...);
+			writeEntityInstances();
+			entityStats.cpuMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
 		}
+
+		// picks the pipeline sections are drawn with this frame, before any of them are recorded
+		void beginFrame();
+		// sections are drawn solid until the wireframe pipeline has been compiled, the first call asks for it
+		void setWireframe(bool enabled);
+		bool getWireframe() const { return wireframe; }
+
+		// one instanced draw per model for what cullEntities left, with occlusion once per phase
+		void renderEntities(VkCommandBuffer& commandBuffer, int frameIndex, CullPhase phase = CullPhase::First);
+
+		// section meshes are built in world space and drawn with the camera's view transform out of the mesh arena,
+		// which is bound once. the list should already be culled
+		void renderSections(VkCommandBuffer& commandBuffer, const std::vector<const SectionMesh*>& sections, VmcMeshArena& meshArena, const VmcCamera& camera);
+		// the camera uniforms for this frame, returns their offset in the frame ring. not thread safe
+		uint32_t writeCamera(const VmcCamera& camera);
+		// sections [first, last) with the camera written by writeCamera. only records into the command buffer, so
+		// several threads can call it at once with their own
+		void renderSectionRange(VkCommandBuffer commandBuffer, const std::vector<const SectionMesh*>& sections, size_t first, size_t last, VmcMeshArena& meshArena,
+			uint32_t cameraOffset);
+		// draws whatever gpu culling found visible in the given phase with a single indirect draw
+		void renderSectionsIndirect(VkCommandBuffer& commandBuffer, GpuCullingSystem& gpuCulling, VmcMeshArena& meshArena, const VmcCamera& camera, int frameIndex,
+			CullPhase phase = CullPhase::First);
+
+		const CullStats& getEntityCullStats() const { return entityCullStats; }
+		// summed over the frames since the last reset
+		const EntityRenderStats& getEntityStats() const { return entityStats; }
+		void resetEntityStats() { entityStats = {}; }
 	private:
+		struct EntityGroup {
+			VmcModel* model;
+			uint32_t first;
+			uint32_t count;
+			uint32_t occlusionGroup;
+		};
+
+		uint32_t entityGroup(VmcModel* model) {
+			// entities of the same kind tend to come in runs, so the map is only touched when the model changes
+			if (model == lastEntityModel) return lastEntityGroup;
+			auto [it, inserted] = entityModels.emplace(model, static_cast<uint32_t>(entityModels.size()));
+			lastEntityModel = model;
+			lastEntityGroup = it->second;
+			return it->second;
+		}
+		// sorts the visible instances by group into the frame ring, or gpu culling's buffer
+		void writeEntityInstances();
+		void bindSections(VkCommandBuffer commandBuffer, VmcMeshArena& meshArena, uint32_t cameraOffset);
 		void createPipelineLayout();
 		void createPipeline(VkRenderPass renderPass);
+		void createEntityPipeline(VkRenderPass renderPass);
 
 		VmcDevice& vmcDevice;
+		VmcRingBuffer& frameRing;
+		VmcBindlessTextures& textures;
+		VmcPipelineCompiler& pipelineCompiler;
+		VkRenderPass renderPass;
 
 		std::unique_ptr<VmcPipeline> vmcPipeline;
+		// vmcPipeline until wireframe is on and its pipeline is ready
+		VmcPipeline* sectionPipeline = nullptr;
+		bool wireframe = false;
+		bool wireframeRequested = false;
+		VmcPipelineCompiler::Handle wireframePipeline = 0;
+		// reads a transform and color per instance from binding 1
+		std::unique_ptr<VmcPipeline> entityPipeline;
 		VkPipelineLayout pipelineLayout;
+
+		VmcFrustumCuller entityCuller;
+		std::vector<entt::entity> culledEntities;
+		std::vector<uint32_t> visibleEntities;
+		std::vector<Aabb> entityBounds;
+		std::unordered_map<VmcModel*, uint32_t> entityModels;
+		VmcModel* lastEntityModel = nullptr;
+		uint32_t lastEntityGroup = 0;
+		std::vector<uint32_t> entityGroupOf;
+		std::vector<VmcModel::Instance> visibleInstances;
+		std::vector<Aabb> visibleBounds;
+		std::vector<EntityGroup> entityGroups;
+		// visible entities in group order
+		std::vector<uint32_t> entityOrder;
+		// where this frame's instances start in the ring when there is no gpu culling
+		uint32_t entityInstanceOffset = 0;
+		glm::mat4 entityProjection{ 1.f };
+		GpuCullingSystem* entityOcclusion = nullptr;
+		CullStats entityCullStats;
+		EntityRenderStats entityStats;
 	};
 }
@@ -0,0 +1,162 @@
+#include "terrain_generator.hpp"
+
+// std
+#include <array>
+#include <vector>
+
+namespace vmc {
+	// every noise field gets its own seed so they don't line up with each other
+	static uint32_t deriveSeed(uint32_t seed, uint32_t salt) {
+		uint32_t h = seed ^ (salt * 0x9e3779b9u);
+		h ^= h >> 16;
+		h *= 0x85ebca6bu;
+		h ^= h >> 13;
+		return h;
+	}
+
+	TerrainGenerator::TerrainGenerator(uint32_t seed, const TerrainSettings& settings)
+		: seed{ seed },
+		settings{ settings },
+		heightNoise{ deriveSeed(seed, 1) },
+		overhangNoise{ deriveSeed(seed, 2) },
+		caveNoiseA{ deriveSeed(seed, 3) },
+		caveNoiseB{ deriveSeed(seed, 4) } {}
+
+	void TerrainGenerator::setSimdLevel(SimdLevel level) {
+		heightNoise.setSimdLevel(level);
+		overhangNoise.setSimdLevel(level);
+		caveNoiseA.setSimdLevel(level);
+		caveNoiseB.setSimdLevel(level);
+	}
+
+	std::unique_ptr<Chunk> TerrainGenerator::generate(ChunkPos pos) const {
+		constexpr int N = ChunkSection::SIZE;
+		const int originX = pos.x * N;
+		const int originZ = pos.z * N;
+
+		// heightmap at the grid columns
+		std::array<float, GRID_XZ * GRID_XZ> columnX, columnZ, heights;
+		for (int z = 0; z < GRID_XZ; z++) {
+			for (int x = 0; x < GRID_XZ; x++) {
+				columnX[z * GRID_XZ + x] = static_cast<float>(originX + x * CELL_XZ);
+				columnZ[z * GRID_XZ + x] = static_cast<float>(originZ + z * CELL_XZ);
+			}
+		}
+		heightNoise.fractal2D(columnX.data(), columnZ.data(), heights.data(), heights.size(), settings.heightNoise);
+
+		// 3d noise at the grid points, a few hundred evaluations instead of one per block
+		std::array<float, GRID_VOLUME> gridX, gridY, gridZ, density, caveA, caveB;
+		for (int y = 0; y < GRID_Y; y++) {
+			for (int z = 0; z < GRID_XZ; z++) {
+				for (int x = 0; x < GRID_XZ; x++) {
+					const int i = gridIndex(x, y, z);
+					gridX[i] = columnX[z * GRID_XZ + x];
+					gridY[i] = static_cast<float>(y * CELL_Y);
+					gridZ[i] = columnZ[z * GRID_XZ + x];
+				}
+			}
+		}
+		overhangNoise.fractal3D(gridX.data(), gridY.data(), gridZ.data(), density.data(), density.size(), settings.overhangNoise);
+		caveNoiseA.fractal3D(gridX.data(), gridY.data(), gridZ.data(), caveA.data(), caveA.size(), settings.caveNoise);
+		caveNoiseB.fractal3D(gridX.data(), gridY.data(), gridZ.data(), caveB.data(), caveB.size(), settings.caveNoise);
+
+		// positive density is solid: distance below the surface in units of overhangStrength, plus the 3d noise
+		const float invStrength = 1.f / settings.overhangStrength;
+		for (int y = 0; y < GRID_Y; y++) {
+			for (int c = 0; c < GRID_XZ * GRID_XZ; c++) {
+				const float surface = static_cast<float>(settings.baseHeight) + heights[c] * settings.heightAmplitude;
+				density[y * GRID_XZ * GRID_XZ + c] += (surface - static_cast<float>(y * CELL_Y)) * invStrength;
+			}
+		}
+
+		// blocks for the whole column laid out section after section, which is just (y << 8) | (z << 4) | x
+		std::vector<BlockId> blocks(static_cast<size_t>(Chunk::HEIGHT) * ChunkSection::AREA, BLOCK_AIR);
+		std::array<float, GRID_Y> columnDensity, columnCaveA, columnCaveB;
+
+		for (int z = 0; z < N; z++) {
+			for (int x = 0; x < N; x++) {
+				// bilinear blend of the four grid columns around this block column
+				const int gx = x / CELL_XZ;
+				const int gz = z / CELL_XZ;
+				const float tx = static_cast<float>(x % CELL_XZ) / CELL_XZ;
+				const float tz = static_cast<float>(z % CELL_XZ) / CELL_XZ;
+				auto blend = [&](const std::array<float, GRID_VOLUME>& field, int gy) {
+					const float v00 = field[gridIndex(gx, gy, gz)];
+					const float v10 = field[gridIndex(gx + 1, gy, gz)];
+					const float v01 = field[gridIndex(gx, gy, gz + 1)];
+					const float v11 = field[gridIndex(gx + 1, gy, gz + 1)];
+					const float a = v00 + (v10 - v00) * tx;
+					const float b = v01 + (v11 - v01) * tx;
+					return a + (b - a) * tz;
+				};
+				for (int gy = 0; gy < GRID_Y; gy++) {
+					columnDensity[gy] = blend(density, gy);
+					columnCaveA[gy] = blend(caveA, gy);
+					columnCaveB[gy] = blend(caveB, gy);
+				}
+
+				// walk down the column so each solid block knows how deep below the last open air it is
+				bool reachedGround = false;
+				int depth = 0;
+				BlockId topBlock = BLOCK_GRASS;
+				for (int y = Chunk::HEIGHT - 1; y >= 0; y--) {
+					const int gy = y / CELL_Y;
+					const float ty = static_cast<float>(y % CELL_Y) / CELL_Y;
+					const float d = columnDensity[gy] + (columnDensity[gy + 1] - columnDensity[gy]) * ty;
+					BlockId& block = blocks[(static_cast<size_t>(y) << 8) | (z << 4) | x];
+
+					if (y == 0) {
+						block = BLOCK_BEDROCK;
+						continue;
+					}
+
+					if (d <= .0f) {
+						// open air, anything at or below sea level that the sky can see is ocean
+						if (!reachedGround && y <= settings.seaLevel) block = BLOCK_WATER;
+						depth = 0;
+						continue;
+					}
+
+					if (y >= settings.caveMinY) {
+						const float a = columnCaveA[gy] + (columnCaveA[gy + 1] - columnCaveA[gy]) * ty;
+						const float b = columnCaveB[gy] + (columnCaveB[gy + 1] - columnCaveB[gy]) * ty;
+						// carved blocks don't reset depth, otherwise every cave floor would grow grass
+						if (a * a + b * b < settings.caveThreshold) continue;
+					}
+
+					if (depth == 0) {
+						topBlock = y <= settings.seaLevel + 1 ? BLOCK_SAND : BLOCK_GRASS;
+						block = topBlock;
+					}
+					else if (depth <= 3) {
+						block = topBlock == BLOCK_SAND ? BLOCK_SAND : BLOCK_DIRT;
+					}
+					else {
+						block = BLOCK_STONE;
+					}
+					reachedGround = true;
+					depth++;
+				}
+			}
+		}
+
+		auto chunk = std::make_unique<Chunk>(pos);
+		for (int s = 0; s < Chunk::SECTION_COUNT; s++) {
+			chunk->getSection(s).pack(&blocks[static_cast<size_t>(s) * ChunkSection::VOLUME]);
+		}
+		return chunk;
+	}
+
+	uint64_t TerrainGenerator::checksum(const Chunk& chunk) {
+		uint64_t hash = 0xcbf29ce484222325ull;
+		std::array<BlockId, ChunkSection::VOLUME> blocks;
+		chunk.forEachSection([&](int, const ChunkSection& section) {
+			section.unpack(blocks.data());
+			for (BlockId id : blocks) {
+				hash = (hash ^ (id & 0xff)) * 0x100000001b3ull;
+				hash = (hash ^ (id >> 8)) * 0x100000001b3ull;
+			}
+		});
+		return hash;
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "vmc_chunk.hpp"
+#include "vmc_noise.hpp"
+
+// std
+#include <cstdint>
+#include <memory>
+
+namespace vmc {
+	struct TerrainSettings {
+		int seaLevel = 62;
+		int baseHeight = 74;
+		float heightAmplitude = 48.f;
+		FractalSettings heightNoise{ 5, 1.f / 256.f };
+		// 3d noise added on top of the heightmap, overhangStrength is how many blocks of height one unit of noise is worth
+		FractalSettings overhangNoise{ 3, 1.f / 48.f };
+		float overhangStrength = 12.f;
+		// caves are carved where two independent noise fields are both close to zero, which gives long tunnels
+		FractalSettings caveNoise{ 2, 1.f / 64.f };
+		float caveThreshold = .004f;
+		int caveMinY = 6;
+	};
+
+	// generates chunk columns from a 2d heightmap plus 3d density noise. the 3d noise is only sampled on a coarse
+	// grid (every CELL_XZ blocks horizontally and CELL_Y vertically) and trilinearly interpolated in between.
+	// generate() only depends on the seed and the chunk position, so chunks can be built on any thread in any order
+	class TerrainGenerator {
+	public:
+		static constexpr int CELL_XZ = 4;
+		static constexpr int CELL_Y = 8;
+		static constexpr int GRID_XZ = ChunkSection::SIZE / CELL_XZ + 1;
+		static constexpr int GRID_Y = Chunk::HEIGHT / CELL_Y + 1;
+		static constexpr int GRID_VOLUME = GRID_XZ * GRID_Y * GRID_XZ;
+
+		explicit TerrainGenerator(uint32_t seed, const TerrainSettings& settings = TerrainSettings{});
+
+		std::unique_ptr<Chunk> generate(ChunkPos pos) const;
+
+		// fnv-1a over every block of the chunk, for checking that two runs produced the same terrain
+		static uint64_t checksum(const Chunk& chunk);
+
+		uint32_t getSeed() const { return seed; }
+		SimdLevel getSimdLevel() const { return heightNoise.getSimdLevel(); }
+		void setSimdLevel(SimdLevel level);
+
+	private:
+		static int gridIndex(int x, int y, int z) { return (y * GRID_XZ + z) * GRID_XZ + x; }
+
+		uint32_t seed;
+		TerrainSettings settings;
+		VmcNoise heightNoise;
+		VmcNoise overhangNoise;
+		VmcNoise caveNoiseA;
+		VmcNoise caveNoiseB;
+	};
+}
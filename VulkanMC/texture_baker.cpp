@@ -0,0 +1,162 @@
+#include "texture_baker.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+namespace vmc {
+	static const std::array<float, 256>& srgbToLinearTable() {
+		static const std::array<float, 256> table = [] {
+			std::array<float, 256> values{};
+			for (int i = 0; i < 256; i++) {
+				const float srgb = i / 255.f;
+				values[i] = srgb <= .04045f ? srgb / 12.92f : std::pow((srgb + .055f) / 1.055f, 2.4f);
+			}
+			return values;
+		}();
+		return table;
+	}
+
+	static uint8_t linearToSrgb(float linear) {
+		linear = std::clamp(linear, 0.f, 1.f);
+		const float srgb = linear <= .0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.f / 2.4f) - .055f;
+		return static_cast<uint8_t>(srgb * 255.f + .5f);
+	}
+
+	// share of the texels that pass the cutoff once their alpha is scaled
+	static float alphaCoverage(const std::vector<uint8_t>& texels, float scale) {
+		size_t covered = 0;
+		const size_t count = texels.size() / 4;
+		for (size_t i = 0; i < count; i++) {
+			if (texels[i * 4 + 3] * scale >= BcEncoder::ALPHA_CUTOFF) covered++;
+		}
+		return static_cast<float>(covered) / count;
+	}
+
+	// the 2x2 texels under each texel of the next level, averaged in linear space. with cut out texels the colors are
+	// weighted by alpha, so the invisible ones don't bleed into the edges
+	static std::vector<uint8_t> downsample(const std::vector<uint8_t>& texels, uint32_t width, uint32_t height, bool cutout) {
+		const std::array<float, 256>& toLinear = srgbToLinearTable();
+		const uint32_t nextWidth = std::max(1u, width / 2);
+		const uint32_t nextHeight = std::max(1u, height / 2);
+		std::vector<uint8_t> next(size_t{ nextWidth } * nextHeight * 4);
+		for (uint32_t y = 0; y < nextHeight; y++) {
+			for (uint32_t x = 0; x < nextWidth; x++) {
+				float color[3]{};
+				float alpha = .0f;
+				float weight = .0f;
+				for (uint32_t dy = 0; dy < 2; dy++) {
+					for (uint32_t dx = 0; dx < 2; dx++) {
+						const uint8_t* texel = &texels[(size_t{ std::min(y * 2 + dy, height - 1) } * width + std::min(x * 2 + dx, width - 1)) * 4];
+						const float a = texel[3] / 255.f;
+						const float w = cutout ? a : 1.f;
+						for (int c = 0; c < 3; c++) color[c] += toLinear[texel[c]] * w;
+						alpha += a;
+						weight += w;
+					}
+				}
+				uint8_t* out = &next[(size_t{ y } * nextWidth + x) * 4];
+				for (int c = 0; c < 3; c++) out[c] = weight > .0f ? linearToSrgb(color[c] / weight) : 0;
+				out[3] = static_cast<uint8_t>(alpha / 4.f * 255.f + .5f);
+			}
+		}
+		return next;
+	}
+
+	std::vector<std::vector<uint8_t>> TextureBaker::buildMipChain(const uint8_t* texels, uint32_t width, uint32_t height) {
+		std::vector<std::vector<uint8_t>> levels;
+		levels.emplace_back(texels, texels + size_t{ width } * height * 4);
+		bool cutout = false;
+		for (size_t i = 3; i < levels[0].size(); i += 4) cutout |= levels[0][i] < 255;
+		const float coverage = cutout ? alphaCoverage(levels[0], 1.f) : .0f;
+
+		while (width > 1 || height > 1) {
+			std::vector<uint8_t> next = downsample(levels.back(), width, height, cutout);
+			width = std::max(1u, width / 2);
+			height = std::max(1u, height / 2);
+
+			if (cutout) {
+				// averaging pulls the alpha of thin features under the cutoff, so they would thin out and vanish with
+				// distance. the smallest scale that keeps the coverage of the top level is found by bisection
+				float low = .0f;
+				float high = 8.f;
+				for (int i = 0; i < 16; i++) {
+					const float mid = (low + high) / 2.f;
+					if (alphaCoverage(next, mid) < coverage) {
+						low = mid;
+					}
+					else {
+						high = mid;
+					}
+				}
+				for (size_t i = 3; i < next.size(); i += 4) next[i] = static_cast<uint8_t>(std::min(255.f, next[i] * high + .5f));
+			}
+			levels.push_back(std::move(next));
+		}
+		return levels;
+	}
+
+	TextureBakeStats TextureBaker::bake(const std::vector<uint8_t>& pixels, uint32_t size, uint32_t layerCount, const TextureBakeOptions& options) {
+		using Clock = std::chrono::steady_clock;
+		const Clock::time_point start = Clock::now();
+		const size_t layerTexels = size_t{ size } * size * 4;
+		if (pixels.size() != layerTexels * layerCount) throw std::runtime_error("texture layers don't match their size");
+
+		std::vector<std::vector<std::vector<uint8_t>>> chains(layerCount);
+		for (uint32_t layer = 0; layer < layerCount; layer++) {
+			jobSystem.submit([&chains, &pixels, layer, layerTexels, size] { chains[layer] = buildMipChain(&pixels[layer * layerTexels], size, size); });
+		}
+		jobSystem.waitIdle();
+		const Clock::time_point mipsDone = Clock::now();
+
+		Ktx2Image image;
+		image.format = options.format == BcFormat::BC1 ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC7_SRGB_BLOCK;
+		image.width = size;
+		image.height = size;
+		image.layerCount = layerCount;
+		const uint32_t levelCount = static_cast<uint32_t>(chains[0].size());
+		image.levels.resize(levelCount);
+
+		TextureBakeStats stats;
+		stats.layers = layerCount;
+		stats.levels = levelCount;
+		for (uint32_t level = 0; level < levelCount; level++) {
+			const uint32_t levelSize = std::max(1u, size >> level);
+			const uint64_t layerBytes = BcEncoder::imageBytes(options.format, levelSize, levelSize);
+			image.levels[level].resize(static_cast<size_t>(layerBytes * layerCount));
+			stats.blocks += layerBytes / BcEncoder::blockBytes(options.format) * layerCount;
+			stats.sourceBytes += uint64_t{ 4 } * levelSize * levelSize * layerCount;
+
+			for (uint32_t layer = 0; layer < layerCount; layer++) {
+				uint8_t* out = &image.levels[level][static_cast<size_t>(layerBytes * layer)];
+				const uint8_t* texels = chains[layer][level].data();
+				const BcFormat format = options.format;
+				jobSystem.submit([format, texels, levelSize, out] {
+					const uint32_t blocks = (levelSize + BcEncoder::BLOCK_SIZE - 1) / BcEncoder::BLOCK_SIZE;
+					for (uint32_t by = 0; by < blocks; by++) {
+						for (uint32_t bx = 0; bx < blocks; bx++) {
+							BcEncoder::encodeImageBlock(format, texels, levelSize, levelSize, bx, by, out + (size_t{ by } * blocks + bx) * BcEncoder::blockBytes(format));
+						}
+					}
+				});
+			}
+		}
+		jobSystem.waitIdle();
+		const Clock::time_point encodeDone = Clock::now();
+
+		if (!VmcKtx2File::write(options.outputPath, image, "VulkanMC texture baker")) {
+			throw std::runtime_error("failed to write " + options.outputPath);
+		}
+		std::ifstream file(options.outputPath, std::ios::binary | std::ios::ate);
+		stats.fileBytes = static_cast<uint64_t>(file.tellg());
+
+		stats.mipMs = std::chrono::duration<double, std::milli>(mipsDone - start).count();
+		stats.encodeMs = std::chrono::duration<double, std::milli>(encodeDone - mipsDone).count();
+		stats.totalMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		return stats;
+	}
+}
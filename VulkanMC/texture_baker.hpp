@@ -0,0 +1,49 @@
+#pragma once
+
+#include "bc_encoder.hpp"
+#include "vmc_job_system.hpp"
+#include "vmc_ktx2_file.hpp"
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vmc {
+	struct TextureBakeOptions {
+		std::string outputPath;
+		BcFormat format = BcFormat::BC7;
+	};
+
+	struct TextureBakeStats {
+		uint32_t layers = 0;
+		uint32_t levels = 0;
+		uint64_t blocks = 0;
+		// the rgba8 texels of every level, what the engine would have to upload without the bake
+		uint64_t sourceBytes = 0;
+		uint64_t fileBytes = 0;
+		double mipMs = 0.0;
+		double encodeMs = 0.0;
+		double totalMs = 0.0;
+
+		double compressionRatio() const { return fileBytes == 0 ? 0.0 : static_cast<double>(sourceBytes) / fileBytes; }
+	};
+
+	// turns texture layers into a ktx2 file the engine can upload without touching it: a mip chain is built for every
+	// layer on the cpu and each level is block compressed, one job per layer and level. run with --bake-textures next
+	// to the game, which picks the file up on its next start
+	class TextureBaker {
+	public:
+		explicit TextureBaker(VmcJobSystem& jobSystem) : jobSystem{ jobSystem } {}
+
+		// layers are size x size rgba8 texels in srgb, one after the other. throws when the file can't be written
+		TextureBakeStats bake(const std::vector<uint8_t>& pixels, uint32_t size, uint32_t layerCount, const TextureBakeOptions& options);
+
+		// every level of one layer down to 1x1, level 0 included. filtered in linear space, and when the layer has cut
+		// out texels the alpha of each level is scaled so the same share of it passes the cutoff as at the top
+		static std::vector<std::vector<uint8_t>> buildMipChain(const uint8_t* texels, uint32_t width, uint32_t height);
+
+	private:
+		VmcJobSystem& jobSystem;
+	};
+}
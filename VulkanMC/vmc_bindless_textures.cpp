@@ -0,0 +1,63 @@
+#include "vmc_bindless_textures.hpp"
+
+// std
+#include <stdexcept>
+
+namespace vmc {
+	VmcBindlessTextures::VmcBindlessTextures(VmcDevice& device, VmcDescriptorAllocator& allocator) : vmcDevice{ device } {
+		VkDescriptorSetLayoutBinding binding{};
+		binding.binding = 0;
+		binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		binding.descriptorCount = MAX_TEXTURES;
+		binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+		// slots past the last texture are never written, and the ones that are can change while the set is bound
+		const VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+			VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT;
+		VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{};
+		flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+		flagsInfo.bindingCount = 1;
+		flagsInfo.pBindingFlags = &bindingFlags;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.pNext = &flagsInfo;
+		layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+		layoutInfo.bindingCount = 1;
+		layoutInfo.pBindings = &binding;
+		if (vkCreateDescriptorSetLayout(vmcDevice.device(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create bindless texture descriptor set layout");
+		}
+
+		descriptorSet = allocator.allocate(descriptorSetLayout, MAX_TEXTURES);
+	}
+
+	VmcBindlessTextures::~VmcBindlessTextures() {
+		// the set goes back with the allocator's pools
+		vkDestroyDescriptorSetLayout(vmcDevice.device(), descriptorSetLayout, nullptr);
+	}
+
+	uint32_t VmcBindlessTextures::add(VkImageView imageView, VkSampler sampler) {
+		if (textureCount == MAX_TEXTURES) throw std::runtime_error("out of bindless texture slots");
+
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.sampler = sampler;
+		imageInfo.imageView = imageView;
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = descriptorSet;
+		write.dstBinding = 0;
+		write.dstArrayElement = textureCount;
+		write.descriptorCount = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write.pImageInfo = &imageInfo;
+		vkUpdateDescriptorSets(vmcDevice.device(), 1, &write, 0, nullptr);
+		return textureCount++;
+	}
+
+	void VmcBindlessTextures::bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t set) {
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, set, 1, &descriptorSet, 0, nullptr);
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "vmc_descriptor_allocator.hpp"
+#include "vmc_device.hpp"
+
+// std
+#include <cstdint>
+
+namespace vmc {
+	// every texture the renderer samples, in a single descriptor set with one variable sized array of combined image
+	// samplers. shaders pick a texture by its slot, so the set is bound once per pass and draws never have to rebind
+	// anything. slots are written with update after bind, adding a texture while frames are in flight is fine as long
+	// as nothing draws with it before it was added
+	class VmcBindlessTextures {
+	public:
+		// the size of the array the set is allocated with, textures[] in the shaders
+		static constexpr uint32_t MAX_TEXTURES = 1024;
+
+		VmcBindlessTextures(VmcDevice& device, VmcDescriptorAllocator& allocator);
+		~VmcBindlessTextures();
+
+		VmcBindlessTextures(const VmcBindlessTextures&) = delete;
+		VmcBindlessTextures& operator=(const VmcBindlessTextures&) = delete;
+
+		// returns the slot shaders find it at, the view has to be in SHADER_READ_ONLY_OPTIMAL and outlive its use
+		uint32_t add(VkImageView imageView, VkSampler sampler);
+
+		void bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t set);
+		VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout; }
+		uint32_t getTextureCount() const { return textureCount; }
+
+	private:
+		VmcDevice& vmcDevice;
+		VkDescriptorSetLayout descriptorSetLayout;
+		VkDescriptorSet descriptorSet;
+		uint32_t textureCount = 0;
+	};
+}
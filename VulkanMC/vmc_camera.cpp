@@ -12,6 +12,7 @@ namespace vmc {
 		projectionMatrix[3][0] = -(right + left) / (right - left);
 		projectionMatrix[3][1] = -(bottom + top) / (bottom - top);
 		projectionMatrix[3][2] = -near / (far - near);
+		updateFrustums();
 	}
 
 	void VmcCamera::setPerspectiveProjection(float fovy, float aspect, float near, float far) {
@@ -23,5 +24,27 @@ namespace vmc {
 		projectionMatrix[2][2] = far / (far - near);
 		projectionMatrix[2][3] = 1.f;
 		projectionMatrix[3][2] = -(far * near) / (far - near);
+		updateFrustums();
+	}
+
+	glm::vec3 VmcCamera::rotate(const glm::vec4& q, const glm::vec3& v) {
+		const glm::vec3 axis{ q };
+		return v + 2.f * glm::cross(axis, glm::cross(axis, v) + q.w * v);
+	}
+
+	void VmcCamera::setViewTransform(const glm::vec4& quaternion, const glm::vec4& translate) {
+		viewQuaternion = quaternion;
+		viewTranslate = translate;
+		viewMatrix = glm::mat4{ 1.f };
+		viewMatrix[0] = glm::vec4{ translate.w * rotate(quaternion, { 1.f, .0f, .0f }), .0f };
+		viewMatrix[1] = glm::vec4{ translate.w * rotate(quaternion, { .0f, 1.f, .0f }), .0f };
+		viewMatrix[2] = glm::vec4{ translate.w * rotate(quaternion, { .0f, .0f, 1.f }), .0f };
+		viewMatrix[3] = glm::vec4{ glm::vec3{ translate }, 1.f };
+		updateFrustums();
+	}
+
+	void VmcCamera::updateFrustums() {
+		frustum = Frustum::fromMatrix(projectionMatrix * viewMatrix);
+		viewFrustum = Frustum::fromMatrix(projectionMatrix);
 	}
 }
\ No newline at end of file
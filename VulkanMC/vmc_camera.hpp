@@ -1,5 +1,7 @@
 #pragma once
 
+#include "vmc_frustum.hpp"
+
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
@@ -9,9 +11,27 @@ namespace vmc {
 	public:
 		void setOrthographicProjection(float left, float right, float top, float bottom, float near, float far);
 		void setPerspectiveProjection(float FOVy, float aspectRatio, float near, float far);
+		// the same rotate, scale and translate the vertex shader applies, translate.w is the scale
+		void setViewTransform(const glm::vec4& quaternion, const glm::vec4& translate);
+		// same as qrot in default.vert
+		static glm::vec3 rotate(const glm::vec4& quaternion, const glm::vec3& v);
 
 		const glm::mat4& getProjectionMatrix() const { return projectionMatrix; }
+		const glm::mat4& getViewMatrix() const { return viewMatrix; }
+		const glm::vec4& getViewQuaternion() const { return viewQuaternion; }
+		const glm::vec4& getViewTranslate() const { return viewTranslate; }
+		// in world space, for things drawn with the view transform
+		const Frustum& getFrustum() const { return frustum; }
+		// in view space, for things that are positioned relative to the camera like the entities
+		const Frustum& getViewFrustum() const { return viewFrustum; }
 	private:
+		void updateFrustums();
+
 		glm::mat4 projectionMatrix{ 1.f };
+		glm::mat4 viewMatrix{ 1.f };
+		glm::vec4 viewQuaternion{ .0f, .0f, .0f, 1.f };
+		glm::vec4 viewTranslate{ .0f, .0f, .0f, 1.f };
+		Frustum frustum{};
+		Frustum viewFrustum{};
 	};
 }
\ No newline at end of file
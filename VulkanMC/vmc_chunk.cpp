@@ -0,0 +1,256 @@
+#include "vmc_chunk.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace vmc {
+	// smallest power of two bit width that can address paletteSize entries, returned as log2 of the width
+	static int bitsLog2ForPalette(size_t paletteSize) {
+		int bits = 1;
+		while ((size_t{ 1 } << bits) < paletteSize) bits++;
+		int log2 = 0;
+		while ((1 << log2) < bits) log2++;
+		return log2;
+	}
+
+	void ChunkSection::setBlock(int i, BlockId id) {
+		assert(i >= 0 && i < VOLUME && "Block index out of range");
+		if (bitsLog2 < 0) {
+			if (id == uniformBlock) return;
+
+			// leave the uniform representation, every index starts out pointing at the old block
+			palette.assign({ uniformBlock });
+			bitsLog2 = 0;
+			data.assign(VOLUME / 64, 0);
+		}
+
+		const BlockId old = palette[readIndex(i)];
+		if (old == id) return;
+
+		writeIndex(i, findOrAddPalette(id));
+		if (old == BLOCK_AIR) nonAirCount++;
+		else if (id == BLOCK_AIR) nonAirCount--;
+	}
+
+	void ChunkSection::fill(BlockId id) {
+		bitsLog2 = -1;
+		uniformBlock = id;
+		nonAirCount = id == BLOCK_AIR ? 0 : VOLUME;
+		std::vector<BlockId>().swap(palette);
+		std::vector<uint64_t>().swap(data);
+	}
+
+	void ChunkSection::unpack(BlockId* out) const {
+		if (bitsLog2 < 0) {
+			std::fill(out, out + VOLUME, uniformBlock);
+			return;
+		}
+		const int bits = 1 << bitsLog2;
+		const int perWord = 64 >> bitsLog2;
+		const uint64_t mask = (uint64_t{ 1 } << bits) - 1;
+		for (uint64_t word : data) {
+			for (int j = 0; j < perWord; j++) {
+				*out++ = palette[static_cast<size_t>(word & mask)];
+				word >>= bits;
+			}
+		}
+	}
+
+	void ChunkSection::pack(const BlockId* in) {
+		std::vector<BlockId> newPalette;
+		std::vector<uint16_t> indices(VOLUME);
+		uint32_t count = 0;
+
+		// runs of the same block are very common, so remember the last lookup before searching the palette
+		BlockId lastId = in[0];
+		uint16_t lastIndex = 0;
+		newPalette.push_back(lastId);
+		for (int i = 0; i < VOLUME; i++) {
+			const BlockId id = in[i];
+			if (id != BLOCK_AIR) count++;
+			if (id != lastId) {
+				auto it = std::find(newPalette.begin(), newPalette.end(), id);
+				if (it == newPalette.end()) {
+					newPalette.push_back(id);
+					it = newPalette.end() - 1;
+				}
+				lastId = id;
+				lastIndex = static_cast<uint16_t>(it - newPalette.begin());
+			}
+			indices[i] = lastIndex;
+		}
+
+		if (newPalette.size() == 1) {
+			fill(newPalette[0]);
+			return;
+		}
+
+		palette = std::move(newPalette);
+		bitsLog2 = bitsLog2ForPalette(palette.size());
+		data.assign(static_cast<size_t>(VOLUME >> (6 - bitsLog2)), 0);
+		for (int i = 0; i < VOLUME; i++) writeIndex(i, indices[i]);
+		nonAirCount = count;
+	}
+
+	void ChunkSection::compact() {
+		if (bitsLog2 < 0) return;
+
+		std::vector<uint32_t> usage(palette.size(), 0);
+		for (int i = 0; i < VOLUME; i++) usage[readIndex(i)]++;
+
+		size_t used = 0;
+		for (uint32_t u : usage) {
+			if (u > 0) used++;
+		}
+		if (used == palette.size() && bitsLog2 == bitsLog2ForPalette(palette.size())) return;
+		if (used == 1) {
+			fill(palette[std::find_if(usage.begin(), usage.end(), [](uint32_t u) { return u > 0; }) - usage.begin()]);
+			return;
+		}
+
+		std::vector<BlockId> blocks(VOLUME);
+		unpack(blocks.data());
+		pack(blocks.data());
+		palette.shrink_to_fit();
+	}
+
+	size_t ChunkSection::memoryUsage() const {
+		return palette.capacity() * sizeof(BlockId) + data.capacity() * sizeof(uint64_t);
+	}
+
+	// little endian, which is every platform we build for
+	template<typename T>
+	static void appendValue(std::vector<uint8_t>& out, T value) {
+		const size_t offset = out.size();
+		out.resize(offset + sizeof(T));
+		std::memcpy(out.data() + offset, &value, sizeof(T));
+	}
+
+	template<typename T>
+	static bool readValue(const uint8_t*& cursor, const uint8_t* end, T& value) {
+		if (static_cast<size_t>(end - cursor) < sizeof(T)) return false;
+		std::memcpy(&value, cursor, sizeof(T));
+		cursor += sizeof(T);
+		return true;
+	}
+
+	// uniform sections are 0xff followed by the block, everything else is
+	// bitsLog2, palette size, non air count, palette entries and the packed words
+	void ChunkSection::serialize(std::vector<uint8_t>& out) const {
+		if (bitsLog2 < 0) {
+			appendValue<uint8_t>(out, 0xff);
+			appendValue<BlockId>(out, uniformBlock);
+			return;
+		}
+
+		appendValue<uint8_t>(out, static_cast<uint8_t>(bitsLog2));
+		appendValue<uint16_t>(out, static_cast<uint16_t>(palette.size()));
+		appendValue<uint16_t>(out, static_cast<uint16_t>(nonAirCount));
+		const size_t offset = out.size();
+		out.resize(offset + palette.size() * sizeof(BlockId) + data.size() * sizeof(uint64_t));
+		std::memcpy(out.data() + offset, palette.data(), palette.size() * sizeof(BlockId));
+		std::memcpy(out.data() + offset + palette.size() * sizeof(BlockId), data.data(), data.size() * sizeof(uint64_t));
+	}
+
+	bool ChunkSection::deserialize(const uint8_t*& cursor, const uint8_t* end) {
+		uint8_t storedBits;
+		if (!readValue(cursor, end, storedBits)) return false;
+		if (storedBits == 0xff) {
+			BlockId id;
+			if (!readValue(cursor, end, id)) return false;
+			fill(id);
+			return true;
+		}
+
+		uint16_t paletteSize;
+		uint16_t storedNonAir;
+		// 4096 blocks never need more than 16 bits per entry
+		if (storedBits > 4 || !readValue(cursor, end, paletteSize) || !readValue(cursor, end, storedNonAir)) return false;
+		if (paletteSize == 0 || paletteSize > (1u << (1 << storedBits)) || storedNonAir > VOLUME) return false;
+
+		const size_t wordCount = static_cast<size_t>(VOLUME >> (6 - storedBits));
+		const size_t bytes = paletteSize * sizeof(BlockId) + wordCount * sizeof(uint64_t);
+		if (static_cast<size_t>(end - cursor) < bytes) return false;
+
+		palette.resize(paletteSize);
+		data.resize(wordCount);
+		std::memcpy(palette.data(), cursor, paletteSize * sizeof(BlockId));
+		std::memcpy(data.data(), cursor + paletteSize * sizeof(BlockId), wordCount * sizeof(uint64_t));
+		cursor += bytes;
+		bitsLog2 = storedBits;
+		nonAirCount = storedNonAir;
+
+		// an index past the end of the palette would read out of bounds later, refuse the whole section instead
+		for (int i = 0; i < VOLUME; i++) {
+			if (readIndex(i) >= paletteSize) {
+				fill(BLOCK_AIR);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void ChunkSection::writeIndex(int i, uint32_t paletteIndex) {
+		const int shift = 6 - bitsLog2;
+		const int offset = (i & ((1 << shift) - 1)) << bitsLog2;
+		const uint64_t mask = ((uint64_t{ 1 } << (1 << bitsLog2)) - 1) << offset;
+		uint64_t& word = data[i >> shift];
+		word = (word & ~mask) | ((static_cast<uint64_t>(paletteIndex) << offset) & mask);
+	}
+
+	uint32_t ChunkSection::findOrAddPalette(BlockId id) {
+		for (size_t i = 0; i < palette.size(); i++) {
+			if (palette[i] == id) return static_cast<uint32_t>(i);
+		}
+		palette.push_back(id);
+		const int needed = bitsLog2ForPalette(palette.size());
+		if (needed > bitsLog2) resize(needed);
+		return static_cast<uint32_t>(palette.size() - 1);
+	}
+
+	void ChunkSection::resize(int newBitsLog2) {
+		std::vector<uint32_t> indices(VOLUME);
+		for (int i = 0; i < VOLUME; i++) indices[i] = readIndex(i);
+
+		bitsLog2 = newBitsLog2;
+		data.assign(static_cast<size_t>(VOLUME >> (6 - bitsLog2)), 0);
+		for (int i = 0; i < VOLUME; i++) writeIndex(i, indices[i]);
+	}
+
+	void NibbleArray::set(int i, uint8_t value) {
+		assert(i >= 0 && i < ChunkSection::VOLUME && value <= MAX_LIGHT && "Light index or level out of range");
+		if (data.empty()) {
+			if (value == uniform) return;
+			data.assign(BYTES, static_cast<uint8_t>(uniform | (uniform << 4)));
+		}
+		const int shift = (i & 1) << 2;
+		uint8_t& byte = data[i >> 1];
+		byte = static_cast<uint8_t>((byte & ~(15 << shift)) | (value << shift));
+	}
+
+	void NibbleArray::fill(uint8_t value) {
+		uniform = value;
+		std::vector<uint8_t>().swap(data);
+	}
+
+	void NibbleArray::compact() {
+		if (data.empty()) return;
+		const uint8_t first = data[0] & 15;
+		const uint8_t pair = static_cast<uint8_t>(first | (first << 4));
+		if (std::all_of(data.begin(), data.end(), [pair](uint8_t byte) { return byte == pair; })) fill(first);
+	}
+
+	void Chunk::compact() {
+		for (auto& section : sections) section.compact();
+		for (auto& sectionLight : light) sectionLight.compact();
+	}
+
+	size_t Chunk::memoryUsage() const {
+		size_t bytes = sizeof(Chunk);
+		for (const auto& section : sections) bytes += section.memoryUsage();
+		for (const auto& sectionLight : light) bytes += sectionLight.memoryUsage();
+		return bytes;
+	}
+}
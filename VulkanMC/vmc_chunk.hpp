@@ -0,0 +1,245 @@
+#pragma once
+
+// std
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace vmc {
+	using BlockId = uint16_t;
+
+	enum BlockType : BlockId {
+		BLOCK_AIR = 0,
+		BLOCK_STONE,
+		BLOCK_DIRT,
+		BLOCK_GRASS,
+		BLOCK_SAND,
+		BLOCK_WATER,
+		BLOCK_BEDROCK,
+		BLOCK_GLOWSTONE,
+		BLOCK_COUNT
+	};
+
+	inline bool isSolidBlock(BlockId id) { return id != BLOCK_AIR && id != BLOCK_WATER; }
+
+	static constexpr uint8_t MAX_LIGHT = 15;
+
+	// light a block gives off by itself
+	inline uint8_t lightEmission(BlockId id) { return id == BLOCK_GLOWSTONE ? MAX_LIGHT : 0; }
+	// light lost on top of the 1 every step costs. solid blocks don't let any light in at all
+	inline uint8_t lightAbsorption(BlockId id) { return id == BLOCK_WATER ? 1 : 0; }
+
+	struct ChunkPos {
+		int x;
+		int z;
+		bool operator==(const ChunkPos& other) const { return x == other.x && z == other.z; }
+		bool operator!=(const ChunkPos& other) const { return !(*this == other); }
+	};
+
+	struct ChunkPosHash {
+		size_t operator()(const ChunkPos& pos) const {
+			return std::hash<uint64_t>{}((static_cast<uint64_t>(static_cast<uint32_t>(pos.x)) << 32) | static_cast<uint32_t>(pos.z));
+		}
+	};
+
+	// position of a section in section units (world block coordinate >> 4)
+	struct SectionPos {
+		int x;
+		int y;
+		int z;
+		bool operator==(const SectionPos& other) const { return x == other.x && y == other.y && z == other.z; }
+		bool operator!=(const SectionPos& other) const { return !(*this == other); }
+		ChunkPos chunk() const { return { x, z }; }
+	};
+
+	struct SectionPosHash {
+		size_t operator()(const SectionPos& pos) const {
+			// y only has SECTION_COUNT values so it gets the low bits
+			const uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(pos.x)) << 36) ^
+				(static_cast<uint64_t>(static_cast<uint32_t>(pos.z)) << 8) ^ static_cast<uint32_t>(pos.y);
+			return std::hash<uint64_t>{}(key);
+		}
+	};
+
+	// a 16x16x16 cube of blocks. blocks are stored as indices into a per section palette, bit packed into 64 bit words.
+	// entries never straddle a word (bits per entry is always a power of two) so a lookup is a shift and a mask.
+	// a section holding a single block type (all air, all stone) has no palette or index data at all
+	class ChunkSection {
+	public:
+		static constexpr int SIZE = 16;
+		static constexpr int AREA = SIZE * SIZE;
+		static constexpr int VOLUME = SIZE * SIZE * SIZE;
+
+		ChunkSection() = default;
+		explicit ChunkSection(BlockId fillBlock) : uniformBlock{ fillBlock }, nonAirCount{ fillBlock == BLOCK_AIR ? 0u : VOLUME } {}
+
+		// y major so that a horizontal slice of the section is contiguous
+		static int index(int x, int y, int z) { return (y << 8) | (z << 4) | x; }
+
+		BlockId getBlock(int x, int y, int z) const { return getBlock(index(x, y, z)); }
+		BlockId getBlock(int i) const {
+			if (bitsLog2 < 0) return uniformBlock;
+			return palette[readIndex(i)];
+		}
+		void setBlock(int x, int y, int z, BlockId id) { setBlock(index(x, y, z), id); }
+		void setBlock(int i, BlockId id);
+
+		void fill(BlockId id);
+		// bulk copy the whole section into / out of a VOLUME sized array in index() order
+		void unpack(BlockId* out) const;
+		void pack(const BlockId* in);
+		// drops palette entries that are no longer referenced and falls back to the uniform representation when possible
+		void compact();
+
+		// calls f(x, y, z, id) for every block in index() order
+		template<typename F>
+		void forEachBlock(F&& f) const {
+			if (bitsLog2 < 0) {
+				for (int i = 0; i < VOLUME; i++) f(i & 15, i >> 8, (i >> 4) & 15, uniformBlock);
+				return;
+			}
+			const int bits = 1 << bitsLog2;
+			const int perWord = 64 >> bitsLog2;
+			const uint64_t mask = (uint64_t{ 1 } << bits) - 1;
+			int i = 0;
+			for (uint64_t word : data) {
+				for (int j = 0; j < perWord; j++, i++) {
+					f(i & 15, i >> 8, (i >> 4) & 15, palette[static_cast<size_t>(word & mask)]);
+					word >>= bits;
+				}
+			}
+		}
+
+		bool isUniform() const { return bitsLog2 < 0; }
+		// may report a block that was removed again until the next compact
+		bool contains(BlockId id) const {
+			if (bitsLog2 < 0) return uniformBlock == id;
+			return std::find(palette.begin(), palette.end(), id) != palette.end();
+		}
+		bool isEmpty() const { return nonAirCount == 0; }
+		uint32_t getNonAirCount() const { return nonAirCount; }
+		size_t getPaletteSize() const { return isUniform() ? 1 : palette.size(); }
+		int getBitsPerEntry() const { return isUniform() ? 0 : 1 << bitsLog2; }
+		// heap bytes owned by this section, not counting sizeof(ChunkSection)
+		size_t memoryUsage() const;
+
+		// appends the section in its on disk encoding, which is the palette and packed words as they are in memory
+		void serialize(std::vector<uint8_t>& out) const;
+		// reads a section written by serialize and advances cursor past it. returns false on malformed data
+		bool deserialize(const uint8_t*& cursor, const uint8_t* end);
+
+	private:
+		uint32_t readIndex(int i) const {
+			const int shift = 6 - bitsLog2;
+			const uint64_t word = data[i >> shift];
+			const int offset = (i & ((1 << shift) - 1)) << bitsLog2;
+			return static_cast<uint32_t>((word >> offset) & ((uint64_t{ 1 } << (1 << bitsLog2)) - 1));
+		}
+		void writeIndex(int i, uint32_t paletteIndex);
+		uint32_t findOrAddPalette(BlockId id);
+		void resize(int newBitsLog2);
+
+		// -1 means the section is uniform and only uniformBlock is valid
+		int bitsLog2 = -1;
+		BlockId uniformBlock = BLOCK_AIR;
+		uint32_t nonAirCount = 0;
+		std::vector<BlockId> palette;
+		std::vector<uint64_t> data;
+	};
+
+	// a light level from 0 to MAX_LIGHT per block, packed two to a byte in ChunkSection::index() order. like sections
+	// an array where every block has the same level (open sky, solid rock) doesn't allocate anything
+	class NibbleArray {
+	public:
+		static constexpr int BYTES = ChunkSection::VOLUME / 2;
+
+		NibbleArray() = default;
+		explicit NibbleArray(uint8_t fillValue) : uniform{ fillValue } {}
+
+		uint8_t get(int i) const {
+			if (data.empty()) return uniform;
+			return (data[i >> 1] >> ((i & 1) << 2)) & 15;
+		}
+		void set(int i, uint8_t value);
+		void fill(uint8_t value);
+		// falls back to the uniform representation when every level is the same
+		void compact();
+
+		bool isUniform() const { return data.empty(); }
+		// only meaningful when isUniform()
+		uint8_t getUniform() const { return uniform; }
+		size_t memoryUsage() const { return data.capacity(); }
+
+	private:
+		uint8_t uniform = 0;
+		std::vector<uint8_t> data;
+	};
+
+	struct SectionLight {
+		NibbleArray sky;
+		NibbleArray block;
+
+		void compact() {
+			sky.compact();
+			block.compact();
+		}
+		size_t memoryUsage() const { return sky.memoryUsage() + block.memoryUsage(); }
+	};
+
+	// a vertical column of sections
+	class Chunk {
+	public:
+		static constexpr int SECTION_COUNT = 16;
+		static constexpr int HEIGHT = SECTION_COUNT * ChunkSection::SIZE;
+
+		explicit Chunk(ChunkPos pos) : pos{ pos } {}
+
+		Chunk(const Chunk&) = delete;
+		Chunk& operator=(const Chunk&) = delete;
+
+		ChunkPos getPos() const { return pos; }
+
+		// local x / z in [0, 16), y in [0, HEIGHT). anything above or below the column is air
+		BlockId getBlock(int x, int y, int z) const {
+			if (y < 0 || y >= HEIGHT) return BLOCK_AIR;
+			return sections[y >> 4].getBlock(x, y & 15, z);
+		}
+		void setBlock(int x, int y, int z, BlockId id) {
+			if (y < 0 || y >= HEIGHT) return;
+			sections[y >> 4].setBlock(x, y & 15, z, id);
+		}
+
+		ChunkSection& getSection(int i) { return sections[i]; }
+		const ChunkSection& getSection(int i) const { return sections[i]; }
+
+		// open sky above the column and darkness below it
+		uint8_t getSkyLight(int x, int y, int z) const {
+			if (y >= HEIGHT) return MAX_LIGHT;
+			if (y < 0) return 0;
+			return light[y >> 4].sky.get(ChunkSection::index(x, y & 15, z));
+		}
+		uint8_t getBlockLight(int x, int y, int z) const {
+			if (y < 0 || y >= HEIGHT) return 0;
+			return light[y >> 4].block.get(ChunkSection::index(x, y & 15, z));
+		}
+		// written by the light engine, everything starts out dark
+		SectionLight& getLight(int i) { return light[i]; }
+		const SectionLight& getLight(int i) const { return light[i]; }
+
+		template<typename F>
+		void forEachSection(F&& f) const {
+			for (int i = 0; i < SECTION_COUNT; i++) f(i, sections[i]);
+		}
+
+		void compact();
+		size_t memoryUsage() const;
+
+	private:
+		ChunkPos pos;
+		std::array<ChunkSection, SECTION_COUNT> sections{};
+		std::array<SectionLight, SECTION_COUNT> light{};
+	};
+}
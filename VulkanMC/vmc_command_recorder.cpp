@@ -0,0 +1,183 @@
+#include "vmc_command_recorder.hpp"
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+namespace vmc {
+	VmcCommandRecorder::VmcCommandRecorder(VmcDevice& device, VmcJobSystem& jobSystem)
+		: vmcDevice{ device }, jobSystem{ jobSystem }, slotCount{ jobSystem.getWorkerCount() + size_t{ 1 } } {
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = vmcDevice.findPhysicalQueueFamilies().graphicsFamily;
+		// the buffers are never reset one by one, the whole pool is once its frame has finished
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		for (std::vector<Slot>& slots : frames) {
+			slots.resize(slotCount);
+			for (Slot& slot : slots) {
+				if (vkCreateCommandPool(vmcDevice.device(), &poolInfo, nullptr, &slot.pool) != VK_SUCCESS) {
+					throw std::runtime_error("failed to create recording command pool");
+				}
+			}
+		}
+	}
+
+	VmcCommandRecorder::~VmcCommandRecorder() {
+		// the buffers go with their pools
+		for (std::vector<Slot>& slots : frames) {
+			for (Slot& slot : slots) vkDestroyCommandPool(vmcDevice.device(), slot.pool, nullptr);
+		}
+	}
+
+	void VmcCommandRecorder::beginFrame(int frameIndex) {
+		this->frameIndex = frameIndex;
+		for (Slot& slot : frames[frameIndex]) {
+			if (slot.used == 0) continue;
+			vkResetCommandPool(vmcDevice.device(), slot.pool, 0);
+			slot.used = 0;
+		}
+		frameCounted = false;
+	}
+
+	void VmcCommandRecorder::beginPass(VkRenderPass renderPass, VkFramebuffer framebuffer, VkExtent2D extent) {
+		inheritance = VkCommandBufferInheritanceInfo{};
+		inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritance.renderPass = renderPass;
+		inheritance.subpass = 0;
+		inheritance.framebuffer = framebuffer;
+		this->extent = extent;
+		pending.clear();
+	}
+
+	VkCommandBuffer VmcCommandRecorder::beginSecondary(Slot& slot) {
+		if (slot.used == slot.buffers.size()) {
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocInfo.commandPool = slot.pool;
+			allocInfo.commandBufferCount = 1;
+			VkCommandBuffer commandBuffer;
+			if (vkAllocateCommandBuffers(vmcDevice.device(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+				throw std::runtime_error("failed to allocate secondary command buffer");
+			}
+			slot.buffers.push_back(commandBuffer);
+		}
+		VkCommandBuffer commandBuffer = slot.buffers[slot.used++];
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		beginInfo.pInheritanceInfo = &inheritance;
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+			throw std::runtime_error("failed to begin recording secondary command buffer");
+		}
+
+		// dynamic state isn't inherited from the primary
+		VkViewport viewport{};
+		viewport.x = 0.0f;
+		viewport.y = 0.0f;
+		viewport.width = static_cast<float>(extent.width);
+		viewport.height = static_cast<float>(extent.height);
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		VkRect2D scissor{ {0, 0}, extent };
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+		return commandBuffer;
+	}
+
+	VkCommandBuffer VmcCommandRecorder::beginSecondary() {
+		// slot 0 is the calling thread's, nothing else records into it outside of recordParallel
+		return beginSecondary(frames[frameIndex][0]);
+	}
+
+	void VmcCommandRecorder::endSecondary(VkCommandBuffer commandBuffer) {
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record secondary command buffer");
+		}
+		pending.push_back(commandBuffer);
+		stats.secondaries++;
+	}
+
+	void VmcCommandRecorder::recordParallel(size_t drawCount, const std::function<void(VkCommandBuffer, size_t, size_t)>& record) {
+		// frames drawn on the gpu record nothing and would only water down the averages
+		if (!frameCounted) {
+			frameCounted = true;
+			stats.frames++;
+		}
+		if (drawCount == 0) return;
+		const auto start = std::chrono::steady_clock::now();
+
+		// jobs that only get to run after everything is recorded still hold on to this, so it is shared. they find no
+		// range left and return without touching anything else
+		struct Progress {
+			std::atomic<size_t> nextRange{ 0 };
+			std::atomic<size_t> nextSlot{ 0 };
+			// threads that may still be recording
+			std::atomic<size_t> active{ 0 };
+			std::atomic<size_t> rangesDone{ 0 };
+			// the first thing any thread threw, rethrown on the calling thread once the others are out
+			std::atomic<bool> failed{ false };
+			std::exception_ptr error;
+			std::vector<VkCommandBuffer> recorded;
+		};
+		auto progress = std::make_shared<Progress>();
+		progress->recorded.resize(slotCount, VK_NULL_HANDLE);
+		const size_t rangeCount = (drawCount + DRAWS_PER_RANGE - 1) / DRAWS_PER_RANGE;
+		std::vector<Slot>* slots = &frames[frameIndex];
+		const std::function<void(VkCommandBuffer, size_t, size_t)>* recordRange = &record;
+
+		auto work = [this, progress, drawCount, rangeCount, slots, recordRange] {
+			progress->active.fetch_add(1);
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+			size_t slot = 0;
+			try {
+				for (size_t i = progress->nextRange.fetch_add(1); i < rangeCount; i = progress->nextRange.fetch_add(1)) {
+					// only a thread that got work takes a slot, so there are never more than slotCount of them
+					if (commandBuffer == VK_NULL_HANDLE) {
+						slot = progress->nextSlot.fetch_add(1);
+						commandBuffer = beginSecondary((*slots)[slot]);
+					}
+					(*recordRange)(commandBuffer, i * DRAWS_PER_RANGE, std::min(drawCount, (i + 1) * DRAWS_PER_RANGE));
+					progress->rangesDone.fetch_add(1);
+				}
+				if (commandBuffer != VK_NULL_HANDLE) {
+					if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+						throw std::runtime_error("failed to record secondary command buffer");
+					}
+					progress->recorded[slot] = commandBuffer;
+				}
+			}
+			catch (...) {
+				// nobody picks up another range, threads that start later find none left
+				progress->nextRange.store(rangeCount);
+				if (!progress->failed.exchange(true)) progress->error = std::current_exception();
+			}
+			progress->active.fetch_sub(1);
+		};
+		const size_t helpers = std::min(slotCount - 1, rangeCount - 1);
+		for (size_t i = 0; i < helpers; i++) jobSystem.submit(work);
+		work();
+		// whatever the workers picked up last. after a failure some ranges are never done, only the threads still in one are waited for
+		while ((!progress->failed.load() && progress->rangesDone.load() < rangeCount) || progress->active.load() > 0) std::this_thread::yield();
+		if (progress->error) std::rethrow_exception(progress->error);
+
+		for (VkCommandBuffer commandBuffer : progress->recorded) {
+			if (commandBuffer == VK_NULL_HANDLE) continue;
+			pending.push_back(commandBuffer);
+			stats.secondaries++;
+		}
+		stats.draws += drawCount;
+		stats.ms += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void VmcCommandRecorder::execute(VkCommandBuffer primary) {
+		if (!pending.empty()) vkCmdExecuteCommands(primary, static_cast<uint32_t>(pending.size()), pending.data());
+		pending.clear();
+	}
+}
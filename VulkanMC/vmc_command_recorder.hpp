@@ -0,0 +1,82 @@
+#pragma once
+
+#include "vmc_device.hpp"
+#include "vmc_job_system.hpp"
+#include "vmc_swap_chain.hpp"
+
+// std
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace vmc {
+	struct RecordStats {
+		uint64_t frames = 0;
+		uint64_t secondaries = 0;
+		uint64_t draws = 0;
+		// wall time spent in recordParallel, summed over the frames
+		float ms = .0f;
+
+		double averageMs() const { return frames == 0 ? 0.0 : ms / frames; }
+	};
+
+	// records the draws of a render pass on several threads at once into secondary command buffers, which the primary
+	// then executes. a command pool can only be used by one thread at a time, so every thread that records gets a slot
+	// with a pool of its own, one per frame in flight so a pool is only reset once its frame has finished. the render
+	// pass has to be begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+	class VmcCommandRecorder {
+	public:
+		// draws a thread takes at a time in recordParallel
+		static constexpr size_t DRAWS_PER_RANGE = 256;
+
+		VmcCommandRecorder(VmcDevice& device, VmcJobSystem& jobSystem);
+		~VmcCommandRecorder();
+
+		VmcCommandRecorder(const VmcCommandRecorder&) = delete;
+		VmcCommandRecorder& operator=(const VmcCommandRecorder&) = delete;
+
+		// after the renderer's beginFrame, resets the pools this frame slot recorded into last time
+		void beginFrame(int frameIndex);
+		// what the secondaries recorded until the next execute inherit, they set the viewport and scissor themselves
+		void beginPass(VkRenderPass renderPass, VkFramebuffer framebuffer, VkExtent2D extent);
+
+		// a secondary recorded on the calling thread, it is executed after everything recorded before it
+		VkCommandBuffer beginSecondary();
+		void endSecondary(VkCommandBuffer commandBuffer);
+		// splits [0, drawCount) into ranges that the job system and the calling thread pull from, every thread
+		// recording its ranges into a secondary of its own with record(commandBuffer, first, last). returns once all of
+		// them are recorded. ranges can end up in any secondary, so the draws must not depend on their order
+		void recordParallel(size_t drawCount, const std::function<void(VkCommandBuffer, size_t, size_t)>& record);
+		// executes the secondaries recorded since beginPass in order
+		void execute(VkCommandBuffer primary);
+
+		unsigned getThreadCount() const { return static_cast<unsigned>(slotCount); }
+		// summed over the frames since the last reset
+		const RecordStats& getStats() const { return stats; }
+		void resetStats() { stats = {}; }
+
+	private:
+		struct Slot {
+			VkCommandPool pool = VK_NULL_HANDLE;
+			std::vector<VkCommandBuffer> buffers;
+			// buffers handed out since the pool was last reset
+			size_t used = 0;
+		};
+
+		VkCommandBuffer beginSecondary(Slot& slot);
+
+		VmcDevice& vmcDevice;
+		VmcJobSystem& jobSystem;
+		size_t slotCount;
+		std::array<std::vector<Slot>, VmcSwapChain::MAX_FRAMES_IN_FLIGHT> frames;
+		int frameIndex = 0;
+		// whether recordParallel has run since beginFrame
+		bool frameCounted = false;
+
+		VkCommandBufferInheritanceInfo inheritance{};
+		VkExtent2D extent{};
+		std::vector<VkCommandBuffer> pending;
+		RecordStats stats;
+	};
+}
@@ -0,0 +1,147 @@
+#include "vmc_compression.hpp"
+
+// std
+#include <array>
+#include <cstring>
+
+namespace vmc {
+	static constexpr size_t MIN_MATCH = 4;
+	static constexpr size_t MAX_OFFSET = 65535;
+	// the end of the input is always emitted as literals so the match finder never reads past it
+	static constexpr size_t END_LITERALS = 5;
+	static constexpr int HASH_BITS = 14;
+
+	static uint32_t read32(const uint8_t* p) {
+		uint32_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	static uint32_t hashSequence(uint32_t v) {
+		return (v * 2654435761u) >> (32 - HASH_BITS);
+	}
+
+	// lengths of 15 and above spill into extra bytes of 255 terminated by a smaller one
+	static void writeLength(std::vector<uint8_t>& out, size_t length) {
+		while (length >= 255) {
+			out.push_back(255);
+			length -= 255;
+		}
+		out.push_back(static_cast<uint8_t>(length));
+	}
+
+	static void writeSequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength) {
+		const size_t matchCode = matchLength == 0 ? 0 : matchLength - MIN_MATCH;
+		const uint8_t token = static_cast<uint8_t>(((literalLength < 15 ? literalLength : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+		out.push_back(token);
+		if (literalLength >= 15) writeLength(out, literalLength - 15);
+		out.insert(out.end(), literals, literals + literalLength);
+
+		// the last sequence has no match
+		if (matchLength == 0) return;
+		out.push_back(static_cast<uint8_t>(offset & 0xff));
+		out.push_back(static_cast<uint8_t>(offset >> 8));
+		if (matchCode >= 15) writeLength(out, matchCode - 15);
+	}
+
+	void lzCompress(const uint8_t* src, size_t size, std::vector<uint8_t>& out) {
+		out.clear();
+		out.reserve(size / 2 + 16);
+
+		// positions are stored + 1 so that 0 means empty
+		std::array<uint32_t, size_t{ 1 } << HASH_BITS> table{};
+		size_t anchor = 0;
+		size_t ip = 0;
+		const size_t matchLimit = size > END_LITERALS + MIN_MATCH ? size - END_LITERALS - MIN_MATCH : 0;
+
+		while (ip < matchLimit) {
+			const uint32_t sequence = read32(src + ip);
+			uint32_t& slot = table[hashSequence(sequence)];
+			const size_t candidate = slot;
+			slot = static_cast<uint32_t>(ip + 1);
+
+			if (candidate == 0 || ip - (candidate - 1) > MAX_OFFSET || read32(src + candidate - 1) != sequence) {
+				ip++;
+				continue;
+			}
+
+			const size_t ref = candidate - 1;
+			size_t length = MIN_MATCH;
+			while (ip + length < size - END_LITERALS && src[ref + length] == src[ip + length]) length++;
+
+			writeSequence(out, src + anchor, ip - anchor, ip - ref, length);
+			ip += length;
+			anchor = ip;
+		}
+
+		writeSequence(out, src + anchor, size - anchor, 0, 0);
+	}
+
+	static bool readLength(const uint8_t*& src, const uint8_t* end, size_t& length) {
+		uint8_t b;
+		do {
+			if (src >= end) return false;
+			b = *src++;
+			length += b;
+		} while (b == 255);
+		return true;
+	}
+
+	bool lzDecompress(const uint8_t* src, size_t size, uint8_t* dst, size_t dstSize) {
+		const uint8_t* end = src + size;
+		size_t op = 0;
+
+		while (src < end) {
+			const uint8_t token = *src++;
+
+			size_t literalLength = token >> 4;
+			if (literalLength == 15 && !readLength(src, end, literalLength)) return false;
+			if (literalLength > static_cast<size_t>(end - src) || literalLength > dstSize - op) return false;
+			std::memcpy(dst + op, src, literalLength);
+			src += literalLength;
+			op += literalLength;
+
+			if (src == end) break;
+
+			if (end - src < 2) return false;
+			const size_t offset = static_cast<size_t>(src[0]) | (static_cast<size_t>(src[1]) << 8);
+			src += 2;
+			if (offset == 0 || offset > op) return false;
+
+			size_t matchLength = token & 15;
+			if (matchLength == 15 && !readLength(src, end, matchLength)) return false;
+			matchLength += MIN_MATCH;
+			if (matchLength > dstSize - op) return false;
+
+			// matches may overlap their own output (offset 1 repeats a byte), so copy forwards one byte at a time
+			// unless the source is far enough back
+			const uint8_t* match = dst + op - offset;
+			if (offset >= matchLength) {
+				std::memcpy(dst + op, match, matchLength);
+			}
+			else {
+				for (size_t i = 0; i < matchLength; i++) dst[op + i] = match[i];
+			}
+			op += matchLength;
+		}
+
+		return op == dstSize;
+	}
+
+	static std::array<uint32_t, 256> makeCrcTable() {
+		std::array<uint32_t, 256> table{};
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+			table[i] = c;
+		}
+		return table;
+	}
+
+	uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc) {
+		static const std::array<uint32_t, 256> table = makeCrcTable();
+		crc = ~crc;
+		for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+		return ~crc;
+	}
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vmc {
+	// lz77 with the lz4 block layout (token, literals, 16 bit offset, match length). it only finds matches through a
+	// single hash probe, so it compresses worse than zlib but decodes at memory speed, which is what chunk loading wants
+	void lzCompress(const uint8_t* src, size_t size, std::vector<uint8_t>& out);
+	// dstSize must be the exact uncompressed size. returns false if src is malformed, never reads or writes out of bounds
+	bool lzDecompress(const uint8_t* src, size_t size, uint8_t* dst, size_t dstSize);
+
+	// crc-32 (the zlib / png polynomial), pass the previous result as crc to continue a running checksum
+	uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+}
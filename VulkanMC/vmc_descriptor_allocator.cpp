@@ -0,0 +1,71 @@
+#include "vmc_descriptor_allocator.hpp"
+
+// std
+#include <stdexcept>
+#include <utility>
+
+namespace vmc {
+	VmcDescriptorAllocator::VmcDescriptorAllocator(VmcDevice& device, std::vector<VkDescriptorPoolSize> poolSizes, uint32_t setsPerPool,
+		VkDescriptorPoolCreateFlags flags) : vmcDevice{ device }, poolSizes{ std::move(poolSizes) }, setsPerPool{ setsPerPool }, flags{ flags } {
+	}
+
+	VmcDescriptorAllocator::~VmcDescriptorAllocator() {
+		for (VkDescriptorPool pool : pools) vkDestroyDescriptorPool(vmcDevice.device(), pool, nullptr);
+	}
+
+	VkDescriptorSet VmcDescriptorAllocator::allocate(VkDescriptorSetLayout layout, uint32_t variableCount) {
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		for (; currentPool < pools.size(); currentPool++) {
+			const VkResult result = tryAllocate(pools[currentPool], layout, variableCount, set);
+			if (result == VK_SUCCESS) {
+				allocatedSets++;
+				return set;
+			}
+			if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) {
+				throw std::runtime_error("failed to allocate descriptor set");
+			}
+		}
+
+		pools.push_back(createPool());
+		if (tryAllocate(pools.back(), layout, variableCount, set) != VK_SUCCESS) {
+			throw std::runtime_error("descriptor set doesn't fit in an empty pool");
+		}
+		allocatedSets++;
+		return set;
+	}
+
+	void VmcDescriptorAllocator::reset() {
+		for (VkDescriptorPool pool : pools) vkResetDescriptorPool(vmcDevice.device(), pool, 0);
+		currentPool = 0;
+		allocatedSets = 0;
+	}
+
+	VkDescriptorPool VmcDescriptorAllocator::createPool() {
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.flags = flags;
+		poolInfo.maxSets = setsPerPool;
+		poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+		poolInfo.pPoolSizes = poolSizes.data();
+		VkDescriptorPool pool;
+		if (vkCreateDescriptorPool(vmcDevice.device(), &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create descriptor pool");
+		}
+		return pool;
+	}
+
+	VkResult VmcDescriptorAllocator::tryAllocate(VkDescriptorPool pool, VkDescriptorSetLayout layout, uint32_t variableCount, VkDescriptorSet& set) {
+		VkDescriptorSetVariableDescriptorCountAllocateInfo variableInfo{};
+		variableInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+		variableInfo.descriptorSetCount = 1;
+		variableInfo.pDescriptorCounts = &variableCount;
+
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.pNext = variableCount > 0 ? &variableInfo : nullptr;
+		allocInfo.descriptorPool = pool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &layout;
+		return vkAllocateDescriptorSets(vmcDevice.device(), &allocInfo, &set);
+	}
+}
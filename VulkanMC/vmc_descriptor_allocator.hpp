@@ -0,0 +1,44 @@
+#pragma once
+
+#include "vmc_device.hpp"
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace vmc {
+	// hands out descriptor sets from a list of pools that grows as they fill up, so callers don't have to size a
+	// pool for everything they will ever allocate up front. every pool is created with the same sizes and flags,
+	// when one runs out or is too fragmented for a set the next one is tried and a new one added after the last
+	class VmcDescriptorAllocator {
+	public:
+		VmcDescriptorAllocator(VmcDevice& device, std::vector<VkDescriptorPoolSize> poolSizes, uint32_t setsPerPool, VkDescriptorPoolCreateFlags flags = 0);
+		~VmcDescriptorAllocator();
+
+		VmcDescriptorAllocator(const VmcDescriptorAllocator&) = delete;
+		VmcDescriptorAllocator& operator=(const VmcDescriptorAllocator&) = delete;
+
+		// variableCount is how many descriptors the variable count binding at the end of layout gets, 0 when the
+		// layout doesn't have one. throws when the set doesn't even fit in an empty pool
+		VkDescriptorSet allocate(VkDescriptorSetLayout layout, uint32_t variableCount = 0);
+		// every set goes back to its pool, none of them may still be in use by the gpu
+		void reset();
+
+		size_t getPoolCount() const { return pools.size(); }
+		uint64_t getAllocatedSets() const { return allocatedSets; }
+
+	private:
+		VkDescriptorPool createPool();
+		VkResult tryAllocate(VkDescriptorPool pool, VkDescriptorSetLayout layout, uint32_t variableCount, VkDescriptorSet& set);
+
+		VmcDevice& vmcDevice;
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		uint32_t setsPerPool;
+		VkDescriptorPoolCreateFlags flags;
+
+		std::vector<VkDescriptorPool> pools;
+		// the first pool that may still have room, the ones before it were full last time they were tried
+		size_t currentPool = 0;
+		uint64_t allocatedSets = 0;
+	};
+}
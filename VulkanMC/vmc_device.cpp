@@ -49,6 +49,7 @@ namespace vmc {
 
 	// class member functions
 	VmcDevice::VmcDevice(VmcWindow& window) : window{ window } {
+		if (!window.isHeadless()) deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 		createInstance();
 		setupDebugMessenger();
 		createSurface();
@@ -56,6 +57,7 @@ namespace vmc {
 		createLogicalDevice();
 		createAllocator();
 		createCommandPool();
+		detectResizableBar();
 	}
 
 	VmcDevice::~VmcDevice() {
@@ -68,7 +70,7 @@ namespace vmc {
 			DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
 		}
 
-		vkDestroySurfaceKHR(instance, surface_, nullptr);
+		if (surface_ != VK_NULL_HANDLE) vkDestroySurfaceKHR(instance, surface_, nullptr);
 		vkDestroyInstance(instance, nullptr);
 	}
 
@@ -143,6 +145,7 @@ namespace vmc {
 
 		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 		std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily };
+		if (indices.transferFamilyHasValue) uniqueQueueFamilies.insert(indices.transferFamily);
 
 		float queuePriority = 1.0f;
 		for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -154,16 +157,46 @@ namespace vmc {
 			queueCreateInfos.push_back(queueCreateInfo);
 		}
 
-		VkPhysicalDeviceFeatures deviceFeatures = {};
-		deviceFeatures.samplerAnisotropy = VK_TRUE;
+		// optional features are only turned on when the device has them, the renderer falls back to cpu paths otherwise
+		VkPhysicalDeviceVulkan12Features supported12{};
+		supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		VkPhysicalDeviceFeatures2 supported{};
+		supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supported.pNext = &supported12;
+		vkGetPhysicalDeviceFeatures2(physicalDevice, &supported);
+		drawIndirectCountSupported = supported.features.multiDrawIndirect && supported12.drawIndirectCount;
+		wireframeSupported = supported.features.fillModeNonSolid;
+		textureCompressionBCSupported = supported.features.textureCompressionBC;
+
+		VkPhysicalDeviceVulkan12Features features12{};
+		features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		features12.drawIndirectCount = drawIndirectCountSupported ? VK_TRUE : VK_FALSE;
+		// required by 1.2, uploads signal one instead of the cpu waiting on the queue
+		features12.timelineSemaphore = VK_TRUE;
+		// descriptor indexing for the bindless textures, checked by isDeviceSuitable
+		features12.descriptorIndexing = VK_TRUE;
+		features12.runtimeDescriptorArray = VK_TRUE;
+		features12.descriptorBindingPartiallyBound = VK_TRUE;
+		features12.descriptorBindingVariableDescriptorCount = VK_TRUE;
+		features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+		features12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+
+		VkPhysicalDeviceFeatures2 deviceFeatures{};
+		deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		deviceFeatures.pNext = &features12;
+		deviceFeatures.features.samplerAnisotropy = VK_TRUE;
+		deviceFeatures.features.multiDrawIndirect = drawIndirectCountSupported ? VK_TRUE : VK_FALSE;
+		deviceFeatures.features.fillModeNonSolid = wireframeSupported ? VK_TRUE : VK_FALSE;
+		deviceFeatures.features.textureCompressionBC = textureCompressionBCSupported ? VK_TRUE : VK_FALSE;
 
 		VkDeviceCreateInfo createInfo = {};
 		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		createInfo.pNext = &deviceFeatures;
 
 		createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 		createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
-		createInfo.pEnabledFeatures = &deviceFeatures;
+		createInfo.pEnabledFeatures = nullptr;
 		createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
 		createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
@@ -181,8 +214,22 @@ namespace vmc {
 			throw std::runtime_error("failed to create logical device!");
 		}
 
+		uint32_t familyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> families(familyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+		timestampValidBits = families[indices.graphicsFamily].timestampValidBits;
+
 		vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
 		vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+		if (indices.transferFamilyHasValue) {
+			vkGetDeviceQueue(device_, indices.transferFamily, 0, &transferQueue_);
+		}
+		else {
+			transferQueue_ = graphicsQueue_;
+		}
+		std::cout << "transfer queue: " << (indices.transferFamilyHasValue ? "dedicated family " + std::to_string(indices.transferFamily) : std::string{ "shared with graphics" })
+			<< std::endl;
 	}
 
 	void VmcDevice::createAllocator() {
@@ -210,15 +257,35 @@ namespace vmc {
 		}
 	}
 
-	void VmcDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
+	void VmcDevice::detectResizableBar() {
+		// without rebar the host visible part of vram is a 256 MiB window at most, too small to put meshes in
+		constexpr VkDeviceSize barWindow = 256ull << 20;
+		constexpr VkMemoryPropertyFlags flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		VkPhysicalDeviceMemoryProperties memProperties;
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+			const VkMemoryType& type = memProperties.memoryTypes[i];
+			if ((type.propertyFlags & flags) == flags && memProperties.memoryHeaps[type.heapIndex].size > barWindow) {
+				resizableBarSupported = true;
+				break;
+			}
+		}
+		std::cout << "resizable bar: " << (resizableBarSupported ? "yes, device local memory is written directly" : "no, uploads are staged") << std::endl;
+	}
+
+	void VmcDevice::createSurface() {
+		if (window.isHeadless()) return;
+		window.createWindowSurface(instance, &surface_);
+	}
 
 	bool VmcDevice::isDeviceSuitable(VkPhysicalDevice device) {
 		QueueFamilyIndices indices = findQueueFamilies(device);
 
 		bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-		bool swapChainAdequate = false;
-		if (extensionsSupported) {
+		// nothing is presented when headless
+		bool swapChainAdequate = window.isHeadless();
+		if (extensionsSupported && !window.isHeadless()) {
 			SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
 			swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
 		}
@@ -226,8 +293,20 @@ namespace vmc {
 		VkPhysicalDeviceFeatures supportedFeatures;
 		vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
+		// every texture is sampled out of one variable sized array that is written while frames are in flight.
+		// 1.3 makes these mandatory, so in practice only older drivers are turned away
+		VkPhysicalDeviceVulkan12Features supported12{};
+		supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		VkPhysicalDeviceFeatures2 supported{};
+		supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supported.pNext = &supported12;
+		vkGetPhysicalDeviceFeatures2(device, &supported);
+		const bool descriptorIndexing = supported12.descriptorIndexing && supported12.runtimeDescriptorArray &&
+			supported12.descriptorBindingPartiallyBound && supported12.descriptorBindingVariableDescriptorCount &&
+			supported12.descriptorBindingSampledImageUpdateAfterBind && supported12.shaderSampledImageArrayNonUniformIndexing;
+
 		return indices.isComplete() && extensionsSupported && swapChainAdequate &&
-			supportedFeatures.samplerAnisotropy;
+			supportedFeatures.samplerAnisotropy && descriptorIndexing;
 	}
 
 	void VmcDevice::populateDebugMessengerCreateInfo(
@@ -278,11 +357,13 @@ namespace vmc {
 	}
 
 	std::vector<const char*> VmcDevice::getRequiredExtensions() {
-		uint32_t glfwExtensionCount = 0;
-		const char** glfwExtensions;
-		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-		std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		std::vector<const char*> extensions;
+		if (!window.isHeadless()) {
+			uint32_t glfwExtensionCount = 0;
+			const char** glfwExtensions;
+			glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+			extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		}
 
 		if (enableValidationLayers) {
 			extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -349,8 +430,14 @@ namespace vmc {
 				indices.graphicsFamily = i;
 				indices.graphicsFamilyHasValue = true;
 			}
+			// headless the graphics queue stands in for the present queue, which is never used
 			VkBool32 presentSupport = false;
-			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+			if (surface_ != VK_NULL_HANDLE) {
+				vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+			}
+			else {
+				presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+			}
 			if (queueFamily.queueCount > 0 && presentSupport) {
 				indices.presentFamily = i;
 				indices.presentFamilyHasValue = true;
@@ -362,6 +449,16 @@ namespace vmc {
 			i++;
 		}
 
+		// copies on a family of their own run alongside rendering instead of queueing up behind it
+		for (uint32_t family = 0; family < queueFamilyCount; family++) {
+			const VkQueueFlags flags = queueFamilies[family].queueFlags;
+			if (queueFamilies[family].queueCount > 0 && (flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+				indices.transferFamily = family;
+				indices.transferFamilyHasValue = true;
+				break;
+			}
+		}
+
 		return indices;
 	}
 
@@ -408,6 +505,12 @@ namespace vmc {
 		throw std::runtime_error("failed to find supported format!");
 	}
 
+	VkFormatProperties VmcDevice::getFormatProperties(VkFormat format) {
+		VkFormatProperties props;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+		return props;
+	}
+
 	uint32_t VmcDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
 		VkPhysicalDeviceMemoryProperties memProperties;
 		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
@@ -423,24 +526,60 @@ namespace vmc {
 
 
 	void VmcDevice::createDeviceBuffer(VkDeviceSize size, void* src, VkBufferUsageFlags usage, VkBuffer* buffer, VmaAllocation* bufferMemory) {
+		void* data = nullptr;
+		if (createMappedDeviceBuffer(size, usage, buffer, bufferMemory, &data)) {
+			memcpy(data, src, static_cast<size_t>(size));
+			vmaFlushAllocation(vmaAllocator, *bufferMemory, 0, size);
+			return;
+		}
+
+		VkBuffer stagingBuffer;
+		VmaAllocation stagingMemory;
+		createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY, &stagingBuffer, &stagingMemory, &data);
+		memcpy(data, src, static_cast<size_t>(size));
+		vmaFlushAllocation(vmaAllocator, stagingMemory, 0, size);
+
+		createBuffer(size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY, buffer, bufferMemory);
+		copyBuffer(stagingBuffer, *buffer, size);
+		vmaDestroyBuffer(vmaAllocator, stagingBuffer, stagingMemory);
+	}
+
+	void VmcDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage, VkBuffer* buffer, VmaAllocation* bufferMemory, void** mapped) {
 		VkBufferCreateInfo bufferInfo{};
 		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 		bufferInfo.size = size;
-		bufferInfo.usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		bufferInfo.usage = usage;
 		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-		VmaAllocationCreateInfo allocInfo = {};
-		allocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+		VmaAllocationCreateInfo allocInfo{};
+		allocInfo.usage = memoryUsage;
+		if (mapped != nullptr) allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
 
-
-		if (vmaCreateBuffer(vmaAllocator, &bufferInfo, &allocInfo, buffer, bufferMemory, nullptr) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create vertex buffer!");
+		VmaAllocationInfo allocationInfo{};
+		if (vmaCreateBuffer(vmaAllocator, &bufferInfo, &allocInfo, buffer, bufferMemory, &allocationInfo) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create buffer!");
 		}
+		if (mapped != nullptr) *mapped = allocationInfo.pMappedData;
+	}
 
-		void* data;
-		vmaMapMemory(vmaAllocator, *bufferMemory, &data);
-		memcpy(data, src, static_cast<size_t>(size));
-		vmaUnmapMemory(vmaAllocator, *bufferMemory);
+	bool VmcDevice::createMappedDeviceBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer* buffer, VmaAllocation* bufferMemory, void** mapped) {
+		if (!resizableBarSupported) return false;
+
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = size;
+		bufferInfo.usage = usage;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VmaAllocationCreateInfo allocInfo{};
+		allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+		allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+		VmaAllocationInfo allocationInfo{};
+		if (vmaCreateBuffer(vmaAllocator, &bufferInfo, &allocInfo, buffer, bufferMemory, &allocationInfo) != VK_SUCCESS) return false;
+		*mapped = allocationInfo.pMappedData;
+		return true;
 	}
 
 	VkCommandBuffer VmcDevice::beginSingleTimeCommands() {
@@ -469,8 +608,16 @@ namespace vmc {
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &commandBuffer;
 
-		vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-		vkQueueWaitIdle(graphicsQueue_);
+		// only waits for this submit, not for whatever else the queue has been given
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		VkFence fence;
+		if (vkCreateFence(device_, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create single time command fence!");
+		}
+		vkQueueSubmit(graphicsQueue_, 1, &submitInfo, fence);
+		vkWaitForFences(device_, 1, &fence, VK_TRUE, UINT64_MAX);
+		vkDestroyFence(device_, fence, nullptr);
 
 		vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
 	}
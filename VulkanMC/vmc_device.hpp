@@ -17,8 +17,11 @@ namespace vmc {
 	struct QueueFamilyIndices {
 		uint32_t graphicsFamily;
 		uint32_t presentFamily;
+		// a family that can copy but not draw, usually backed by the gpu's copy engines
+		uint32_t transferFamily;
 		bool graphicsFamilyHasValue = false;
 		bool presentFamilyHasValue = false;
+		bool transferFamilyHasValue = false;
 		bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
 	};
 
@@ -41,18 +44,45 @@ namespace vmc {
 
 		VkCommandPool getCommandPool() { return commandPool; }
 		VkDevice device() { return device_; }
+		// VK_NULL_HANDLE when headless
 		VkSurfaceKHR surface() { return surface_; }
 		VkQueue graphicsQueue() { return graphicsQueue_; }
 		VkQueue presentQueue() { return presentQueue_; }
+		// the graphics queue when there is no dedicated transfer family
+		VkQueue transferQueue() { return transferQueue_; }
 
 		SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
 		uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 		QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice); }
 		VkFormat findSupportedFormat(
 			const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
+		VkFormatProperties getFormatProperties(VkFormat format);
 
 		// Buffer Helper Functions
+		// device local, written directly when the memory is host visible and through a staging buffer otherwise.
+		// blocks until the copy is done, meant for loading, streamed data goes through VmcUploadManager
 		void createDeviceBuffer(VkDeviceSize size, void* data, VkBufferUsageFlags usage, VkBuffer* buffer, VmaAllocation* bufferMemory);
+		// an empty buffer, when mapped is given the memory is persistently mapped and stays that way until the buffer is destroyed
+		void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage, VkBuffer* buffer, VmaAllocation* bufferMemory, void** mapped = nullptr);
+		// device local and persistently mapped, false when there is no resizable bar or its heap is full
+		bool createMappedDeviceBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer* buffer, VmaAllocation* bufferMemory, void** mapped);
+
+		// no surface and no swapchain extension, frames are rendered into offscreen images
+		bool isHeadless() const { return window.isHeadless(); }
+		// vkCmdDrawIndexedIndirectCount and multi draw indirect, needed for gpu driven culling
+		bool supportsDrawIndirectCount() const { return drawIndirectCountSupported; }
+		// VK_POLYGON_MODE_LINE, for the wireframe view
+		bool supportsWireframe() const { return wireframeSupported; }
+		// bc1 to bc7 textures, for the baked block textures
+		bool supportsTextureCompressionBC() const { return textureCompressionBCSupported; }
+		// bits of a timestamp written on the graphics queue, 0 when it can't write any
+		uint32_t getTimestampValidBits() const { return timestampValidBits; }
+		// the cpu can write all of vram (or at least more than the classic 256 MiB window) through a host visible device local heap
+		bool supportsResizableBar() const { return resizableBarSupported; }
+
+		// pipelines are created through this one when it isn't null, set by VmcPipelineCache
+		VkPipelineCache getPipelineCache() const { return pipelineCache; }
+		void setPipelineCache(VkPipelineCache cache) { pipelineCache = cache; }
 
 		VkCommandBuffer beginSingleTimeCommands();
 		void endSingleTimeCommands(VkCommandBuffer commandBuffer);
@@ -76,6 +106,7 @@ namespace vmc {
 		void createLogicalDevice();
 		void createAllocator();
 		void createCommandPool();
+		void detectResizableBar();
 
 		// helper functions
 		bool isDeviceSuitable(VkPhysicalDevice device);
@@ -94,12 +125,20 @@ namespace vmc {
 		VkCommandPool commandPool;
 
 		VkDevice device_;
-		VkSurfaceKHR surface_;
+		VkSurfaceKHR surface_ = VK_NULL_HANDLE;
 		VkQueue graphicsQueue_;
 		VkQueue presentQueue_;
+		VkQueue transferQueue_;
+		VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+		bool drawIndirectCountSupported = false;
+		bool wireframeSupported = false;
+		bool textureCompressionBCSupported = false;
+		bool resizableBarSupported = false;
+		uint32_t timestampValidBits = 0;
 
 		const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation" };
-		const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+		// the swapchain extension is left out when headless, so devices without presentation support can be used
+		std::vector<const char*> deviceExtensions;
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include "vmc_frustum.hpp"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VMC_FRUSTUM_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace vmc {
+	// the corner of the box furthest along the plane normal, if that one is behind the plane the whole box is.
+	// each entry picks min (0) or max (3) from the bounds arrays for x, y and z
+	static void positiveCorner(const glm::vec4& plane, int corner[3]) {
+		corner[0] = plane.x >= .0f ? 3 : 0;
+		corner[1] = plane.y >= .0f ? 4 : 1;
+		corner[2] = plane.z >= .0f ? 5 : 2;
+	}
+
+	Frustum Frustum::fromMatrix(const glm::mat4& m) {
+		// glm is column major, so row i of the matrix is m[0][i], m[1][i], m[2][i], m[3][i]
+		auto row = [&](int i) { return glm::vec4{ m[0][i], m[1][i], m[2][i], m[3][i] }; };
+		const glm::vec4 x = row(0);
+		const glm::vec4 y = row(1);
+		const glm::vec4 z = row(2);
+		const glm::vec4 w = row(3);
+
+		Frustum frustum;
+		frustum.planes[PLANE_LEFT] = w + x;
+		frustum.planes[PLANE_RIGHT] = w - x;
+		frustum.planes[PLANE_TOP] = w + y;
+		frustum.planes[PLANE_BOTTOM] = w - y;
+		frustum.planes[PLANE_NEAR] = z;
+		frustum.planes[PLANE_FAR] = w - z;
+		for (glm::vec4& plane : frustum.planes) {
+			plane /= glm::length(glm::vec3{ plane });
+		}
+		return frustum;
+	}
+
+	bool Frustum::intersects(const Aabb& box) const {
+		for (const glm::vec4& plane : planes) {
+			const glm::vec3 corner{ plane.x >= .0f ? box.max.x : box.min.x, plane.y >= .0f ? box.max.y : box.min.y, plane.z >= .0f ? box.max.z : box.min.z };
+			if (glm::dot(glm::vec3{ plane }, corner) + plane.w < .0f) return false;
+		}
+		return true;
+	}
+
+	static size_t frustumCullScalar(const float* const bounds[6], size_t count, const glm::vec4* planes, uint32_t* visible) {
+		size_t visibleCount = 0;
+		for (size_t i = 0; i < count; i++) {
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; p++) {
+				int corner[3];
+				positiveCorner(planes[p], corner);
+				const float distance = planes[p].x * bounds[corner[0]][i] + planes[p].y * bounds[corner[1]][i] + planes[p].z * bounds[corner[2]][i] + planes[p].w;
+				inside = distance >= .0f;
+			}
+			if (inside) visible[visibleCount++] = static_cast<uint32_t>(i);
+		}
+		return visibleCount;
+	}
+
+#ifdef VMC_FRUSTUM_SSE2
+	static size_t frustumCullSse2(const float* const bounds[6], size_t count, const glm::vec4* planes, uint32_t* visible) {
+		int corners[6][3];
+		for (int p = 0; p < 6; p++) positiveCorner(planes[p], corners[p]);
+
+		size_t visibleCount = 0;
+		const __m128 zero = _mm_setzero_ps();
+		for (size_t i = 0; i < count; i += 4) {
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < 6; p++) {
+				__m128 distance = _mm_set1_ps(planes[p].w);
+				distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(planes[p].x), _mm_loadu_ps(bounds[corners[p][0]] + i)));
+				distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(planes[p].y), _mm_loadu_ps(bounds[corners[p][1]] + i)));
+				distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(planes[p].z), _mm_loadu_ps(bounds[corners[p][2]] + i)));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+			}
+
+			unsigned mask = static_cast<unsigned>(_mm_movemask_ps(inside));
+			while (mask != 0) {
+				unsigned lane = 0;
+				while (((mask >> lane) & 1) == 0) lane++;
+				mask &= mask - 1;
+				if (i + lane < count) visible[visibleCount++] = static_cast<uint32_t>(i + lane);
+			}
+		}
+		return visibleCount;
+	}
+#endif
+
+	VmcFrustumCuller::VmcFrustumCuller(SimdLevel level) : simdLevel{ SimdLevel::Scalar } {
+		setSimdLevel(level);
+	}
+
+	void VmcFrustumCuller::setSimdLevel(SimdLevel level) {
+		SimdLevel best = VmcNoise::bestSimdLevel();
+		if (best == SimdLevel::Avx2 && !frustumAvx2Compiled()) best = SimdLevel::Sse2;
+#ifndef VMC_FRUSTUM_SSE2
+		if (best == SimdLevel::Sse2) best = SimdLevel::Scalar;
+#endif
+		simdLevel = static_cast<int>(level) > static_cast<int>(best) ? best : level;
+	}
+
+	void VmcFrustumCuller::clear() {
+		count = 0;
+		for (auto& values : bounds) values.clear();
+	}
+
+	void VmcFrustumCuller::reserve(size_t capacity) {
+		for (auto& values : bounds) values.reserve(capacity + BATCH);
+	}
+
+	uint32_t VmcFrustumCuller::add(const Aabb& box) {
+		// the padding past count is overwritten in place, it only has to exist so whole batches can be loaded
+		if (count % BATCH == 0) {
+			for (auto& values : bounds) values.resize(count + BATCH, .0f);
+		}
+		bounds[0][count] = box.min.x;
+		bounds[1][count] = box.min.y;
+		bounds[2][count] = box.min.z;
+		bounds[3][count] = box.max.x;
+		bounds[4][count] = box.max.y;
+		bounds[5][count] = box.max.z;
+		return static_cast<uint32_t>(count++);
+	}
+
+	CullStats VmcFrustumCuller::cull(const Frustum& frustum, std::vector<uint32_t>& visible) const {
+		visible.resize(count);
+		const float* const arrays[6] = { bounds[0].data(), bounds[1].data(), bounds[2].data(), bounds[3].data(), bounds[4].data(), bounds[5].data() };
+
+		size_t visibleCount = 0;
+		if (simdLevel == SimdLevel::Avx2) {
+			visibleCount = frustumCullAvx2(arrays, count, frustum.planes.data(), visible.data());
+		}
+#ifdef VMC_FRUSTUM_SSE2
+		else if (simdLevel == SimdLevel::Sse2) {
+			visibleCount = frustumCullSse2(arrays, count, frustum.planes.data(), visible.data());
+		}
+#endif
+		else {
+			visibleCount = frustumCullScalar(arrays, count, frustum.planes.data(), visible.data());
+		}
+		visible.resize(visibleCount);
+
+		CullStats stats;
+		stats.tested = static_cast<uint32_t>(count);
+		stats.visible = static_cast<uint32_t>(visibleCount);
+		return stats;
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "vmc_noise.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace vmc {
+	struct Aabb {
+		glm::vec3 min{ .0f };
+		glm::vec3 max{ .0f };
+	};
+
+	// six planes pointing inwards, a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all of them
+	struct Frustum {
+		enum Plane { PLANE_LEFT, PLANE_RIGHT, PLANE_TOP, PLANE_BOTTOM, PLANE_NEAR, PLANE_FAR };
+
+		std::array<glm::vec4, 6> planes{};
+
+		// works for any projection * view matrix with vulkan's 0 to 1 depth range
+		static Frustum fromMatrix(const glm::mat4& viewProjection);
+
+		// conservative, boxes right outside a corner can still pass
+		bool intersects(const Aabb& box) const;
+	};
+
+	struct CullStats {
+		uint32_t tested = 0;
+		uint32_t visible = 0;
+
+		uint32_t culled() const { return tested - visible; }
+	};
+
+	// tests many boxes against a frustum 4 (sse2) or 8 (avx2) at a time. boxes are kept as separate arrays of min and
+	// max coordinates so each plane is a handful of vector multiplies per batch
+	class VmcFrustumCuller {
+	public:
+		static constexpr size_t BATCH = 8;
+
+		explicit VmcFrustumCuller(SimdLevel level = VmcNoise::bestSimdLevel());
+
+		SimdLevel getSimdLevel() const { return simdLevel; }
+		void setSimdLevel(SimdLevel level);
+
+		void clear();
+		void reserve(size_t count);
+		// returns the index the box is reported with
+		uint32_t add(const Aabb& box);
+		size_t size() const { return count; }
+
+		// replaces visible with the indices of every box that intersects the frustum, in ascending order
+		CullStats cull(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+
+	private:
+		SimdLevel simdLevel;
+		size_t count = 0;
+		// minX, minY, minZ, maxX, maxY, maxZ, each padded to a multiple of BATCH
+		std::array<std::vector<float>, 6> bounds;
+	};
+
+	// implemented in vmc_frustum_avx2.cpp, only call when VmcNoise::bestSimdLevel() is avx2
+	bool frustumAvx2Compiled();
+	size_t frustumCullAvx2(const float* const bounds[6], size_t count, const glm::vec4* planes, uint32_t* visible);
+}
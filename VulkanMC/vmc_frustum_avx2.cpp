@@ -0,0 +1,48 @@
+// this file is built with avx2 enabled (/arch:AVX2 in the project, -mavx2 elsewhere). nothing in here may be called
+// unless VmcFrustumCuller picked avx2 at runtime
+#include "vmc_frustum.hpp"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace vmc {
+#ifdef __AVX2__
+	bool frustumAvx2Compiled() { return true; }
+
+	size_t frustumCullAvx2(const float* const bounds[6], size_t count, const glm::vec4* planes, uint32_t* visible) {
+		const float* corners[6][3];
+		for (int p = 0; p < 6; p++) {
+			corners[p][0] = bounds[planes[p].x >= .0f ? 3 : 0];
+			corners[p][1] = bounds[planes[p].y >= .0f ? 4 : 1];
+			corners[p][2] = bounds[planes[p].z >= .0f ? 5 : 2];
+		}
+
+		size_t visibleCount = 0;
+		const __m256 zero = _mm256_setzero_ps();
+		for (size_t i = 0; i < count; i += 8) {
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < 6; p++) {
+				__m256 distance = _mm256_set1_ps(planes[p].w);
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(planes[p].x), _mm256_loadu_ps(corners[p][0] + i)));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(planes[p].y), _mm256_loadu_ps(corners[p][1] + i)));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(planes[p].z), _mm256_loadu_ps(corners[p][2] + i)));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, zero, _CMP_GE_OQ));
+			}
+
+			unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(inside));
+			while (mask != 0) {
+				unsigned lane = 0;
+				while (((mask >> lane) & 1) == 0) lane++;
+				mask &= mask - 1;
+				if (i + lane < count) visible[visibleCount++] = static_cast<uint32_t>(i + lane);
+			}
+		}
+		return visibleCount;
+	}
+#else
+	bool frustumAvx2Compiled() { return false; }
+
+	size_t frustumCullAvx2(const float* const[6], size_t, const glm::vec4*, uint32_t*) { return 0; }
+#endif
+}
@@ -0,0 +1,52 @@
+#include "vmc_gpu_timer.hpp"
+
+// std
+#include <stdexcept>
+
+namespace vmc {
+	VmcGpuTimer::VmcGpuTimer(VmcDevice& device) : vmcDevice{ device } {
+		const uint32_t validBits = vmcDevice.getTimestampValidBits();
+		if (validBits == 0) return;
+		timestampMask = validBits >= 64 ? ~uint64_t{ 0 } : (uint64_t{ 1 } << validBits) - 1;
+
+		VkQueryPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		poolInfo.queryCount = 2 * VmcSwapChain::MAX_FRAMES_IN_FLIGHT;
+		if (vkCreateQueryPool(vmcDevice.device(), &poolInfo, nullptr, &queryPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create timestamp query pool");
+		}
+	}
+
+	VmcGpuTimer::~VmcGpuTimer() {
+		if (queryPool != VK_NULL_HANDLE) vkDestroyQueryPool(vmcDevice.device(), queryPool, nullptr);
+	}
+
+	void VmcGpuTimer::begin(VkCommandBuffer commandBuffer, int frameIndex) {
+		if (!isSupported()) return;
+		const uint32_t first = 2 * static_cast<uint32_t>(frameIndex);
+		vkCmdResetQueryPool(commandBuffer, queryPool, first, 2);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, first);
+	}
+
+	void VmcGpuTimer::end(VkCommandBuffer commandBuffer, int frameIndex) {
+		if (!isSupported()) return;
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 2 * static_cast<uint32_t>(frameIndex) + 1);
+		pending[frameIndex] = true;
+	}
+
+	bool VmcGpuTimer::read(int frameIndex, double& ms) {
+		if (!pending[frameIndex]) return false;
+		pending[frameIndex] = false;
+
+		uint64_t timestamps[2];
+		if (vkGetQueryPoolResults(vmcDevice.device(), queryPool, 2 * static_cast<uint32_t>(frameIndex), 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS) {
+			return false;
+		}
+		// ticks to nanoseconds, masked in case the counter wrapped in between
+		const uint64_t ticks = (timestamps[1] - timestamps[0]) & timestampMask;
+		ms = static_cast<double>(ticks) * vmcDevice.properties.limits.timestampPeriod / 1e6;
+		return true;
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "vmc_device.hpp"
+#include "vmc_swap_chain.hpp"
+
+// std
+#include <array>
+
+namespace vmc {
+	// gpu time of a whole frame, from timestamps written at the start and end of its command buffer. a frame slot's
+	// result can be read once the renderer's beginFrame has waited on that slot's fence again
+	class VmcGpuTimer {
+	public:
+		explicit VmcGpuTimer(VmcDevice& device);
+		~VmcGpuTimer();
+
+		VmcGpuTimer(const VmcGpuTimer&) = delete;
+		VmcGpuTimer& operator=(const VmcGpuTimer&) = delete;
+
+		// false when the graphics queue can't write timestamps, begin and end then do nothing
+		bool isSupported() const { return queryPool != VK_NULL_HANDLE; }
+
+		// resets the slot's queries and writes the first timestamp, before anything else is recorded
+		void begin(VkCommandBuffer commandBuffer, int frameIndex);
+		void end(VkCommandBuffer commandBuffer, int frameIndex);
+		// the time the last frame recorded into this slot took on the gpu, false when there is none to read.
+		// blocks if that frame hasn't finished yet
+		bool read(int frameIndex, double& ms);
+
+	private:
+		VmcDevice& vmcDevice;
+		VkQueryPool queryPool = VK_NULL_HANDLE;
+		uint64_t timestampMask = 0;
+		// slots with a frame whose timestamps haven't been read yet
+		std::array<bool, VmcSwapChain::MAX_FRAMES_IN_FLIGHT> pending{};
+	};
+}
@@ -0,0 +1,277 @@
+#include "vmc_hiz_pyramid.hpp"
+
+// std
+#include <algorithm>
+#include <stdexcept>
+
+namespace vmc {
+	struct ReducePushConstants {
+		glm::ivec2 sourceSize;
+		glm::ivec2 destinationSize;
+	};
+
+	static VkExtent2D levelExtent(VkExtent2D extent, uint32_t level) {
+		return { std::max(1u, extent.width >> level), std::max(1u, extent.height >> level) };
+	}
+
+	VmcHiZPyramid::VmcHiZPyramid(VmcDevice& device, VkExtent2D extent, VmcPipelineBatch& pipelines) : vmcDevice{ device }, extent{ extent } {
+		VkSamplerCreateInfo samplerInfo{};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = VK_FILTER_NEAREST;
+		samplerInfo.minFilter = VK_FILTER_NEAREST;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.minLod = .0f;
+		samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+		if (vkCreateSampler(vmcDevice.device(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create hi-z sampler");
+		}
+
+		createPipelineLayout();
+		pipelines.add([this] { createPipeline(); });
+		createImage();
+		createDescriptors();
+	}
+
+	VmcHiZPyramid::~VmcHiZPyramid() {
+		destroyImage();
+		reducePipeline = nullptr;
+		vkDestroyPipelineLayout(vmcDevice.device(), pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(vmcDevice.device(), descriptorSetLayout, nullptr);
+		vkDestroySampler(vmcDevice.device(), sampler, nullptr);
+	}
+
+	void VmcHiZPyramid::createPipelineLayout() {
+		VkDescriptorSetLayoutBinding bindings[2]{};
+		bindings[0].binding = 0;
+		bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		bindings[0].descriptorCount = 1;
+		bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		bindings[1].binding = 1;
+		bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		bindings[1].descriptorCount = 1;
+		bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = 2;
+		layoutInfo.pBindings = bindings;
+		if (vkCreateDescriptorSetLayout(vmcDevice.device(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create hi-z descriptor set layout");
+		}
+
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(ReducePushConstants);
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+		if (vkCreatePipelineLayout(vmcDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create hi-z pipeline layout");
+		}
+	}
+
+	void VmcHiZPyramid::createPipeline() {
+		reducePipeline = std::make_unique<VmcPipeline>(vmcDevice, "hiz_reduce.comp.spv", pipelineLayout);
+	}
+
+	void VmcHiZPyramid::createImage() {
+		levelCount = 1;
+		while ((std::max(extent.width, extent.height) >> levelCount) > 0) levelCount++;
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent.width = extent.width;
+		imageInfo.extent.height = extent.height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = levelCount;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = VK_FORMAT_R32_SFLOAT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		vmcDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageMemory);
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = VK_FORMAT_R32_SFLOAT;
+		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = levelCount;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+		if (vkCreateImageView(vmcDevice.device(), &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create hi-z image view");
+		}
+
+		levelViews.resize(levelCount);
+		for (uint32_t level = 0; level < levelCount; level++) {
+			viewInfo.subresourceRange.baseMipLevel = level;
+			viewInfo.subresourceRange.levelCount = 1;
+			if (vkCreateImageView(vmcDevice.device(), &viewInfo, nullptr, &levelViews[level]) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create hi-z level view");
+			}
+		}
+
+		// the pyramid never leaves GENERAL, it is written as a storage image and sampled in the same layout
+		VkCommandBuffer commandBuffer = vmcDevice.beginSingleTimeCommands();
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1 };
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		vmcDevice.endSingleTimeCommands(commandBuffer);
+		built = false;
+	}
+
+	void VmcHiZPyramid::destroyImage() {
+		if (image == VK_NULL_HANDLE) return;
+		vkDestroyDescriptorPool(vmcDevice.device(), descriptorPool, nullptr);
+		for (VkImageView view : levelViews) vkDestroyImageView(vmcDevice.device(), view, nullptr);
+		levelViews.clear();
+		levelSets.clear();
+		vkDestroyImageView(vmcDevice.device(), imageView, nullptr);
+		vkDestroyImage(vmcDevice.device(), image, nullptr);
+		vkFreeMemory(vmcDevice.device(), imageMemory, nullptr);
+		image = VK_NULL_HANDLE;
+	}
+
+	void VmcHiZPyramid::createDescriptors() {
+		const uint32_t setCount = VmcSwapChain::MAX_FRAMES_IN_FLIGHT + levelCount - 1;
+		VkDescriptorPoolSize poolSizes[2]{};
+		poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		poolSizes[0].descriptorCount = setCount;
+		poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		poolSizes[1].descriptorCount = setCount;
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.maxSets = setCount;
+		poolInfo.poolSizeCount = 2;
+		poolInfo.pPoolSizes = poolSizes;
+		if (vkCreateDescriptorPool(vmcDevice.device(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create hi-z descriptor pool");
+		}
+
+		std::vector<VkDescriptorSetLayout> layouts(setCount, descriptorSetLayout);
+		std::vector<VkDescriptorSet> sets(setCount);
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = descriptorPool;
+		allocInfo.descriptorSetCount = setCount;
+		allocInfo.pSetLayouts = layouts.data();
+		if (vkAllocateDescriptorSets(vmcDevice.device(), &allocInfo, sets.data()) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate hi-z descriptor sets");
+		}
+		std::copy(sets.begin(), sets.begin() + VmcSwapChain::MAX_FRAMES_IN_FLIGHT, depthSets.begin());
+		levelSets.assign(sets.begin() + VmcSwapChain::MAX_FRAMES_IN_FLIGHT, sets.end());
+
+		// the depth sets only get their destination now, the source is written every build
+		for (VkDescriptorSet set : depthSets) {
+			VkDescriptorImageInfo destinationInfo{ VK_NULL_HANDLE, levelViews[0], VK_IMAGE_LAYOUT_GENERAL };
+			VkWriteDescriptorSet write{};
+			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write.dstSet = set;
+			write.dstBinding = 1;
+			write.descriptorCount = 1;
+			write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			write.pImageInfo = &destinationInfo;
+			vkUpdateDescriptorSets(vmcDevice.device(), 1, &write, 0, nullptr);
+		}
+
+		for (uint32_t level = 1; level < levelCount; level++) {
+			VkDescriptorImageInfo imageInfos[2]{};
+			imageInfos[0] = { sampler, levelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL };
+			imageInfos[1] = { VK_NULL_HANDLE, levelViews[level], VK_IMAGE_LAYOUT_GENERAL };
+
+			VkWriteDescriptorSet writes[2]{};
+			for (uint32_t i = 0; i < 2; i++) {
+				writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				writes[i].dstSet = levelSets[level - 1];
+				writes[i].dstBinding = i;
+				writes[i].descriptorCount = 1;
+				writes[i].pImageInfo = &imageInfos[i];
+			}
+			writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			vkUpdateDescriptorSets(vmcDevice.device(), 2, writes, 0, nullptr);
+		}
+	}
+
+	void VmcHiZPyramid::resize(VkExtent2D newExtent) {
+		vkDeviceWaitIdle(vmcDevice.device());
+		destroyImage();
+		extent = newExtent;
+		createImage();
+		createDescriptors();
+	}
+
+	void VmcHiZPyramid::build(VkCommandBuffer commandBuffer, int frameIndex, VkImageView depthView, const glm::mat4& newViewProjection, const glm::mat4& newProjection) {
+		// beginFrame waited on this frame's fence, so nothing reads the set anymore
+		VkDescriptorImageInfo depthInfo{ sampler, depthView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = depthSets[frameIndex];
+		write.dstBinding = 0;
+		write.descriptorCount = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write.pImageInfo = &depthInfo;
+		vkUpdateDescriptorSets(vmcDevice.device(), 1, &write, 0, nullptr);
+
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+
+		// the culling passes of earlier frames sample the whole pyramid, they have to be done before it is overwritten
+		barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1 };
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		reducePipeline->bind(commandBuffer);
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		for (uint32_t level = 0; level < levelCount; level++) {
+			const VkExtent2D source = levelExtent(extent, level == 0 ? 0 : level - 1);
+			const VkExtent2D destination = levelExtent(extent, level);
+			ReducePushConstants push{};
+			push.sourceSize = { static_cast<int>(source.width), static_cast<int>(source.height) };
+			push.destinationSize = { static_cast<int>(destination.width), static_cast<int>(destination.height) };
+
+			VkDescriptorSet set = level == 0 ? depthSets[frameIndex] : levelSets[level - 1];
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &set, 0, nullptr);
+			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ReducePushConstants), &push);
+			vkCmdDispatch(commandBuffer, (destination.width + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, (destination.height + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+
+			// the next level reads this one, and the culling pass after the build reads all of them
+			barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		}
+
+		viewProjection = newViewProjection;
+		projection = newProjection;
+		built = true;
+	}
+}
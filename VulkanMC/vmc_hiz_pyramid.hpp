@@ -0,0 +1,77 @@
+#pragma once
+
+#include "vmc_device.hpp"
+#include "vmc_pipeline.hpp"
+#include "vmc_swap_chain.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace vmc {
+	// a mip chain over the depth buffer where every texel holds the furthest depth of the pixels under it, so a box
+	// can be tested for occlusion with four samples from the level where it covers about one texel. the matrices the
+	// depth was rendered with are kept next to it so later frames can project into it
+	class VmcHiZPyramid {
+	public:
+		static constexpr uint32_t WORKGROUP_SIZE = 8;
+
+		// the reduction pipeline is added to pipelines, build can't be called until it has been built
+		VmcHiZPyramid(VmcDevice& device, VkExtent2D extent, VmcPipelineBatch& pipelines);
+		~VmcHiZPyramid();
+
+		VmcHiZPyramid(const VmcHiZPyramid&) = delete;
+		VmcHiZPyramid& operator=(const VmcHiZPyramid&) = delete;
+
+		// recreates the pyramid for a new swap chain size, waits for the device to go idle first.
+		// the contents are garbage until the next build
+		void resize(VkExtent2D extent);
+		// reduces the depth of the first pass into every level, outside of a render pass. the depth view has
+		// to be in DEPTH_STENCIL_READ_ONLY_OPTIMAL
+		void build(VkCommandBuffer commandBuffer, int frameIndex, VkImageView depthView, const glm::mat4& viewProjection, const glm::mat4& projection);
+
+		bool isBuilt() const { return built; }
+		VkExtent2D getExtent() const { return extent; }
+		uint32_t getLevelCount() const { return levelCount; }
+		// the whole chain, sampled in VK_IMAGE_LAYOUT_GENERAL with getSampler
+		VkImageView getImageView() const { return imageView; }
+		VkSampler getSampler() const { return sampler; }
+		// what the depth in the pyramid was rendered with, world space for sections and view space for entities
+		const glm::mat4& getViewProjection() const { return viewProjection; }
+		const glm::mat4& getProjection() const { return projection; }
+
+	private:
+		void createPipelineLayout();
+		void createPipeline();
+		void createImage();
+		void destroyImage();
+		void createDescriptors();
+
+		VmcDevice& vmcDevice;
+		VkExtent2D extent;
+		uint32_t levelCount = 0;
+		bool built = false;
+		glm::mat4 viewProjection{ 1.f };
+		glm::mat4 projection{ 1.f };
+
+		VkSampler sampler;
+		VkDescriptorSetLayout descriptorSetLayout;
+		VkPipelineLayout pipelineLayout;
+		std::unique_ptr<VmcPipeline> reducePipeline;
+
+		VkImage image = VK_NULL_HANDLE;
+		VkDeviceMemory imageMemory;
+		VkImageView imageView;
+		std::vector<VkImageView> levelViews;
+		VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+		// the first level reads this frame's depth attachment, which changes with the swap chain image
+		std::array<VkDescriptorSet, VmcSwapChain::MAX_FRAMES_IN_FLIGHT> depthSets;
+		// level i reads level i - 1, starting at level 1
+		std::vector<VkDescriptorSet> levelSets;
+	};
+}
@@ -0,0 +1,132 @@
+#include "vmc_job_system.hpp"
+
+// std
+#include <algorithm>
+
+namespace vmc {
+	// index of the worker running on this thread, -1 on any thread that isn't part of a pool
+	static thread_local int currentWorker = -1;
+	static thread_local const VmcJobSystem* currentSystem = nullptr;
+
+	VmcJobSystem::VmcJobSystem(unsigned workerCount) {
+		if (workerCount == 0) {
+			const unsigned hardwareThreads = std::thread::hardware_concurrency();
+			workerCount = std::max(1u, hardwareThreads > 1 ? hardwareThreads - 1 : 1u);
+		}
+
+		queues.reserve(workerCount);
+		for (unsigned i = 0; i < workerCount; i++) {
+			queues.push_back(std::make_unique<WorkerQueue>());
+		}
+		threads.reserve(workerCount);
+		for (unsigned i = 0; i < workerCount; i++) {
+			threads.emplace_back([this, i] { workerLoop(i); });
+		}
+	}
+
+	VmcJobSystem::~VmcJobSystem() {
+		waitIdle();
+		{
+			std::lock_guard<std::mutex> lock{ sleepMutex };
+			stopping = true;
+		}
+		wakeCondition.notify_all();
+		for (auto& thread : threads) thread.join();
+	}
+
+	void VmcJobSystem::submit(Job job) {
+		unsigned index;
+		if (currentSystem == this) {
+			index = static_cast<unsigned>(currentWorker);
+		}
+		else {
+			index = nextQueue.fetch_add(1, std::memory_order_relaxed) % static_cast<unsigned>(queues.size());
+		}
+
+		pendingJobs.fetch_add(1, std::memory_order_relaxed);
+		{
+			std::lock_guard<std::mutex> lock{ queues[index]->mutex };
+			queues[index]->jobs.push_back(std::move(job));
+		}
+
+		// the counter is bumped under the sleep mutex so a worker can't check it and then miss the notify
+		{
+			std::lock_guard<std::mutex> lock{ sleepMutex };
+			queuedJobs.fetch_add(1, std::memory_order_relaxed);
+		}
+		wakeCondition.notify_one();
+	}
+
+	void VmcJobSystem::waitIdle() {
+		Job job;
+		while (pendingJobs.load(std::memory_order_acquire) > 0) {
+			// help out instead of just blocking
+			if (stealJob(static_cast<unsigned>(queues.size()), job)) {
+				runJob(job);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock{ sleepMutex };
+			idleCondition.wait(lock, [this] {
+				return pendingJobs.load(std::memory_order_acquire) == 0 || queuedJobs.load(std::memory_order_relaxed) > 0;
+			});
+		}
+	}
+
+	void VmcJobSystem::workerLoop(unsigned index) {
+		currentWorker = static_cast<int>(index);
+		currentSystem = this;
+
+		Job job;
+		while (true) {
+			if (popJob(index, job) || stealJob(index, job)) {
+				runJob(job);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock{ sleepMutex };
+			wakeCondition.wait(lock, [this] { return stopping || queuedJobs.load(std::memory_order_relaxed) > 0; });
+			if (stopping && queuedJobs.load(std::memory_order_relaxed) == 0) return;
+		}
+	}
+
+	bool VmcJobSystem::popJob(unsigned index, Job& job) {
+		WorkerQueue& queue = *queues[index];
+		std::lock_guard<std::mutex> lock{ queue.mutex };
+		if (queue.jobs.empty()) return false;
+
+		job = std::move(queue.jobs.back());
+		queue.jobs.pop_back();
+		queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	bool VmcJobSystem::stealJob(unsigned thief, Job& job) {
+		const unsigned count = static_cast<unsigned>(queues.size());
+		// start at a different victim for every thief so they don't all hammer queue 0
+		for (unsigned i = 1; i <= count; i++) {
+			const unsigned victim = (thief + i) % count;
+			if (victim == thief) continue;
+
+			WorkerQueue& queue = *queues[victim];
+			std::unique_lock<std::mutex> lock{ queue.mutex, std::try_to_lock };
+			if (!lock.owns_lock() || queue.jobs.empty()) continue;
+
+			job = std::move(queue.jobs.front());
+			queue.jobs.pop_front();
+			queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+		return false;
+	}
+
+	void VmcJobSystem::runJob(Job& job) {
+		job();
+		job = nullptr;
+
+		if (pendingJobs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			std::lock_guard<std::mutex> lock{ sleepMutex };
+			idleCondition.notify_all();
+		}
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vmc {
+	// a fixed pool of worker threads, each with its own job deque. a worker pops the newest job from its own deque
+	// and when that is empty steals the oldest job from another worker, so long running jobs don't leave cores idle
+	class VmcJobSystem {
+	public:
+		using Job = std::function<void()>;
+
+		// 0 picks one worker per hardware thread, minus one for the main thread
+		explicit VmcJobSystem(unsigned workerCount = 0);
+		~VmcJobSystem();
+
+		VmcJobSystem(const VmcJobSystem&) = delete;
+		VmcJobSystem& operator=(const VmcJobSystem&) = delete;
+
+		// jobs submitted from a worker go to that worker's deque, everything else is spread round robin
+		void submit(Job job);
+		// runs jobs on the calling thread until every submitted job has finished
+		void waitIdle();
+
+		unsigned getWorkerCount() const { return static_cast<unsigned>(threads.size()); }
+		// jobs sitting in a deque that no worker has picked up yet
+		size_t getQueuedJobCount() const { return queuedJobs.load(std::memory_order_relaxed); }
+		// queued plus currently running
+		size_t getPendingJobCount() const { return pendingJobs.load(std::memory_order_relaxed); }
+
+	private:
+		struct WorkerQueue {
+			std::mutex mutex;
+			std::deque<Job> jobs;
+		};
+
+		void workerLoop(unsigned index);
+		bool popJob(unsigned index, Job& job);
+		bool stealJob(unsigned thief, Job& job);
+		void runJob(Job& job);
+
+		std::vector<std::unique_ptr<WorkerQueue>> queues;
+		std::vector<std::thread> threads;
+
+		std::atomic<size_t> queuedJobs{ 0 };
+		std::atomic<size_t> pendingJobs{ 0 };
+		std::atomic<unsigned> nextQueue{ 0 };
+
+		std::mutex sleepMutex;
+		std::condition_variable wakeCondition;
+		std::condition_variable idleCondition;
+		bool stopping = false;
+	};
+}
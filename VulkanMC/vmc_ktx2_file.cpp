@@ -0,0 +1,219 @@
+#include "vmc_ktx2_file.hpp"
+
+// std
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace vmc {
+	static const uint8_t KTX2_IDENTIFIER[12] = { 0xab, 0x4b, 0x54, 0x58, 0x20, 0x32, 0x30, 0xbb, 0x0d, 0x0a, 0x1a, 0x0a };
+
+	struct Ktx2Header {
+		uint8_t identifier[12];
+		uint32_t vkFormat;
+		uint32_t typeSize;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t layerCount;
+		uint32_t faceCount;
+		uint32_t levelCount;
+		uint32_t supercompressionScheme;
+		uint32_t dfdByteOffset;
+		uint32_t dfdByteLength;
+		uint32_t kvdByteOffset;
+		uint32_t kvdByteLength;
+		uint64_t sgdByteOffset;
+		uint64_t sgdByteLength;
+	};
+	static_assert(sizeof(Ktx2Header) == 80, "ktx2 header is 80 bytes");
+
+	struct Ktx2LevelIndex {
+		uint64_t byteOffset;
+		uint64_t byteLength;
+		uint64_t uncompressedByteLength;
+	};
+
+	// khronos data format values for the basic descriptor block
+	static constexpr uint32_t DF_MODEL_RGBSDA = 1;
+	static constexpr uint32_t DF_MODEL_BC1A = 128;
+	static constexpr uint32_t DF_MODEL_BC7 = 134;
+	static constexpr uint32_t DF_PRIMARIES_BT709 = 1;
+	static constexpr uint32_t DF_TRANSFER_SRGB = 2;
+	static constexpr uint32_t DF_CHANNEL_ALPHA = 15;
+	static constexpr uint32_t DF_CHANNEL_BC1A_ALPHA = 1;
+	static constexpr uint32_t DF_SAMPLE_LINEAR = 0x10;
+
+	static bool isBc1(VkFormat format) { return format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK || format == VK_FORMAT_BC1_RGBA_UNORM_BLOCK; }
+	static bool isBc7(VkFormat format) { return format == VK_FORMAT_BC7_SRGB_BLOCK || format == VK_FORMAT_BC7_UNORM_BLOCK; }
+	static bool isSrgb(VkFormat format) {
+		return format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK;
+	}
+	// bytes per texel block, also what every level is aligned to in the file
+	static uint32_t blockBytes(VkFormat format) { return isBc1(format) ? 8 : isBc7(format) ? 16 : 4; }
+
+	static uint64_t alignUp(uint64_t value, uint64_t alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+	static std::vector<uint32_t> dataFormatDescriptor(VkFormat format) {
+		struct Sample {
+			uint32_t bitOffset;
+			uint32_t bitLength;
+			uint32_t channel;
+			uint32_t upper;
+		};
+		std::vector<Sample> samples;
+		uint32_t model = DF_MODEL_RGBSDA;
+		uint32_t blockDimension = 0;
+		if (isBc1(format)) {
+			model = DF_MODEL_BC1A;
+			blockDimension = 3;
+			samples.push_back({ 0, 64, DF_CHANNEL_BC1A_ALPHA, UINT32_MAX });
+		}
+		else if (isBc7(format)) {
+			model = DF_MODEL_BC7;
+			blockDimension = 3;
+			samples.push_back({ 0, 128, 0, UINT32_MAX });
+		}
+		else {
+			for (uint32_t c = 0; c < 4; c++) {
+				// alpha is never srgb encoded
+				const uint32_t channel = c == 3 ? DF_CHANNEL_ALPHA | (isSrgb(format) ? DF_SAMPLE_LINEAR : 0) : c;
+				samples.push_back({ c * 8, 8, channel, 255 });
+			}
+		}
+
+		const uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+		std::vector<uint32_t> words;
+		words.push_back(4 + blockSize);
+		words.push_back(0);
+		words.push_back(2 | blockSize << 16);
+		words.push_back(model | DF_PRIMARIES_BT709 << 8 | (isSrgb(format) ? DF_TRANSFER_SRGB : 1) << 16);
+		words.push_back(blockDimension | blockDimension << 8);
+		words.push_back(blockBytes(format));
+		words.push_back(0);
+		for (const Sample& sample : samples) {
+			words.push_back(sample.bitOffset | (sample.bitLength - 1) << 16 | sample.channel << 24);
+			words.push_back(0);
+			words.push_back(0);
+			words.push_back(sample.upper);
+		}
+		return words;
+	}
+
+	bool VmcKtx2File::isSupportedFormat(VkFormat format) { return format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_R8G8B8A8_UNORM || isBc1(format) || isBc7(format); }
+
+	uint64_t VmcKtx2File::layerBytes(VkFormat format, uint32_t width, uint32_t height) {
+		if (isBc1(format) || isBc7(format)) return uint64_t{ blockBytes(format) } * ((width + 3) / 4) * ((height + 3) / 4);
+		return uint64_t{ 4 } * width * height;
+	}
+
+	bool VmcKtx2File::write(const std::string& path, const Ktx2Image& image, const std::string& writer) {
+		if (!isSupportedFormat(image.format) || image.levels.empty()) return false;
+		const uint32_t levelCount = static_cast<uint32_t>(image.levels.size());
+
+		Ktx2Header header{};
+		std::memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+		header.vkFormat = static_cast<uint32_t>(image.format);
+		header.typeSize = 1;
+		header.pixelWidth = image.width;
+		header.pixelHeight = image.height;
+		header.layerCount = image.layerCount;
+		header.faceCount = 1;
+		header.levelCount = levelCount;
+
+		const std::vector<uint32_t> dfd = dataFormatDescriptor(image.format);
+		header.dfdByteOffset = static_cast<uint32_t>(sizeof(Ktx2Header) + sizeof(Ktx2LevelIndex) * levelCount);
+		header.dfdByteLength = static_cast<uint32_t>(dfd.size() * 4);
+
+		// a single KTXwriter entry, key and value both null terminated
+		std::vector<uint8_t> kvd;
+		const std::string key = "KTXwriter";
+		const uint32_t entryLength = static_cast<uint32_t>(key.size() + 1 + writer.size() + 1);
+		kvd.resize(4);
+		std::memcpy(kvd.data(), &entryLength, 4);
+		kvd.insert(kvd.end(), key.begin(), key.end());
+		kvd.push_back(0);
+		kvd.insert(kvd.end(), writer.begin(), writer.end());
+		kvd.push_back(0);
+		kvd.resize(alignUp(kvd.size(), 4), 0);
+		header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+		header.kvdByteLength = static_cast<uint32_t>(kvd.size());
+
+		// the smallest level comes first in the file, each one aligned to the texel block
+		std::vector<Ktx2LevelIndex> levelIndex(levelCount);
+		uint64_t offset = header.kvdByteOffset + header.kvdByteLength;
+		for (uint32_t level = levelCount; level-- > 0;) {
+			offset = alignUp(offset, blockBytes(image.format));
+			levelIndex[level] = { offset, image.levels[level].size(), image.levels[level].size() };
+			offset += image.levels[level].size();
+		}
+
+		// written next to it first, like the pipeline cache
+		const std::string tempPath = path + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open()) return false;
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(levelIndex.data()), static_cast<std::streamsize>(sizeof(Ktx2LevelIndex) * levelCount));
+			file.write(reinterpret_cast<const char*>(dfd.data()), static_cast<std::streamsize>(dfd.size() * 4));
+			file.write(reinterpret_cast<const char*>(kvd.data()), static_cast<std::streamsize>(kvd.size()));
+			uint64_t position = header.kvdByteOffset + header.kvdByteLength;
+			for (uint32_t level = levelCount; level-- > 0;) {
+				const std::vector<char> padding(static_cast<size_t>(levelIndex[level].byteOffset - position), 0);
+				file.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+				file.write(reinterpret_cast<const char*>(image.levels[level].data()), static_cast<std::streamsize>(image.levels[level].size()));
+				position = levelIndex[level].byteOffset + levelIndex[level].byteLength;
+			}
+			if (!file) return false;
+		}
+		std::remove(path.c_str());
+		return std::rename(tempPath.c_str(), path.c_str()) == 0;
+	}
+
+	bool VmcKtx2File::read(const std::string& path, Ktx2Image& image, std::string* error) {
+		auto fail = [error](const char* reason) {
+			if (error != nullptr) *error = reason;
+			return false;
+		};
+
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file.is_open()) return fail("can't be opened");
+		const uint64_t fileBytes = static_cast<uint64_t>(file.tellg());
+		file.seekg(0);
+		Ktx2Header header{};
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (!file || std::memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) return fail("isn't a ktx2 file");
+
+		const VkFormat format = static_cast<VkFormat>(header.vkFormat);
+		if (!isSupportedFormat(format)) return fail("has an unsupported format");
+		if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth > 1 || header.faceCount != 1) return fail("isn't a 2d texture");
+		if (header.pixelWidth > MAX_DIMENSION || header.pixelHeight > MAX_DIMENSION || header.layerCount > MAX_LAYERS) return fail("is too large");
+		if (header.supercompressionScheme != 0) return fail("is supercompressed");
+		// 0 would leave building the mips to the loader, baked files always carry them
+		if (header.levelCount == 0) return fail("has no mip levels");
+		uint32_t maxLevels = 1;
+		while ((std::max(header.pixelWidth, header.pixelHeight) >> maxLevels) > 0) maxLevels++;
+		if (header.levelCount > maxLevels) return fail("has more mip levels than its size allows");
+
+		std::vector<Ktx2LevelIndex> levelIndex(header.levelCount);
+		file.read(reinterpret_cast<char*>(levelIndex.data()), static_cast<std::streamsize>(sizeof(Ktx2LevelIndex) * header.levelCount));
+		if (!file) return fail("is cut short");
+
+		image.format = format;
+		image.width = header.pixelWidth;
+		image.height = header.pixelHeight;
+		image.layerCount = std::max(1u, header.layerCount);
+		image.levels.assign(header.levelCount, {});
+		for (uint32_t level = 0; level < header.levelCount; level++) {
+			const uint64_t expected = layerBytes(format, std::max(1u, image.width >> level), std::max(1u, image.height >> level)) * image.layerCount;
+			if (levelIndex[level].byteLength != expected) return fail("has a level of the wrong size");
+			if (levelIndex[level].byteOffset > fileBytes || expected > fileBytes - levelIndex[level].byteOffset) return fail("is cut short");
+			image.levels[level].resize(static_cast<size_t>(expected));
+			file.seekg(static_cast<std::streamoff>(levelIndex[level].byteOffset));
+			file.read(reinterpret_cast<char*>(image.levels[level].data()), static_cast<std::streamsize>(expected));
+			if (!file) return fail("is cut short");
+		}
+		return true;
+	}
+}
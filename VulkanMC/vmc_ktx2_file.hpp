@@ -0,0 +1,45 @@
+#pragma once
+
+#include "vmc_device.hpp"
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vmc {
+	// a 2d texture or texture array with its mip chain, as stored in a ktx2 file
+	struct Ktx2Image {
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t layerCount = 1;
+		// level 0 first, each level holds all of its layers one after the other
+		std::vector<std::vector<uint8_t>> levels;
+
+		uint64_t dataBytes() const {
+			uint64_t bytes = 0;
+			for (const std::vector<uint8_t>& level : levels) bytes += level.size();
+			return bytes;
+		}
+	};
+
+	// reads and writes the parts of ktx2 the engine needs: 2d arrays of uncompressed rgba8 or bc1/bc7 blocks with no
+	// supercompression. files are written with a data format descriptor so other ktx tools can open them, reading
+	// only trusts the header and the level index
+	class VmcKtx2File {
+	public:
+		// read turns down anything bigger, sizes in the header are checked before any of them is allocated
+		static constexpr uint32_t MAX_DIMENSION = 16384;
+		static constexpr uint32_t MAX_LAYERS = 2048;
+
+		// false when the file couldn't be written
+		static bool write(const std::string& path, const Ktx2Image& image, const std::string& writer);
+		// false when the file doesn't exist or isn't something write could have produced, error says why
+		static bool read(const std::string& path, Ktx2Image& image, std::string* error = nullptr);
+
+		// bytes in one layer of a level, for the formats above
+		static uint64_t layerBytes(VkFormat format, uint32_t width, uint32_t height);
+		static bool isSupportedFormat(VkFormat format);
+	};
+}
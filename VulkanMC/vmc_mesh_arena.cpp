@@ -0,0 +1,149 @@
+#include "vmc_mesh_arena.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+namespace vmc {
+	VmcMeshArena::RangeAllocator::RangeAllocator(uint32_t capacity) : capacity{ capacity } {
+		addFree(0, capacity);
+	}
+
+	void VmcMeshArena::RangeAllocator::addFree(uint32_t offset, uint32_t count) {
+		freeRanges[offset] = count;
+		freeBySize.emplace(count, offset);
+	}
+
+	void VmcMeshArena::RangeAllocator::removeFree(std::map<uint32_t, uint32_t>::iterator range) {
+		freeBySize.erase({ range->second, range->first });
+		freeRanges.erase(range);
+	}
+
+	bool VmcMeshArena::RangeAllocator::allocate(uint32_t count, uint32_t& offset) {
+		if (count == 0) {
+			offset = 0;
+			return true;
+		}
+		auto best = freeBySize.lower_bound({ count, 0 });
+		if (best == freeBySize.end()) return false;
+
+		offset = best->second;
+		const uint32_t remaining = best->first - count;
+		removeFree(freeRanges.find(offset));
+		if (remaining > 0) addFree(offset + count, remaining);
+		used += count;
+		return true;
+	}
+
+	void VmcMeshArena::RangeAllocator::free(uint32_t offset, uint32_t count) {
+		if (count == 0) return;
+		used -= count;
+
+		auto next = freeRanges.lower_bound(offset);
+		if (next != freeRanges.end() && offset + count == next->first) {
+			count += next->second;
+			removeFree(next);
+		}
+		auto previous = freeRanges.lower_bound(offset);
+		if (previous != freeRanges.begin()) {
+			previous = std::prev(previous);
+			if (previous->first + previous->second == offset) {
+				offset = previous->first;
+				count += previous->second;
+				removeFree(previous);
+			}
+		}
+		addFree(offset, count);
+	}
+
+	ArenaOccupancy VmcMeshArena::RangeAllocator::occupancy() const {
+		ArenaOccupancy result;
+		result.capacity = capacity;
+		result.used = used;
+		result.freeRanges = static_cast<uint32_t>(freeRanges.size());
+		result.largestFree = freeBySize.empty() ? 0 : freeBySize.rbegin()->first;
+		return result;
+	}
+
+	VmcMeshArena::VmcMeshArena(VmcDevice& device, VmcUploadManager& uploadManager, uint32_t vertexCapacity, uint32_t indexCapacity)
+		: vmcDevice{ device }, uploadManager{ uploadManager }, vertexRanges{ vertexCapacity }, indexRanges{ indexCapacity } {
+		const VkDeviceSize vertexSize = sizeof(VmcModel::Vertex) * VkDeviceSize{ vertexCapacity };
+		const VkDeviceSize indexSize = sizeof(uint32_t) * VkDeviceSize{ indexCapacity };
+		void* vertices = nullptr;
+		void* indices = nullptr;
+		if (vmcDevice.createMappedDeviceBuffer(vertexSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &vertexBuffer, &vertexMemory, &vertices)) {
+			if (vmcDevice.createMappedDeviceBuffer(indexSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &indexBuffer, &indexMemory, &indices)) {
+				mappedVertices = static_cast<VmcModel::Vertex*>(vertices);
+				mappedIndices = static_cast<uint32_t*>(indices);
+				return;
+			}
+			vmaDestroyBuffer(vmcDevice.vmaAllocator, vertexBuffer, vertexMemory);
+		}
+		vmcDevice.createBuffer(vertexSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY, &vertexBuffer,
+			&vertexMemory);
+		vmcDevice.createBuffer(indexSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY, &indexBuffer,
+			&indexMemory);
+	}
+
+	VmcMeshArena::~VmcMeshArena() {
+		vmaDestroyBuffer(vmcDevice.vmaAllocator, vertexBuffer, vertexMemory);
+		vmaDestroyBuffer(vmcDevice.vmaAllocator, indexBuffer, indexMemory);
+	}
+
+	MeshAllocation VmcMeshArena::allocate(const std::vector<VmcModel::Vertex>& vertices, const std::vector<uint32_t>& indices) {
+		const auto start = std::chrono::steady_clock::now();
+		MeshAllocation allocation;
+		allocation.vertexCount = static_cast<uint32_t>(vertices.size());
+		allocation.indexCount = static_cast<uint32_t>(indices.size());
+		if (!vertexRanges.allocate(allocation.vertexCount, allocation.firstVertex)) {
+			stats.failures++;
+			throw std::runtime_error("mesh arena is out of vertex space");
+		}
+		if (!indexRanges.allocate(allocation.indexCount, allocation.firstIndex)) {
+			vertexRanges.free(allocation.firstVertex, allocation.vertexCount);
+			stats.failures++;
+			throw std::runtime_error("mesh arena is out of index space");
+		}
+		const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+		stats.allocations++;
+		stats.allocateUs += us;
+		stats.maxAllocateUs = std::max(stats.maxAllocateUs, us);
+
+		// indices stay relative to the mesh, the draw adds firstVertex as its vertex offset
+		const VkDeviceSize vertexBytes = sizeof(VmcModel::Vertex) * vertices.size();
+		const VkDeviceSize indexBytes = sizeof(uint32_t) * indices.size();
+		if (isMapped()) {
+			std::memcpy(mappedVertices + allocation.firstVertex, vertices.data(), vertexBytes);
+			std::memcpy(mappedIndices + allocation.firstIndex, indices.data(), indexBytes);
+			vmaFlushAllocation(vmcDevice.vmaAllocator, vertexMemory, sizeof(VmcModel::Vertex) * VkDeviceSize{ allocation.firstVertex }, vertexBytes);
+			vmaFlushAllocation(vmcDevice.vmaAllocator, indexMemory, sizeof(uint32_t) * VkDeviceSize{ allocation.firstIndex }, indexBytes);
+			return allocation;
+		}
+		uploadManager.uploadBuffer(vertexBuffer, sizeof(VmcModel::Vertex) * VkDeviceSize{ allocation.firstVertex }, vertices.data(), vertexBytes,
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+		uploadManager.uploadBuffer(indexBuffer, sizeof(uint32_t) * VkDeviceSize{ allocation.firstIndex }, indices.data(), indexBytes,
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+		return allocation;
+	}
+
+	void VmcMeshArena::free(const MeshAllocation& allocation) {
+		if (allocation.empty()) return;
+		stats.frees++;
+		vertexRanges.free(allocation.firstVertex, allocation.vertexCount);
+		indexRanges.free(allocation.firstIndex, allocation.indexCount);
+	}
+
+	void VmcMeshArena::bind(VkCommandBuffer commandBuffer) {
+		VkBuffer buffers[] = { vertexBuffer };
+		VkDeviceSize offsets[] = { 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+	}
+
+	void VmcMeshArena::draw(VkCommandBuffer commandBuffer, const MeshAllocation& allocation) {
+		vkCmdDrawIndexed(commandBuffer, allocation.indexCount, 1, allocation.firstIndex, static_cast<int32_t>(allocation.firstVertex), 0);
+	}
+}
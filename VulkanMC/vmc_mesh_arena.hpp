@@ -0,0 +1,115 @@
+#pragma once
+
+#include "vmc_device.hpp"
+#include "vmc_model.hpp"
+#include "vmc_upload_manager.hpp"
+
+// std
+#include <cstdint>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace vmc {
+	// where a mesh lives inside the arena, vertexOffset and firstIndex are what an indexed draw needs
+	struct MeshAllocation {
+		uint32_t firstVertex = 0;
+		uint32_t vertexCount = 0;
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+
+		bool empty() const { return indexCount == 0; }
+	};
+
+	// how full one of the arena's buffers is and how badly its free space is broken up, in vertices or indices
+	struct ArenaOccupancy {
+		uint32_t capacity = 0;
+		uint32_t used = 0;
+		uint32_t freeRanges = 0;
+		uint32_t largestFree = 0;
+
+		float occupancy() const { return capacity == 0 ? .0f : static_cast<float>(used) / capacity; }
+		// 0 when all free space is in one range, close to 1 when it is spread over many small ones
+		float fragmentation() const {
+			const uint32_t free = capacity - used;
+			return free == 0 ? .0f : 1.f - static_cast<float>(largestFree) / free;
+		}
+	};
+
+	struct ArenaStats {
+		uint64_t allocations = 0;
+		uint64_t frees = 0;
+		// meshes that didn't fit
+		uint64_t failures = 0;
+		// finding the ranges, without writing the mesh
+		double allocateUs = 0.0;
+		double maxAllocateUs = 0.0;
+
+		double averageAllocateUs() const { return allocations == 0 ? 0.0 : allocateUs / allocations; }
+	};
+
+	// one big vertex buffer and one big index buffer shared by every chunk mesh, so the whole world is drawn with a
+	// single bind and draws only differ in their offsets. both live in device local memory, with resizable bar they stay
+	// mapped and meshes are written straight into them, otherwise they go through the upload manager's staging ring.
+	// freeing is immediate, callers have to wait until no frame in flight still reads a range before freeing it
+	class VmcMeshArena {
+	public:
+		VmcMeshArena(VmcDevice& device, VmcUploadManager& uploadManager, uint32_t vertexCapacity, uint32_t indexCapacity);
+		~VmcMeshArena();
+
+		VmcMeshArena(const VmcMeshArena&) = delete;
+		VmcMeshArena& operator=(const VmcMeshArena&) = delete;
+
+		// throws if either buffer is out of space. staged meshes can be drawn once the upload manager has submitted them
+		MeshAllocation allocate(const std::vector<VmcModel::Vertex>& vertices, const std::vector<uint32_t>& indices);
+		void free(const MeshAllocation& allocation);
+
+		void bind(VkCommandBuffer commandBuffer);
+		void draw(VkCommandBuffer commandBuffer, const MeshAllocation& allocation);
+
+		uint32_t getVertexCapacity() const { return vertexRanges.capacity; }
+		uint32_t getIndexCapacity() const { return indexRanges.capacity; }
+		uint32_t getUsedVertices() const { return vertexRanges.used; }
+		uint32_t getUsedIndices() const { return indexRanges.used; }
+		ArenaOccupancy getVertexOccupancy() const { return vertexRanges.occupancy(); }
+		ArenaOccupancy getIndexOccupancy() const { return indexRanges.occupancy(); }
+		const ArenaStats& getStats() const { return stats; }
+		void resetStats() { stats = {}; }
+		bool isMapped() const { return mappedVertices != nullptr; }
+
+	private:
+		// best fit over the free ranges, found through a set ordered by size so it doesn't have to walk all of them.
+		// the ranges are also kept by offset, so neighbours can be merged back together when freed
+		struct RangeAllocator {
+			uint32_t capacity = 0;
+			uint32_t used = 0;
+			std::map<uint32_t, uint32_t> freeRanges;
+			// (count, offset) of every free range, the smallest that fits comes first and ties go to the lowest offset
+			std::set<std::pair<uint32_t, uint32_t>> freeBySize;
+
+			explicit RangeAllocator(uint32_t capacity);
+			bool allocate(uint32_t count, uint32_t& offset);
+			void free(uint32_t offset, uint32_t count);
+			ArenaOccupancy occupancy() const;
+
+		private:
+			void addFree(uint32_t offset, uint32_t count);
+			void removeFree(std::map<uint32_t, uint32_t>::iterator range);
+		};
+
+		VmcDevice& vmcDevice;
+		VmcUploadManager& uploadManager;
+		RangeAllocator vertexRanges;
+		RangeAllocator indexRanges;
+
+		VkBuffer vertexBuffer;
+		VmaAllocation vertexMemory;
+		VmcModel::Vertex* mappedVertices = nullptr;
+		VkBuffer indexBuffer;
+		VmaAllocation indexMemory;
+		uint32_t* mappedIndices = nullptr;
+
+		ArenaStats stats;
+	};
+}
@@ -3,36 +3,72 @@
 #include <vma/vk_mem_alloc.h>
 
 #include <cassert>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
 
 namespace vmc {
 	VmcModel::VmcModel(VmcDevice& device, const std::vector<Vertex>& vertices) : vmcDevice{ device } {
-		createVertexBuffers(vertices);
+		createBuffers(vertices, {}, true);
+	}
+	VmcModel::VmcModel(VmcDevice& device, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, bool optimize) : vmcDevice{ device } {
+		createBuffers(vertices, indices, optimize);
 	}
 	VmcModel::~VmcModel() {
 
 		vmaDestroyBuffer(vmcDevice.vmaAllocator, vertexBuffer, vertexMemory);
+		vmaDestroyBuffer(vmcDevice.vmaAllocator, indexBuffer, indexMemory);
+	}
+	void VmcModel::createBuffers(std::vector<Vertex> vertices, std::vector<uint32_t> indices, bool optimize) {
+		if (optimize) {
+			optimizeStats = MeshOptimizer::optimize(vertices, indices);
+		}
+		else {
+			optimizeStats.verticesBefore = optimizeStats.verticesAfter = vertices.size();
+			optimizeStats.triangles = indices.size() / 3;
+			optimizeStats.cacheMissesBefore = optimizeStats.cacheMissesAfter = MeshOptimizer::countCacheMisses(indices, vertices.size());
+		}
+		createVertexBuffers(vertices);
+		createIndexBuffers(indices);
 	}
 	void VmcModel::createVertexBuffers(const std::vector<Vertex>& vertices) {
 		vertexCount = static_cast<uint32_t>(vertices.size());
 		assert(vertexCount >= 3 && "Vertex count must be at least 3");
+		bounds.min = bounds.max = vertices[0].position;
+		for (const Vertex& vertex : vertices) {
+			bounds.min = glm::min(bounds.min, vertex.position);
+			bounds.max = glm::max(bounds.max, vertex.position);
+		}
 		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
 		vmcDevice.createDeviceBuffer(bufferSize, (void*)vertices.data(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &vertexBuffer, &vertexMemory);
+	}
+	void VmcModel::createIndexBuffers(const std::vector<uint32_t>& indices) {
+		indexCount = static_cast<uint32_t>(indices.size());
+		assert(indexCount >= 3 && "Index count must be at least 3");
+
+		if (vertexCount <= UINT16_MAX + 1u) {
+			indexType = VK_INDEX_TYPE_UINT16;
+			std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+			VkDeviceSize bufferSize = sizeof(shortIndices[0]) * indexCount;
+			vmcDevice.createDeviceBuffer(bufferSize, (void*)shortIndices.data(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &indexBuffer, &indexMemory);
+			return;
+		}
 
-		// Host = CPU, Device = GPU
-		void* data;
-		vmaMapMemory(vmcDevice.vmaAllocator, vertexMemory, &data);
-		memcpy(data, vertices.data(), static_cast<size_t>(bufferSize));
-		vmaUnmapMemory(vmcDevice.vmaAllocator, vertexMemory);
+		indexType = VK_INDEX_TYPE_UINT32;
+		VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
+		vmcDevice.createDeviceBuffer(bufferSize, (void*)indices.data(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &indexBuffer, &indexMemory);
 	}
 	void VmcModel::draw(VkCommandBuffer commandBuffer) {
-		vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+		vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+	}
+	void VmcModel::drawInstanced(VkCommandBuffer commandBuffer, uint32_t instanceCount) {
+		vkCmdDrawIndexed(commandBuffer, indexCount, instanceCount, 0, 0, 0);
 	}
 	void VmcModel::bind(VkCommandBuffer commandBuffer) {
 		VkBuffer buffers[] = { vertexBuffer };
 		VkDeviceSize offsets[] = { 0 };
 		vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, indexType);
 	}
 	std::vector<VkVertexInputBindingDescription> VmcModel::Vertex::getBindingDescriptions() {
 		std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
@@ -42,7 +78,7 @@ namespace vmc {
 		return bindingDescriptions;
 	}
 	std::vector<VkVertexInputAttributeDescription> VmcModel::Vertex::getAttributeDescriptions() {
-		std::vector<VkVertexInputAttributeDescription> attributeDescriptions(2);
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions(4);
 		// binding is which buffer you use, location is the location of the specific data in the buffer ( layout(location=0) )
 		attributeDescriptions[0].binding = 0;
 		attributeDescriptions[0].location = 0;
@@ -55,6 +91,38 @@ namespace vmc {
 		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
 		attributeDescriptions[1].offset = offsetof(Vertex, color);
 
+		// ambient occlusion
+		attributeDescriptions[2].binding = 0;
+		attributeDescriptions[2].location = 2;
+		attributeDescriptions[2].format = VK_FORMAT_R32_UINT;
+		attributeDescriptions[2].offset = offsetof(Vertex, ambientOcclusion);
+
+		// texture layer
+		attributeDescriptions[3].binding = 0;
+		attributeDescriptions[3].location = 3;
+		attributeDescriptions[3].format = VK_FORMAT_R32_UINT;
+		attributeDescriptions[3].offset = offsetof(Vertex, textureLayer);
+
+		return attributeDescriptions;
+	}
+
+	VkVertexInputBindingDescription VmcModel::Instance::getBindingDescription() {
+		VkVertexInputBindingDescription bindingDescription{};
+		bindingDescription.binding = 1;
+		bindingDescription.stride = sizeof(Instance);
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+		return bindingDescription;
+	}
+	std::vector<VkVertexInputAttributeDescription> VmcModel::Instance::getAttributeDescriptions() {
+		// right after the vertex attributes
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions(3);
+		const uint32_t offsets[3] = { offsetof(Instance, quaternion), offsetof(Instance, translate), offsetof(Instance, color) };
+		for (uint32_t i = 0; i < 3; i++) {
+			attributeDescriptions[i].binding = 1;
+			attributeDescriptions[i].location = 4 + i;
+			attributeDescriptions[i].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+			attributeDescriptions[i].offset = offsets[i];
+		}
 		return attributeDescriptions;
 	}
-}
\ No newline at end of file
+}
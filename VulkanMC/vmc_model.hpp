@@ -1,6 +1,8 @@
 #pragma once
 
 #include "vmc_device.hpp"
+#include "mesh_optimizer.hpp"
+#include "vmc_frustum.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -14,12 +16,30 @@ namespace vmc {
 		struct Vertex {
 			glm::vec3 position;
 			glm::vec3 color;
+			// baked by the chunk mesher, from 0 for a corner boxed in by blocks up to 3 for an open one
+			uint32_t ambientOcclusion = 3;
+			// layer of the block texture array, 0 is plain white and leaves the color as it is
+			uint32_t textureLayer = 0;
 
 			static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
 			static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
 		};
 
+		// per entity data for instanced draws, read from a second vertex buffer at binding 1
+		struct Instance {
+			glm::vec4 quaternion{ .0f, .0f, .0f, 1.f };
+			// w is the scale
+			glm::vec4 translate{ .0f };
+			glm::vec4 color{ 1.f };
+
+			static VkVertexInputBindingDescription getBindingDescription();
+			static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+		};
+
+		// identical vertices are merged and the triangles reordered for the vertex cache before upload. pass
+		// optimize = false for geometry that already went through optimize(), e.g. on a worker thread
 		VmcModel(VmcDevice& device, const std::vector<Vertex>& vertices);
+		VmcModel(VmcDevice& device, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, bool optimize = true);
 		VmcModel() = default;
 		~VmcModel();
 
@@ -28,15 +48,35 @@ namespace vmc {
 
 		void bind(VkCommandBuffer commandBuffer);
 		void draw(VkCommandBuffer commandBuffer);
+		// with the instances already bound at binding 1
+		void drawInstanced(VkCommandBuffer commandBuffer, uint32_t instanceCount);
+
+		uint32_t getVertexCount() const { return vertexCount; }
+		uint32_t getIndexCount() const { return indexCount; }
+		VkIndexType getIndexType() const { return indexType; }
+		// in the space the vertices are in
+		const Aabb& getBounds() const { return bounds; }
+		const MeshOptimizeStats& getOptimizeStats() const { return optimizeStats; }
 
+		static MeshOptimizeStats optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) { return MeshOptimizer::optimize(vertices, indices); }
 
 	private:
+		void createBuffers(std::vector<Vertex> vertices, std::vector<uint32_t> indices, bool optimize);
 		void createVertexBuffers(const std::vector<Vertex>& vertices);
+		void createIndexBuffers(const std::vector<uint32_t>& indices);
 
 		VmcDevice& vmcDevice;
 		VkBuffer vertexBuffer;
 		VkDeviceMemory vertexBufferMemory;
 		uint32_t vertexCount;
 		VmaAllocation vertexMemory;
+		Aabb bounds{};
+
+		VkBuffer indexBuffer;
+		VmaAllocation indexMemory;
+		uint32_t indexCount = 0;
+		// 16 bit whenever every vertex can be addressed with it, which halves the index buffer
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+		MeshOptimizeStats optimizeStats;
 	};
 }
\ No newline at end of file
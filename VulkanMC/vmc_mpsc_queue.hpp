@@ -0,0 +1,63 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace vmc {
+	// unbounded lock free multi producer single consumer queue (dmitry vyukov's node based design).
+	// push is a single atomic exchange so workers never block each other or the consumer, pop must only ever
+	// be called from one thread. T has to be default constructible since the queue always keeps one empty node
+	template<typename T>
+	class VmcMpscQueue {
+	public:
+		VmcMpscQueue() : head{ &stub }, tail{ &stub } {}
+		~VmcMpscQueue() {
+			T value;
+			while (pop(value)) {}
+			if (tail != &stub) delete tail;
+		}
+
+		VmcMpscQueue(const VmcMpscQueue&) = delete;
+		VmcMpscQueue& operator=(const VmcMpscQueue&) = delete;
+
+		void push(T value) {
+			Node* node = new Node{};
+			node->value = std::move(value);
+			count.fetch_add(1, std::memory_order_relaxed);
+			Node* prev = head.exchange(node, std::memory_order_acq_rel);
+			// between the exchange and this store the consumer sees the queue as ending at prev, which is fine
+			prev->next.store(node, std::memory_order_release);
+		}
+
+		// returns false when the queue is empty, or when a producer is halfway through a push
+		bool pop(T& out) {
+			Node* first = tail;
+			Node* next = first->next.load(std::memory_order_acquire);
+			if (next == nullptr) return false;
+
+			// next becomes the new empty node once its value has been moved out
+			out = std::move(next->value);
+			tail = next;
+			if (first != &stub) delete first;
+			count.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		// approximate, only meant for stats
+		size_t size() const { return count.load(std::memory_order_relaxed); }
+
+	private:
+		struct Node {
+			std::atomic<Node*> next{ nullptr };
+			T value{};
+		};
+
+		// producers and the consumer touch different ends, keep them off the same cache line
+		alignas(64) std::atomic<Node*> head;
+		alignas(64) Node* tail;
+		std::atomic<size_t> count{ 0 };
+		Node stub;
+	};
+}
@@ -0,0 +1,126 @@
+#include "vmc_noise.hpp"
+#include "vmc_noise_kernels.hpp"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VMC_NOISE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+namespace vmc {
+	namespace {
+#ifdef VMC_NOISE_SSE2
+		struct Sse2Ops {
+			static constexpr int WIDTH = 4;
+			using F = __m128;
+			using I = __m128i;
+
+			static F load(const float* p) { return _mm_loadu_ps(p); }
+			static void store(float* p, F v) { _mm_storeu_ps(p, v); }
+			static F set(float v) { return _mm_set1_ps(v); }
+			static I seti(int32_t v) { return _mm_set1_epi32(v); }
+
+			static F add(F a, F b) { return _mm_add_ps(a, b); }
+			static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+			static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+
+			static I addi(I a, I b) { return _mm_add_epi32(a, b); }
+			// sse2 has no 32 bit mullo, multiply the even and odd lanes as 64 bit and stitch the low halves back together
+			static I muli(I a, I b) {
+				const __m128i even = _mm_mul_epu32(a, b);
+				const __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+				return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+			}
+			static I xori(I a, I b) { return _mm_xor_si128(a, b); }
+			static I shiftRight(I a, int bits) { return _mm_srl_epi32(a, _mm_cvtsi32_si128(bits)); }
+			static F toFloat(I a) { return _mm_cvtepi32_ps(a); }
+
+			// no floor instruction before sse4.1: truncate, then step down by one wherever truncation rounded up
+			static I floorToInt(F v, F& floored) {
+				I truncated = _mm_cvttps_epi32(v);
+				const F roundedUp = _mm_cmplt_ps(v, _mm_cvtepi32_ps(truncated));
+				truncated = _mm_add_epi32(truncated, _mm_castps_si128(roundedUp));
+				floored = _mm_cvtepi32_ps(truncated);
+				return truncated;
+			}
+		};
+#endif
+
+		bool cpuSupportsAvx2() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7) return false;
+			__cpuid(info, 1);
+			// the os has to save the ymm registers on context switches as well
+			const bool osxsave = (info[2] & (1 << 27)) != 0;
+			const bool avx = (info[2] & (1 << 28)) != 0;
+			if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) return false;
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+			return __builtin_cpu_supports("avx2");
+#else
+			return false;
+#endif
+		}
+	}
+
+	const char* toString(SimdLevel level) {
+		switch (level) {
+		case SimdLevel::Avx2: return "avx2";
+		case SimdLevel::Sse2: return "sse2";
+		default: return "scalar";
+		}
+	}
+
+	VmcNoise::VmcNoise(uint32_t seed, SimdLevel level) : seed{ seed }, simdLevel{ SimdLevel::Scalar } {
+		setSimdLevel(level);
+	}
+
+	SimdLevel VmcNoise::bestSimdLevel() {
+		static const SimdLevel best = [] {
+			if (noiseAvx2Compiled() && cpuSupportsAvx2()) return SimdLevel::Avx2;
+#ifdef VMC_NOISE_SSE2
+			return SimdLevel::Sse2;
+#else
+			return SimdLevel::Scalar;
+#endif
+		}();
+		return best;
+	}
+
+	void VmcNoise::setSimdLevel(SimdLevel level) {
+		const SimdLevel best = bestSimdLevel();
+		simdLevel = static_cast<int>(level) > static_cast<int>(best) ? best : level;
+	}
+
+	void VmcNoise::fractal2D(const float* x, const float* z, float* out, size_t count, const FractalSettings& settings) const {
+		if (simdLevel == SimdLevel::Avx2) {
+			noiseFractal2DAvx2(seed, x, z, out, count, settings);
+			return;
+		}
+
+		size_t done = 0;
+#ifdef VMC_NOISE_SSE2
+		if (simdLevel == SimdLevel::Sse2) done = fractal2DBatches<Sse2Ops>(seed, x, z, out, 0, count, settings);
+#endif
+		fractal2DBatches<ScalarOps>(seed, x, z, out, done, count, settings);
+	}
+
+	void VmcNoise::fractal3D(const float* x, const float* y, const float* z, float* out, size_t count, const FractalSettings& settings) const {
+		if (simdLevel == SimdLevel::Avx2) {
+			noiseFractal3DAvx2(seed, x, y, z, out, count, settings);
+			return;
+		}
+
+		size_t done = 0;
+#ifdef VMC_NOISE_SSE2
+		if (simdLevel == SimdLevel::Sse2) done = fractal3DBatches<Sse2Ops>(seed, x, y, z, out, 0, count, settings);
+#endif
+		fractal3DBatches<ScalarOps>(seed, x, y, z, out, done, count, settings);
+	}
+}
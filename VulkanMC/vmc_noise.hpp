@@ -0,0 +1,46 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+
+namespace vmc {
+	enum class SimdLevel {
+		Scalar,
+		Sse2,
+		Avx2
+	};
+
+	const char* toString(SimdLevel level);
+
+	struct FractalSettings {
+		int octaves = 4;
+		float frequency = 1.f / 64.f;
+		float lacunarity = 2.f;
+		float gain = .5f;
+	};
+
+	// seeded fractal value noise, evaluated over arrays of points so the kernels can run 4 (sse2) or 8 (avx2) points
+	// at a time. every path does the exact same float operations in the same order, so the output only depends on
+	// the seed and the input points, never on the simd level or which thread it ran on
+	class VmcNoise {
+	public:
+		explicit VmcNoise(uint32_t seed, SimdLevel level = bestSimdLevel());
+
+		// the widest path both this build and the cpu we are running on support
+		static SimdLevel bestSimdLevel();
+
+		uint32_t getSeed() const { return seed; }
+		SimdLevel getSimdLevel() const { return simdLevel; }
+		// falls back to the best supported level if the requested one isn't available
+		void setSimdLevel(SimdLevel level);
+
+		// results are roughly in [-1, 1]
+		void fractal2D(const float* x, const float* z, float* out, size_t count, const FractalSettings& settings) const;
+		void fractal3D(const float* x, const float* y, const float* z, float* out, size_t count, const FractalSettings& settings) const;
+
+	private:
+		uint32_t seed;
+		SimdLevel simdLevel;
+	};
+}
@@ -0,0 +1,60 @@
+// this file is built with avx2 enabled (/arch:AVX2 in the project, -mavx2 elsewhere). nothing in here may be called
+// unless VmcNoise::bestSimdLevel() found avx2 support at runtime
+#include "vmc_noise_kernels.hpp"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace vmc {
+#ifdef __AVX2__
+	namespace {
+		struct Avx2Ops {
+			static constexpr int WIDTH = 8;
+			using F = __m256;
+			using I = __m256i;
+
+			static F load(const float* p) { return _mm256_loadu_ps(p); }
+			static void store(float* p, F v) { _mm256_storeu_ps(p, v); }
+			static F set(float v) { return _mm256_set1_ps(v); }
+			static I seti(int32_t v) { return _mm256_set1_epi32(v); }
+
+			// plain mul and add, never fma, so the results match the other paths bit for bit
+			static F add(F a, F b) { return _mm256_add_ps(a, b); }
+			static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+			static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+
+			static I addi(I a, I b) { return _mm256_add_epi32(a, b); }
+			static I muli(I a, I b) { return _mm256_mullo_epi32(a, b); }
+			static I xori(I a, I b) { return _mm256_xor_si256(a, b); }
+			static I shiftRight(I a, int bits) { return _mm256_srl_epi32(a, _mm_cvtsi32_si128(bits)); }
+			static F toFloat(I a) { return _mm256_cvtepi32_ps(a); }
+
+			static I floorToInt(F v, F& floored) {
+				floored = _mm256_floor_ps(v);
+				return _mm256_cvttps_epi32(floored);
+			}
+		};
+	}
+
+	bool noiseAvx2Compiled() { return true; }
+
+	void noiseFractal2DAvx2(uint32_t seed, const float* x, const float* z, float* out, size_t count, const FractalSettings& settings) {
+		const size_t done = fractal2DBatches<Avx2Ops>(seed, x, z, out, 0, count, settings);
+		fractal2DBatches<ScalarOps>(seed, x, z, out, done, count, settings);
+		// avoid the avx to sse transition penalty in whatever runs next
+		_mm256_zeroupper();
+	}
+
+	void noiseFractal3DAvx2(uint32_t seed, const float* x, const float* y, const float* z, float* out, size_t count, const FractalSettings& settings) {
+		const size_t done = fractal3DBatches<Avx2Ops>(seed, x, y, z, out, 0, count, settings);
+		fractal3DBatches<ScalarOps>(seed, x, y, z, out, done, count, settings);
+		_mm256_zeroupper();
+	}
+#else
+	bool noiseAvx2Compiled() { return false; }
+
+	void noiseFractal2DAvx2(uint32_t, const float*, const float*, float*, size_t, const FractalSettings&) {}
+	void noiseFractal3DAvx2(uint32_t, const float*, const float*, const float*, float*, size_t, const FractalSettings&) {}
+#endif
+}
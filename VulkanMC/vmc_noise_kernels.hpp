@@ -0,0 +1,200 @@
+#pragma once
+
+#include "vmc_noise.hpp"
+
+// std
+#include <cmath>
+#include <cstring>
+
+// shared between vmc_noise.cpp and vmc_noise_avx2.cpp, which are compiled with different instruction sets.
+// everything in here lives in an anonymous namespace on purpose: if these were ordinary inline functions the
+// linker could keep the avx2 compiled copy and hand it to the sse2 path on a cpu without avx2
+namespace vmc {
+	namespace {
+		constexpr int32_t PRIME_X = 501125321;
+		constexpr int32_t PRIME_Y = 1136930381;
+		constexpr int32_t PRIME_Z = 1720413743;
+		constexpr int32_t HASH_MULTIPLIER = 0x27d4eb2d;
+		// maps a signed 32 bit hash onto [-1, 1)
+		constexpr float HASH_TO_FLOAT = 1.f / 2147483648.f;
+
+		struct ScalarOps {
+			static constexpr int WIDTH = 1;
+			using F = float;
+			using I = int32_t;
+
+			static F load(const float* p) { return *p; }
+			static void store(float* p, F v) { *p = v; }
+			static F set(float v) { return v; }
+			static I seti(int32_t v) { return v; }
+
+			static F add(F a, F b) { return a + b; }
+			static F sub(F a, F b) { return a - b; }
+			static F mul(F a, F b) { return a * b; }
+
+			// unsigned arithmetic so overflow wraps instead of being undefined
+			static I addi(I a, I b) { return static_cast<I>(static_cast<uint32_t>(a) + static_cast<uint32_t>(b)); }
+			static I muli(I a, I b) { return static_cast<I>(static_cast<uint32_t>(a) * static_cast<uint32_t>(b)); }
+			static I xori(I a, I b) { return a ^ b; }
+			static I shiftRight(I a, int bits) { return static_cast<I>(static_cast<uint32_t>(a) >> bits); }
+			static F toFloat(I a) { return static_cast<float>(a); }
+
+			// returns floor(v) as an int and writes it back as a float
+			static I floorToInt(F v, F& floored) {
+				floored = std::floor(v);
+				return static_cast<I>(floored);
+			}
+		};
+
+		template<typename S>
+		typename S::F hashToFloat(typename S::I h) {
+			h = S::muli(h, S::seti(HASH_MULTIPLIER));
+			h = S::xori(h, S::shiftRight(h, 15));
+			h = S::muli(h, S::seti(HASH_MULTIPLIER));
+			h = S::xori(h, S::shiftRight(h, 13));
+			return S::mul(S::toFloat(h), S::set(HASH_TO_FLOAT));
+		}
+
+		template<typename S>
+		typename S::F lerp(typename S::F a, typename S::F b, typename S::F t) {
+			return S::add(a, S::mul(S::sub(b, a), t));
+		}
+
+		// 3t^2 - 2t^3, written the same way on every path
+		template<typename S>
+		typename S::F smooth(typename S::F t) {
+			return S::mul(S::mul(t, t), S::sub(S::set(3.f), S::add(t, t)));
+		}
+
+		template<typename S>
+		typename S::F valueNoise2D(typename S::I seed, typename S::F x, typename S::F z) {
+			using F = typename S::F;
+			using I = typename S::I;
+
+			F fx, fz;
+			const I ix = S::floorToInt(x, fx);
+			const I iz = S::floorToInt(z, fz);
+			const F tx = smooth<S>(S::sub(x, fx));
+			const F tz = smooth<S>(S::sub(z, fz));
+
+			// (i + 1) * prime is just i * prime + prime, so each axis needs a single multiply
+			const I x0 = S::muli(ix, S::seti(PRIME_X));
+			const I x1 = S::addi(x0, S::seti(PRIME_X));
+			const I z0 = S::xori(seed, S::muli(iz, S::seti(PRIME_Z)));
+			const I z1 = S::xori(seed, S::addi(S::muli(iz, S::seti(PRIME_Z)), S::seti(PRIME_Z)));
+
+			const F v00 = hashToFloat<S>(S::xori(x0, z0));
+			const F v10 = hashToFloat<S>(S::xori(x1, z0));
+			const F v01 = hashToFloat<S>(S::xori(x0, z1));
+			const F v11 = hashToFloat<S>(S::xori(x1, z1));
+			return lerp<S>(lerp<S>(v00, v10, tx), lerp<S>(v01, v11, tx), tz);
+		}
+
+		template<typename S>
+		typename S::F valueNoise3D(typename S::I seed, typename S::F x, typename S::F y, typename S::F z) {
+			using F = typename S::F;
+			using I = typename S::I;
+
+			F fx, fy, fz;
+			const I ix = S::floorToInt(x, fx);
+			const I iy = S::floorToInt(y, fy);
+			const I iz = S::floorToInt(z, fz);
+			const F tx = smooth<S>(S::sub(x, fx));
+			const F ty = smooth<S>(S::sub(y, fy));
+			const F tz = smooth<S>(S::sub(z, fz));
+
+			const I x0 = S::muli(ix, S::seti(PRIME_X));
+			const I x1 = S::addi(x0, S::seti(PRIME_X));
+			const I y0 = S::muli(iy, S::seti(PRIME_Y));
+			const I y1 = S::addi(y0, S::seti(PRIME_Y));
+			const I z0 = S::xori(seed, S::muli(iz, S::seti(PRIME_Z)));
+			const I z1 = S::xori(seed, S::addi(S::muli(iz, S::seti(PRIME_Z)), S::seti(PRIME_Z)));
+
+			const I y0z0 = S::xori(y0, z0);
+			const I y1z0 = S::xori(y1, z0);
+			const I y0z1 = S::xori(y0, z1);
+			const I y1z1 = S::xori(y1, z1);
+
+			const F v000 = hashToFloat<S>(S::xori(x0, y0z0));
+			const F v100 = hashToFloat<S>(S::xori(x1, y0z0));
+			const F v010 = hashToFloat<S>(S::xori(x0, y1z0));
+			const F v110 = hashToFloat<S>(S::xori(x1, y1z0));
+			const F v001 = hashToFloat<S>(S::xori(x0, y0z1));
+			const F v101 = hashToFloat<S>(S::xori(x1, y0z1));
+			const F v011 = hashToFloat<S>(S::xori(x0, y1z1));
+			const F v111 = hashToFloat<S>(S::xori(x1, y1z1));
+
+			const F front = lerp<S>(lerp<S>(v000, v100, tx), lerp<S>(v010, v110, tx), ty);
+			const F back = lerp<S>(lerp<S>(v001, v101, tx), lerp<S>(v011, v111, tx), ty);
+			return lerp<S>(front, back, tz);
+		}
+
+		// 1 / sum of the octave amplitudes, computed once in plain floats so every path scales by the same value
+		inline float fractalNormalization(const FractalSettings& settings) {
+			float amplitude = 1.f;
+			float total = .0f;
+			for (int octave = 0; octave < settings.octaves; octave++) {
+				total += amplitude;
+				amplitude *= settings.gain;
+			}
+			return total > .0f ? 1.f / total : .0f;
+		}
+
+		// processes every full batch of S::WIDTH points starting at first and returns the index of the first point it skipped
+		template<typename S>
+		size_t fractal2DBatches(uint32_t seed, const float* x, const float* z, float* out, size_t first, size_t count, const FractalSettings& settings) {
+			using F = typename S::F;
+			const float normalization = fractalNormalization(settings);
+
+			size_t i = first;
+			for (; i + S::WIDTH <= count; i += S::WIDTH) {
+				const F px = S::load(x + i);
+				const F pz = S::load(z + i);
+				F sum = S::set(.0f);
+				float frequency = settings.frequency;
+				float amplitude = 1.f;
+				for (int octave = 0; octave < settings.octaves; octave++) {
+					const F f = S::set(frequency);
+					const typename S::I octaveSeed = S::seti(static_cast<int32_t>(seed + static_cast<uint32_t>(octave)));
+					const F n = valueNoise2D<S>(octaveSeed, S::mul(px, f), S::mul(pz, f));
+					sum = S::add(sum, S::mul(n, S::set(amplitude)));
+					frequency *= settings.lacunarity;
+					amplitude *= settings.gain;
+				}
+				S::store(out + i, S::mul(sum, S::set(normalization)));
+			}
+			return i;
+		}
+
+		template<typename S>
+		size_t fractal3DBatches(uint32_t seed, const float* x, const float* y, const float* z, float* out, size_t first, size_t count, const FractalSettings& settings) {
+			using F = typename S::F;
+			const float normalization = fractalNormalization(settings);
+
+			size_t i = first;
+			for (; i + S::WIDTH <= count; i += S::WIDTH) {
+				const F px = S::load(x + i);
+				const F py = S::load(y + i);
+				const F pz = S::load(z + i);
+				F sum = S::set(.0f);
+				float frequency = settings.frequency;
+				float amplitude = 1.f;
+				for (int octave = 0; octave < settings.octaves; octave++) {
+					const F f = S::set(frequency);
+					const typename S::I octaveSeed = S::seti(static_cast<int32_t>(seed + static_cast<uint32_t>(octave)));
+					const F n = valueNoise3D<S>(octaveSeed, S::mul(px, f), S::mul(py, f), S::mul(pz, f));
+					sum = S::add(sum, S::mul(n, S::set(amplitude)));
+					frequency *= settings.lacunarity;
+					amplitude *= settings.gain;
+				}
+				S::store(out + i, S::mul(sum, S::set(normalization)));
+			}
+			return i;
+		}
+	}
+
+	// implemented in vmc_noise_avx2.cpp, which is the only file built with avx2 enabled
+	bool noiseAvx2Compiled();
+	void noiseFractal2DAvx2(uint32_t seed, const float* x, const float* z, float* out, size_t count, const FractalSettings& settings);
+	void noiseFractal3DAvx2(uint32_t seed, const float* x, const float* y, const float* z, float* out, size_t count, const FractalSettings& settings);
+}
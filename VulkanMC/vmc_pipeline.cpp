@@ -1,16 +1,64 @@
 #include "vmc_pipeline.hpp"
 #include "vmc_model.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <cassert>
 namespace vmc {
+	double VmcPipelineBatch::build(VmcJobSystem& jobSystem) {
+		const auto start = std::chrono::steady_clock::now();
+		// jobs that only get to run after everything is done still hold on to this, so it is shared
+		struct Progress {
+			std::vector<Create> creates;
+			std::atomic<size_t> next{ 0 };
+			std::atomic<size_t> done{ 0 };
+			std::mutex errorMutex;
+			std::exception_ptr error;
+		};
+		auto progress = std::make_shared<Progress>();
+		progress->creates = std::move(pending);
+		pending.clear();
+		const size_t count = progress->creates.size();
+
+		auto work = [progress, count] {
+			for (size_t i = progress->next.fetch_add(1); i < count; i = progress->next.fetch_add(1)) {
+				try {
+					progress->creates[i]();
+				}
+				catch (...) {
+					std::lock_guard<std::mutex> lock{ progress->errorMutex };
+					if (!progress->error) progress->error = std::current_exception();
+				}
+				progress->done.fetch_add(1);
+			}
+		};
+		const size_t helpers = std::min<size_t>(jobSystem.getWorkerCount(), count > 0 ? count - 1 : 0);
+		for (size_t i = 0; i < helpers; i++) jobSystem.submit(work);
+		work();
+		while (progress->done.load() < count) std::this_thread::yield();
+
+		if (progress->error) std::rethrow_exception(progress->error);
+		built += count;
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
 	VmcPipeline::VmcPipeline(VmcDevice& device, const std::string& vertFilePath, const std::string& fragFilePath, const PipelineConfigInfo& configInfo) : vmcDevice{ device } {
 		createGraphicsPipeline(vertFilePath, fragFilePath, configInfo);
 	}
+	VmcPipeline::VmcPipeline(VmcDevice& device, const std::string& compFilePath, VkPipelineLayout pipelineLayout) : vmcDevice{ device } {
+		createComputePipeline(compFilePath, pipelineLayout);
+	}
 	VmcPipeline::~VmcPipeline() {
 		vkDestroyShaderModule(vmcDevice.device(), vertShaderModule, nullptr);
 		vkDestroyShaderModule(vmcDevice.device(), fragShaderModule, nullptr);
+		vkDestroyShaderModule(vmcDevice.device(), compShaderModule, nullptr);
 		vkDestroyPipeline(vmcDevice.device(), graphicsPipeline, nullptr);
 	}
 
@@ -64,8 +112,8 @@ namespace vmc {
 		shaderStages[1].pNext = nullptr;
 		shaderStages[1].pSpecializationInfo = nullptr;
 
-		auto bindingDescriptions = VmcModel::Vertex::getBindingDescriptions();
-		auto attributeDescriptions = VmcModel::Vertex::getAttributeDescriptions();
+		const auto& bindingDescriptions = configInfo.bindingDescriptions;
+		const auto& attributeDescriptions = configInfo.attributeDescriptions;
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
@@ -93,7 +141,7 @@ namespace vmc {
 
 		if (vkCreateGraphicsPipelines(
 			vmcDevice.device(),
-			VK_NULL_HANDLE,
+			vmcDevice.getPipelineCache(),
 			1,
 			&pipelineInfo,
 			nullptr,
@@ -101,6 +149,28 @@ namespace vmc {
 			throw std::runtime_error("failed to create graphics pipeline");
 		}
 	}
+
+	void VmcPipeline::createComputePipeline(const std::string& compFilePath, VkPipelineLayout pipelineLayout) {
+		assert(pipelineLayout != VK_NULL_HANDLE && "Cannot create compute pipeline: no pipelineLayout provided");
+
+		auto compCode = readFile(compFilePath);
+		createShaderModule(compCode, &compShaderModule);
+		bindPoint = VK_PIPELINE_BIND_POINT_COMPUTE;
+
+		VkComputePipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.module = compShaderModule;
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = pipelineLayout;
+		pipelineInfo.basePipelineIndex = -1;
+		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+		if (vkCreateComputePipelines(vmcDevice.device(), vmcDevice.getPipelineCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create compute pipeline");
+		}
+	}
 	//
 	void VmcPipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule) {
 		VkShaderModuleCreateInfo createInfo{};
@@ -115,12 +185,15 @@ namespace vmc {
 	}
 
 	void VmcPipeline::bind(VkCommandBuffer commandBuffer) {
-		// this is a graphics pipeline, not a raytracing or compute pipeline
-		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+		// graphics unless this was built from a compute shader
+		vkCmdBindPipeline(commandBuffer, bindPoint, graphicsPipeline);
 	}
 
 
 	void VmcPipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo) {
+		configInfo.bindingDescriptions = VmcModel::Vertex::getBindingDescriptions();
+		configInfo.attributeDescriptions = VmcModel::Vertex::getAttributeDescriptions();
+
 		configInfo.inputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
 		configInfo.inputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST; // vertex data is grouped into 6 for each triangle
 		configInfo.inputAssemblyInfo.primitiveRestartEnable = VK_FALSE;
@@ -151,7 +224,9 @@ namespace vmc {
 		configInfo.multisampleInfo.alphaToCoverageEnable = VK_FALSE;  // Optional
 		configInfo.multisampleInfo.alphaToOneEnable = VK_FALSE;       // Optional
 
-		static VkPipelineColorBlendAttachmentState blend{};
+		// lives in the config, pipelines are built on several threads at once
+		VkPipelineColorBlendAttachmentState& blend = configInfo.colorBlendAttachment;
+		blend = {};
 		blend.colorWriteMask =
 			VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
 			VK_COLOR_COMPONENT_A_BIT;
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "vmc_device.hpp"
+#include "vmc_job_system.hpp"
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -12,6 +14,9 @@ namespace vmc {
 		PipelineConfigInfo(const PipelineConfigInfo&) = delete;
 		PipelineConfigInfo& operator=(const PipelineConfigInfo&) = delete;
 
+		// VmcModel::Vertex unless changed after defaultPipelineConfigInfo
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions;
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
 		VkPipelineViewportStateCreateInfo viewportInfo;
 		VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
 		VkPipelineRasterizationStateCreateInfo rasterizationInfo;
@@ -30,6 +35,8 @@ namespace vmc {
 	class VmcPipeline {
 	public:
 		VmcPipeline(VmcDevice& device, const std::string& vertFilePath, const std::string& fragFilePath, const PipelineConfigInfo& configInfo);
+		// a compute pipeline
+		VmcPipeline(VmcDevice& device, const std::string& compFilePath, VkPipelineLayout pipelineLayout);
 		~VmcPipeline();
 
 		// delete copy constructors
@@ -42,13 +49,36 @@ namespace vmc {
 		static std::vector<char> readFile(const std::string& filepath);
 
 		void createGraphicsPipeline(const std::string& vertFilePath, const std::string& fragFilePath, const PipelineConfigInfo& configInfo);
+		void createComputePipeline(const std::string& compFilePath, VkPipelineLayout pipelineLayout);
 		void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
 
 		// the instance of a device will by definition outlive an instance of a pipeline. A pipeline needs a device to exist.
 		// There is no danger with dereferencing a dangling pointer and crashing the program
 		VmcDevice& vmcDevice;
 		VkPipeline graphicsPipeline;
-		VkShaderModule vertShaderModule;
-		VkShaderModule fragShaderModule;
+		VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		VkShaderModule vertShaderModule = VK_NULL_HANDLE;
+		VkShaderModule fragShaderModule = VK_NULL_HANDLE;
+		VkShaderModule compShaderModule = VK_NULL_HANDLE;
+	};
+
+	// pipelines that are created together on the job system, so the driver compiles their shaders in parallel.
+	// systems add theirs when they are constructed and can't draw until build has returned
+	class VmcPipelineBatch {
+	public:
+		using Create = std::function<void()>;
+
+		// create usually makes a VmcPipeline and stores it in the system that added it
+		void add(Create create) { pending.push_back(std::move(create)); }
+		// runs everything added since the last build, the calling thread helps and the first error is rethrown once
+		// all of them are done. returns how long it took in milliseconds
+		double build(VmcJobSystem& jobSystem);
+
+		size_t getPendingCount() const { return pending.size(); }
+		size_t getBuiltCount() const { return built; }
+
+	private:
+		std::vector<Create> pending;
+		size_t built = 0;
 	};
 }
\ No newline at end of file
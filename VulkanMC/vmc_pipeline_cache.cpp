@@ -0,0 +1,113 @@
+#include "vmc_pipeline_cache.hpp"
+
+// std
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace vmc {
+	static uint64_t hashBytes(const std::vector<char>& data) {
+		// fnv-1a
+		uint64_t hash = 14695981039346656037ull;
+		for (char c : data) hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+		return hash;
+	}
+
+	VmcPipelineCache::VmcPipelineCache(VmcDevice& device, const std::string& path, bool load) : vmcDevice{ device }, path{ path } {
+		std::vector<char> data;
+		if (load) data = readFile();
+
+		VkPipelineCacheCreateInfo cacheInfo{};
+		cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		cacheInfo.initialDataSize = data.size();
+		cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+		if (vkCreatePipelineCache(vmcDevice.device(), &cacheInfo, nullptr, &cache) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create pipeline cache");
+		}
+		loadedBytes = data.size();
+		vmcDevice.setPipelineCache(cache);
+	}
+
+	VmcPipelineCache::~VmcPipelineCache() {
+		save();
+		vmcDevice.setPipelineCache(VK_NULL_HANDLE);
+		vkDestroyPipelineCache(vmcDevice.device(), cache, nullptr);
+	}
+
+	bool VmcPipelineCache::save() {
+		size_t size = 0;
+		if (vkGetPipelineCacheData(vmcDevice.device(), cache, &size, nullptr) != VK_SUCCESS || size == 0) return false;
+		std::vector<char> data(size);
+		if (vkGetPipelineCacheData(vmcDevice.device(), cache, &size, data.data()) != VK_SUCCESS) return false;
+		data.resize(size);
+
+		// written next to it first, a crash halfway through leaves the old file as it was
+		const FileHeader header = makeHeader(data);
+		const std::string tempPath = path + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open()) return false;
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(data.data(), static_cast<std::streamsize>(data.size()));
+			if (!file) return false;
+		}
+		std::remove(path.c_str());
+		return std::rename(tempPath.c_str(), path.c_str()) == 0;
+	}
+
+	VmcPipelineCache::FileHeader VmcPipelineCache::makeHeader(const std::vector<char>& data) const {
+		FileHeader header{};
+		header.magic = FILE_MAGIC;
+		header.version = FILE_VERSION;
+		header.vendorID = vmcDevice.properties.vendorID;
+		header.deviceID = vmcDevice.properties.deviceID;
+		header.driverVersion = vmcDevice.properties.driverVersion;
+		std::memcpy(header.pipelineCacheUUID, vmcDevice.properties.pipelineCacheUUID, VK_UUID_SIZE);
+		header.dataSize = data.size();
+		header.dataHash = hashBytes(data);
+		return header;
+	}
+
+	std::vector<char> VmcPipelineCache::readFile() const {
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open()) return {};
+
+		FileHeader header{};
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+		const FileHeader expected = makeHeader({});
+		if (!file || header.magic != FILE_MAGIC || header.version != FILE_VERSION || header.vendorID != expected.vendorID ||
+			header.deviceID != expected.deviceID || header.driverVersion != expected.driverVersion ||
+			std::memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+			std::cout << "pipeline cache: " << path << " was written by another gpu or driver, starting over" << std::endl;
+			return {};
+		}
+
+		// the size comes from the file, so it is checked against what is really there before anything is allocated
+		const std::streamoff dataStart = file.tellg();
+		file.seekg(0, std::ios::end);
+		const uint64_t available = static_cast<uint64_t>(file.tellg() - dataStart);
+		file.seekg(dataStart);
+		std::vector<char> data;
+		if (header.dataSize <= available) {
+			data.resize(static_cast<size_t>(header.dataSize));
+			file.read(data.data(), static_cast<std::streamsize>(data.size()));
+		}
+		if (header.dataSize > available || !file || hashBytes(data) != header.dataHash) {
+			std::cout << "pipeline cache: " << path << " is damaged, starting over" << std::endl;
+			return {};
+		}
+
+		// the driver checks its own header too, but not every driver copes with data it didn't expect
+		VkPipelineCacheHeaderVersionOne driverHeader{};
+		if (data.size() < sizeof(driverHeader)) return {};
+		std::memcpy(&driverHeader, data.data(), sizeof(driverHeader));
+		if (driverHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+			std::memcmp(driverHeader.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+			return {};
+		}
+		return data;
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "vmc_device.hpp"
+
+// std
+#include <cstdint>
+#include <string>
+
+namespace vmc {
+	// a VkPipelineCache that is read from disk on startup and written back when destroyed, so drivers don't have to
+	// compile every shader again on the next run. while it exists every VmcPipeline is created through it.
+	// a file written by a different gpu or driver version is ignored and replaced
+	class VmcPipelineCache {
+	public:
+		// starts out empty instead of reading path when load is false, for measuring a cold start
+		VmcPipelineCache(VmcDevice& device, const std::string& path, bool load = true);
+		~VmcPipelineCache();
+
+		VmcPipelineCache(const VmcPipelineCache&) = delete;
+		VmcPipelineCache& operator=(const VmcPipelineCache&) = delete;
+
+		// false when the file couldn't be written
+		bool save();
+
+		VkPipelineCache getCache() const { return cache; }
+		// bytes of driver data the cache started out with, 0 on a cold start
+		size_t getLoadedBytes() const { return loadedBytes; }
+		bool wasLoaded() const { return loadedBytes > 0; }
+
+	private:
+		// in front of the driver's data, what it was written by and a hash to catch files that were cut short
+		struct FileHeader {
+			uint32_t magic;
+			uint32_t version;
+			uint32_t vendorID;
+			uint32_t deviceID;
+			uint32_t driverVersion;
+			uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+			uint64_t dataSize;
+			uint64_t dataHash;
+		};
+		static constexpr uint32_t FILE_MAGIC = 0x43504d56; // "VMPC"
+		static constexpr uint32_t FILE_VERSION = 1;
+
+		FileHeader makeHeader(const std::vector<char>& data) const;
+		// the driver data of the file when it was written for this device, empty otherwise
+		std::vector<char> readFile() const;
+
+		VmcDevice& vmcDevice;
+		std::string path;
+		VkPipelineCache cache = VK_NULL_HANDLE;
+		size_t loadedBytes = 0;
+	};
+}
@@ -0,0 +1,56 @@
+#include "vmc_pipeline_compiler.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+
+namespace vmc {
+	VmcPipelineCompiler::~VmcPipelineCompiler() {
+		// jobs write into the entries until they are done
+		jobSystem.waitIdle();
+	}
+
+	VmcPipelineCompiler::Handle VmcPipelineCompiler::request(Create create) {
+		entries.push_back(std::make_unique<Entry>());
+		Entry* entry = entries.back().get();
+		jobSystem.submit([entry, create = std::move(create)] {
+			const auto start = std::chrono::steady_clock::now();
+			try {
+				entry->pipeline = create();
+			}
+			catch (...) {
+				entry->error = std::current_exception();
+			}
+			entry->compileMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			entry->ready.store(true, std::memory_order_release);
+		});
+		stats.requested++;
+		return static_cast<Handle>(entries.size() - 1);
+	}
+
+	void VmcPipelineCompiler::wait(Handle handle) {
+		// waitIdle runs jobs on this thread too, so it finishes even without workers
+		if (!isReady(handle)) jobSystem.waitIdle();
+	}
+
+	VmcPipeline& VmcPipelineCompiler::get(Handle handle, VmcPipeline& fallback) {
+		Entry& entry = *entries[handle];
+		if (!entry.ready.load(std::memory_order_acquire)) {
+			fellBack = true;
+			return fallback;
+		}
+		if (entry.error) std::rethrow_exception(entry.error);
+		if (!entry.counted) {
+			entry.counted = true;
+			stats.compiled++;
+			stats.compileMs += entry.compileMs;
+			stats.maxCompileMs = std::max(stats.maxCompileMs, entry.compileMs);
+		}
+		return *entry.pipeline;
+	}
+
+	void VmcPipelineCompiler::endFrame() {
+		if (fellBack) stats.fallbackFrames++;
+		fellBack = false;
+	}
+}
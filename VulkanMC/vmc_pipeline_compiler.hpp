@@ -0,0 +1,69 @@
+#pragma once
+
+#include "vmc_job_system.hpp"
+#include "vmc_pipeline.hpp"
+
+// std
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+
+namespace vmc {
+	struct PipelineCompileStats {
+		uint64_t requested = 0;
+		uint64_t compiled = 0;
+		// frames that drew at least once with a fallback because the pipeline they wanted wasn't ready
+		uint64_t fallbackFrames = 0;
+		double compileMs = 0.0;
+		double maxCompileMs = 0.0;
+
+		double averageCompileMs() const { return compiled == 0 ? 0.0 : compileMs / compiled; }
+	};
+
+	// builds pipelines that are only needed once the game is running on the job system, so asking for one never
+	// hitches a frame. until a pipeline is ready draws go through a fallback with the same layout, which the caller
+	// already has. requests and lookups are made from the main thread
+	class VmcPipelineCompiler {
+	public:
+		using Handle = uint32_t;
+		using Create = std::function<std::unique_ptr<VmcPipeline>()>;
+
+		explicit VmcPipelineCompiler(VmcJobSystem& jobSystem) : jobSystem{ jobSystem } {}
+		~VmcPipelineCompiler();
+
+		VmcPipelineCompiler(const VmcPipelineCompiler&) = delete;
+		VmcPipelineCompiler& operator=(const VmcPipelineCompiler&) = delete;
+
+		// returns right away, create runs on a worker
+		Handle request(Create create);
+		bool isReady(Handle handle) const { return entries[handle]->ready.load(std::memory_order_acquire); }
+		// blocks until the request has run, for owners that are about to destroy what create reads
+		void wait(Handle handle);
+		// the requested pipeline once it is ready, fallback until then. rethrows if creating it failed
+		VmcPipeline& get(Handle handle, VmcPipeline& fallback);
+		// counts the frame if anything fell back during it
+		void endFrame();
+
+		// compile times are only added once get has seen the pipeline ready
+		const PipelineCompileStats& getStats() const { return stats; }
+		void resetStats() { stats = {}; }
+
+	private:
+		struct Entry {
+			std::unique_ptr<VmcPipeline> pipeline;
+			std::exception_ptr error;
+			double compileMs = 0.0;
+			std::atomic<bool> ready{ false };
+			bool counted = false;
+		};
+
+		VmcJobSystem& jobSystem;
+		// a deque so the entries workers write into never move
+		std::deque<std::unique_ptr<Entry>> entries;
+		bool fellBack = false;
+		PipelineCompileStats stats;
+	};
+}
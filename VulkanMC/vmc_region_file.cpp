@@ -0,0 +1,357 @@
+#include "vmc_region_file.hpp"
+#include "vmc_compression.hpp"
+
+// std
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace vmc {
+	static constexpr uint8_t FORMAT_VERSION = 1;
+	// the largest chunk encodeChunk can produce: its position, then every section at 16 bits per block with the
+	// biggest palette deserialize accepts. rawSize isn't covered by the crc so it's checked against this instead
+	static constexpr size_t MAX_RAW_SIZE = sizeof(int32_t) * 2 + Chunk::SECTION_COUNT *
+		(sizeof(uint8_t) + sizeof(uint16_t) * 2 + (size_t{ 1 } << 16) * sizeof(BlockId) + ChunkSection::VOLUME * sizeof(uint16_t));
+
+	static uint32_t sectorsFor(size_t bytes) {
+		return static_cast<uint32_t>((bytes + VmcRegionFile::SECTOR_SIZE - 1) / VmcRegionFile::SECTOR_SIZE);
+	}
+
+	VmcRegionFile::VmcRegionFile(const std::string& path) : path{ path } {
+		openFile(path);
+
+		uint64_t size = fileSize();
+		if (size < HEADER_SECTORS * SECTOR_SIZE) {
+			// new (or truncated beyond repair) region, start with an empty table
+			std::vector<uint8_t> header(HEADER_SECTORS * SECTOR_SIZE, 0);
+			writeAt(0, header.data(), header.size());
+			syncFile();
+			size = fileSize();
+		}
+		ensureMapped(size);
+
+		const uint32_t sectorCount = static_cast<uint32_t>(size / SECTOR_SIZE);
+		usedSectors.assign(sectorCount, false);
+		for (uint32_t i = 0; i < HEADER_SECTORS; i++) usedSectors[i] = true;
+
+		std::memcpy(table.data(), mappedData, sizeof(table));
+		for (uint32_t& entry : table) {
+			if (entry == 0) continue;
+			const uint32_t first = entry >> 8;
+			const uint32_t count = entry & 0xff;
+			// entries pointing outside the file are from a write that never finished growing it, treat them as missing
+			if (first < HEADER_SECTORS || count == 0 || first + count > sectorCount) {
+				std::cerr << path << ": dropping invalid table entry " << entry << std::endl;
+				entry = 0;
+				continue;
+			}
+			for (uint32_t s = first; s < first + count; s++) usedSectors[s] = true;
+		}
+	}
+
+	VmcRegionFile::~VmcRegionFile() {
+		unmapFile();
+		closeFile();
+	}
+
+	bool VmcRegionFile::hasChunk(ChunkPos pos) const {
+		std::shared_lock<std::shared_mutex> lock{ mutex };
+		return table[tableIndex(pos)] != 0;
+	}
+
+	std::unique_ptr<Chunk> VmcRegionFile::readChunk(ChunkPos pos, size_t* bytesRead) {
+		std::shared_lock<std::shared_mutex> lock{ mutex };
+		const uint32_t entry = table[tableIndex(pos)];
+		if (entry == 0) return nullptr;
+
+		const uint64_t offset = static_cast<uint64_t>(entry >> 8) * SECTOR_SIZE;
+		const size_t size = static_cast<size_t>(entry & 0xff) * SECTOR_SIZE;
+		if (offset + size > mappedSize) return nullptr;
+
+		if (bytesRead != nullptr) *bytesRead = size;
+		auto chunk = decodeChunk(mappedData + offset, size, pos);
+		if (chunk == nullptr) {
+			std::cerr << path << ": chunk " << pos.x << ", " << pos.z << " is corrupt and will be regenerated" << std::endl;
+		}
+		return chunk;
+	}
+
+	size_t VmcRegionFile::writeChunks(const std::vector<const Chunk*>& chunks) {
+		// encoding is the slow part and doesn't touch the file, so do it before taking the lock
+		std::vector<std::vector<uint8_t>> encoded(chunks.size());
+		for (size_t i = 0; i < chunks.size(); i++) encodeChunk(*chunks[i], encoded[i]);
+
+		std::unique_lock<std::shared_mutex> lock{ mutex };
+
+		struct PendingEntry {
+			int index;
+			uint32_t entry;
+		};
+		std::vector<PendingEntry> pending;
+		pending.reserve(chunks.size());
+		size_t bytesWritten = 0;
+
+		for (size_t i = 0; i < chunks.size(); i++) {
+			std::vector<uint8_t>& data = encoded[i];
+			const uint32_t count = sectorsFor(data.size());
+			if (count > MAX_CHUNK_SECTORS) {
+				std::cerr << path << ": chunk " << chunks[i]->getPos().x << ", " << chunks[i]->getPos().z << " is too large to save" << std::endl;
+				continue;
+			}
+
+			// pad to whole sectors so the file never ends in a partial one
+			data.resize(static_cast<size_t>(count) * SECTOR_SIZE, 0);
+			const uint32_t first = allocateSectors(count);
+			writeAt(static_cast<uint64_t>(first) * SECTOR_SIZE, data.data(), data.size());
+			bytesWritten += data.size();
+			pending.push_back({ tableIndex(chunks[i]->getPos()), (first << 8) | count });
+		}
+
+		// the new copies have to be on disk before anything points at them
+		syncFile();
+		std::vector<uint32_t> released;
+		released.reserve(pending.size());
+		for (const PendingEntry& p : pending) {
+			released.push_back(table[p.index]);
+			table[p.index] = p.entry;
+			writeAt(static_cast<uint64_t>(p.index) * sizeof(uint32_t), &p.entry, sizeof(uint32_t));
+		}
+		syncFile();
+
+		// only now can the old copies be reused, before this a crash could still bring back a table pointing at them
+		for (uint32_t old : released) {
+			if (old != 0) releaseSectors(old >> 8, old & 0xff);
+		}
+
+		ensureMapped(fileSize());
+		return bytesWritten;
+	}
+
+	uint32_t VmcRegionFile::getFreeSectorCount() const {
+		std::shared_lock<std::shared_mutex> lock{ mutex };
+		uint32_t count = 0;
+		for (bool used : usedSectors) {
+			if (!used) count++;
+		}
+		return count;
+	}
+
+	uint32_t VmcRegionFile::allocateSectors(uint32_t count) {
+		// first fit, otherwise grow the file
+		uint32_t run = 0;
+		for (uint32_t s = HEADER_SECTORS; s < usedSectors.size(); s++) {
+			run = usedSectors[s] ? 0 : run + 1;
+			if (run == count) {
+				const uint32_t first = s + 1 - count;
+				for (uint32_t i = first; i <= s; i++) usedSectors[i] = true;
+				return first;
+			}
+		}
+
+		const uint32_t first = static_cast<uint32_t>(usedSectors.size()) - run;
+		usedSectors.resize(first + count, true);
+		for (uint32_t i = first; i < first + count; i++) usedSectors[i] = true;
+		return first;
+	}
+
+	void VmcRegionFile::releaseSectors(uint32_t first, uint32_t count) {
+		for (uint32_t s = first; s < first + count && s < usedSectors.size(); s++) usedSectors[s] = false;
+	}
+
+	void VmcRegionFile::encodeChunk(const Chunk& chunk, std::vector<uint8_t>& out) {
+		std::vector<uint8_t> raw;
+		raw.reserve(8 * 1024);
+		const ChunkPos pos = chunk.getPos();
+		raw.resize(sizeof(int32_t) * 2);
+		std::memcpy(raw.data(), &pos.x, sizeof(int32_t));
+		std::memcpy(raw.data() + sizeof(int32_t), &pos.z, sizeof(int32_t));
+		chunk.forEachSection([&](int, const ChunkSection& section) { section.serialize(raw); });
+
+		std::vector<uint8_t> compressed;
+		lzCompress(raw.data(), raw.size(), compressed);
+		const bool useCompression = compressed.size() < raw.size();
+		const std::vector<uint8_t>& payload = useCompression ? compressed : raw;
+
+		ChunkHeader header{};
+		header.payloadSize = static_cast<uint32_t>(payload.size());
+		header.crc = crc32(payload.data(), payload.size());
+		header.rawSize = static_cast<uint32_t>(raw.size());
+		header.compression = useCompression ? COMPRESSION_LZ : COMPRESSION_NONE;
+		header.version = FORMAT_VERSION;
+
+		out.resize(sizeof(ChunkHeader) + payload.size());
+		std::memcpy(out.data(), &header, sizeof(ChunkHeader));
+		std::memcpy(out.data() + sizeof(ChunkHeader), payload.data(), payload.size());
+	}
+
+	std::unique_ptr<Chunk> VmcRegionFile::decodeChunk(const uint8_t* data, size_t size, ChunkPos expected) {
+		ChunkHeader header;
+		if (size < sizeof(ChunkHeader)) return nullptr;
+		std::memcpy(&header, data, sizeof(ChunkHeader));
+		if (header.version != FORMAT_VERSION || header.payloadSize > size - sizeof(ChunkHeader)) return nullptr;
+
+		const uint8_t* payload = data + sizeof(ChunkHeader);
+		if (crc32(payload, header.payloadSize) != header.crc) return nullptr;
+
+		// uncompressed chunks are parsed directly out of the mapping, compressed ones are inflated into a buffer
+		// that each thread keeps around between calls
+		const uint8_t* raw = payload;
+		size_t rawSize = header.payloadSize;
+		if (header.compression == COMPRESSION_LZ) {
+			if (header.rawSize > MAX_RAW_SIZE) return nullptr;
+			thread_local std::vector<uint8_t> scratch;
+			scratch.resize(header.rawSize);
+			if (!lzDecompress(payload, header.payloadSize, scratch.data(), scratch.size())) return nullptr;
+			raw = scratch.data();
+			rawSize = scratch.size();
+		}
+		else if (header.compression != COMPRESSION_NONE) {
+			return nullptr;
+		}
+
+		const uint8_t* cursor = raw;
+		const uint8_t* end = raw + rawSize;
+		int32_t x, z;
+		if (rawSize < sizeof(int32_t) * 2) return nullptr;
+		std::memcpy(&x, cursor, sizeof(int32_t));
+		std::memcpy(&z, cursor + sizeof(int32_t), sizeof(int32_t));
+		cursor += sizeof(int32_t) * 2;
+		if (x != expected.x || z != expected.z) return nullptr;
+
+		auto chunk = std::make_unique<Chunk>(expected);
+		for (int s = 0; s < Chunk::SECTION_COUNT; s++) {
+			if (!chunk->getSection(s).deserialize(cursor, end)) return nullptr;
+		}
+		return cursor == end ? std::move(chunk) : nullptr;
+	}
+
+#ifdef _WIN32
+	void VmcRegionFile::openFile(const std::string& path) {
+		HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (handle == INVALID_HANDLE_VALUE) {
+			throw std::runtime_error("failed to open region file " + path);
+		}
+		fileHandle = handle;
+	}
+
+	void VmcRegionFile::closeFile() {
+		if (fileHandle != nullptr) CloseHandle(static_cast<HANDLE>(fileHandle));
+		fileHandle = nullptr;
+	}
+
+	uint64_t VmcRegionFile::fileSize() const {
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(static_cast<HANDLE>(fileHandle), &size)) {
+			throw std::runtime_error("failed to get size of region file " + path);
+		}
+		return static_cast<uint64_t>(size.QuadPart);
+	}
+
+	void VmcRegionFile::writeAt(uint64_t offset, const void* data, size_t size) {
+		OVERLAPPED overlapped{};
+		overlapped.Offset = static_cast<DWORD>(offset & 0xffffffffu);
+		overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+		DWORD written = 0;
+		if (!WriteFile(static_cast<HANDLE>(fileHandle), data, static_cast<DWORD>(size), &written, &overlapped) || written != size) {
+			throw std::runtime_error("failed to write region file " + path);
+		}
+	}
+
+	void VmcRegionFile::syncFile() {
+		FlushFileBuffers(static_cast<HANDLE>(fileHandle));
+	}
+
+	void VmcRegionFile::ensureMapped(uint64_t size) {
+		if (size <= mappedSize) return;
+		unmapFile();
+
+		HANDLE mapping = CreateFileMappingA(static_cast<HANDLE>(fileHandle), nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr) {
+			throw std::runtime_error("failed to map region file " + path);
+		}
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (view == nullptr) {
+			CloseHandle(mapping);
+			throw std::runtime_error("failed to map region file " + path);
+		}
+		mappingHandle = mapping;
+		mappedData = static_cast<const uint8_t*>(view);
+		mappedSize = size;
+	}
+
+	void VmcRegionFile::unmapFile() {
+		if (mappedData != nullptr) UnmapViewOfFile(mappedData);
+		if (mappingHandle != nullptr) CloseHandle(static_cast<HANDLE>(mappingHandle));
+		mappedData = nullptr;
+		mappingHandle = nullptr;
+		mappedSize = 0;
+	}
+#else
+	void VmcRegionFile::openFile(const std::string& path) {
+		fileDescriptor = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+		if (fileDescriptor < 0) {
+			throw std::runtime_error("failed to open region file " + path);
+		}
+	}
+
+	void VmcRegionFile::closeFile() {
+		if (fileDescriptor >= 0) close(fileDescriptor);
+		fileDescriptor = -1;
+	}
+
+	uint64_t VmcRegionFile::fileSize() const {
+		struct stat info;
+		if (fstat(fileDescriptor, &info) != 0) {
+			throw std::runtime_error("failed to get size of region file " + path);
+		}
+		return static_cast<uint64_t>(info.st_size);
+	}
+
+	void VmcRegionFile::writeAt(uint64_t offset, const void* data, size_t size) {
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		while (size > 0) {
+			const ssize_t written = pwrite(fileDescriptor, bytes, size, static_cast<off_t>(offset));
+			if (written <= 0) {
+				throw std::runtime_error("failed to write region file " + path);
+			}
+			bytes += written;
+			offset += static_cast<uint64_t>(written);
+			size -= static_cast<size_t>(written);
+		}
+	}
+
+	void VmcRegionFile::syncFile() {
+		fdatasync(fileDescriptor);
+	}
+
+	void VmcRegionFile::ensureMapped(uint64_t size) {
+		if (size <= mappedSize) return;
+		unmapFile();
+
+		void* view = mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_SHARED, fileDescriptor, 0);
+		if (view == MAP_FAILED) {
+			throw std::runtime_error("failed to map region file " + path);
+		}
+		mappedData = static_cast<const uint8_t*>(view);
+		mappedSize = size;
+	}
+
+	void VmcRegionFile::unmapFile() {
+		if (mappedData != nullptr) munmap(const_cast<uint8_t*>(mappedData), static_cast<size_t>(mappedSize));
+		mappedData = nullptr;
+		mappedSize = 0;
+	}
+#endif
+}
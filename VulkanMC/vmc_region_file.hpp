@@ -0,0 +1,109 @@
+#pragma once
+
+#include "vmc_chunk.hpp"
+
+// std
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+namespace vmc {
+	struct RegionPos {
+		int x;
+		int z;
+		bool operator==(const RegionPos& other) const { return x == other.x && z == other.z; }
+		bool operator!=(const RegionPos& other) const { return !(*this == other); }
+	};
+
+	struct RegionPosHash {
+		size_t operator()(const RegionPos& pos) const { return ChunkPosHash{}({ pos.x, pos.z }); }
+	};
+
+	// one file holding up to 32x32 chunk columns. the file is split into 4 KiB sectors, sector 0 is a table with one
+	// entry per chunk (first sector << 8 | sector count) and every chunk is stored in a run of whole sectors.
+	//
+	// chunks are never overwritten in place: a save goes to free sectors, is flushed to disk, and only then is the
+	// 4 byte table entry switched over and the old sectors released. a crash at any point leaves each entry pointing
+	// at either the old or the new copy, and every chunk carries a crc so a torn write is detected instead of loaded
+	class VmcRegionFile {
+	public:
+		static constexpr int SIZE = 32;
+		static constexpr int CHUNK_COUNT = SIZE * SIZE;
+		static constexpr size_t SECTOR_SIZE = 4096;
+		static constexpr uint32_t HEADER_SECTORS = 1;
+		static constexpr uint32_t MAX_CHUNK_SECTORS = 255;
+
+		struct ChunkHeader {
+			uint32_t payloadSize;
+			uint32_t crc;
+			uint32_t rawSize;
+			uint8_t compression;
+			uint8_t version;
+			uint16_t reserved;
+		};
+
+		enum Compression : uint8_t {
+			COMPRESSION_NONE = 0,
+			COMPRESSION_LZ = 1
+		};
+
+		// opens the region, creating the file if it doesn't exist. throws if the file can't be opened
+		explicit VmcRegionFile(const std::string& path);
+		~VmcRegionFile();
+
+		VmcRegionFile(const VmcRegionFile&) = delete;
+		VmcRegionFile& operator=(const VmcRegionFile&) = delete;
+
+		static RegionPos regionOf(ChunkPos pos) { return { pos.x >> 5, pos.z >> 5 }; }
+
+		bool hasChunk(ChunkPos pos) const;
+		// decodes straight out of the memory mapped file. returns nullptr if the chunk was never saved or fails its crc.
+		// safe to call from several threads at once
+		std::unique_ptr<Chunk> readChunk(ChunkPos pos, size_t* bytesRead = nullptr);
+		// encodes and stores every chunk with a single flush before and after the table update. returns bytes written
+		size_t writeChunks(const std::vector<const Chunk*>& chunks);
+
+		uint32_t getSectorCount() const { return static_cast<uint32_t>(usedSectors.size()); }
+		uint32_t getFreeSectorCount() const;
+
+		// encoded form of a chunk: ChunkHeader followed by the (possibly compressed) payload
+		static void encodeChunk(const Chunk& chunk, std::vector<uint8_t>& out);
+		static std::unique_ptr<Chunk> decodeChunk(const uint8_t* data, size_t size, ChunkPos expected);
+
+	private:
+		static int tableIndex(ChunkPos pos) { return (pos.z & (SIZE - 1)) * SIZE + (pos.x & (SIZE - 1)); }
+
+		uint32_t allocateSectors(uint32_t count);
+		void releaseSectors(uint32_t first, uint32_t count);
+
+		// platform specific
+		void openFile(const std::string& path);
+		void closeFile();
+		uint64_t fileSize() const;
+		void writeAt(uint64_t offset, const void* data, size_t size);
+		void syncFile();
+		// makes sure at least size bytes are mapped, remapping if the file grew
+		void ensureMapped(uint64_t size);
+		void unmapFile();
+
+		std::string path;
+		std::array<uint32_t, CHUNK_COUNT> table{};
+		std::vector<bool> usedSectors;
+
+		// readers hold it shared, writing and remapping hold it exclusively
+		mutable std::shared_mutex mutex;
+
+#ifdef _WIN32
+		void* fileHandle = nullptr;
+		void* mappingHandle = nullptr;
+#else
+		int fileDescriptor = -1;
+#endif
+		const uint8_t* mappedData = nullptr;
+		uint64_t mappedSize = 0;
+	};
+}
@@ -110,14 +110,14 @@ namespace vmc {
 		isFrameStarted = false;
 		currentFrameIndex = (currentFrameIndex + 1) % VmcSwapChain::MAX_FRAMES_IN_FLIGHT;
 	}
-	void VmcRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
+	void VmcRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer, SwapChainPass pass, VkSubpassContents contents) {
 		assert(isFrameStarted && "Can't call beginSwapChainRenderPass if frame is not in progress");
 		assert(commandBuffer == getCurrentCommandBuffer() && "Can't begin renderPass on command buffer from a different frame");
 
 		// A blueprint that tells the graphics pipeline what layout to expect for an output framebuffer + other instructions
 		VkRenderPassBeginInfo renderPassInfo{};
 		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = vmcSwapChain->getRenderPass();
+		renderPassInfo.renderPass = vmcSwapChain->getRenderPass(pass);
 		renderPassInfo.framebuffer = vmcSwapChain->getFrameBuffer(currentImageIndex);
 
 		// defines the area where shader loads and stores will take place
@@ -132,9 +132,9 @@ namespace vmc {
 		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 		renderPassInfo.pClearValues = clearValues.data();
 
-		// INLINE means that the subsuqent renderpass commands will be embedded in the primary command buffer 
-		// no secondary command buffers will be used
-		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		// INLINE records the pass into the primary itself, SECONDARY_COMMAND_BUFFERS takes it all from executed secondaries
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+		if (contents != VK_SUBPASS_CONTENTS_INLINE) return;
 
 		// dynamically set the viewport and put it in the command buffer. 
 		// we will always be using the correct window size even if the swapchain changes
@@ -20,8 +20,9 @@ namespace vmc {
 		VmcRenderer(const VmcRenderer&) = delete;
 		VmcRenderer& operator=(const VmcRenderer&) = delete;
 
-		VkRenderPass getSwapChainRenderPass() const { return vmcSwapChain->getRenderPass(); }
+		VkRenderPass getSwapChainRenderPass(SwapChainPass pass = SwapChainPass::Single) const { return vmcSwapChain->getRenderPass(pass); }
 		float getAspectRatio() const { return vmcSwapChain->extentAspectRatio(); }
+		VkExtent2D getSwapChainExtent() const { return vmcSwapChain->getSwapChainExtent(); }
 		bool isFrameInProgress() const { return isFrameStarted; }
 
 		VkCommandBuffer getCurrentCommandBuffer() const {
@@ -29,6 +30,16 @@ namespace vmc {
 			return commandBuffers[currentFrameIndex];
 		}
 
+		VkImageView getCurrentDepthImageView() const {
+			assert(isFrameStarted && "Cannot get depth image view when frame not in progress");
+			return vmcSwapChain->getDepthImageView(currentImageIndex);
+		}
+
+		VkFramebuffer getCurrentFramebuffer() const {
+			assert(isFrameStarted && "Cannot get framebuffer when frame not in progress");
+			return vmcSwapChain->getFrameBuffer(currentImageIndex);
+		}
+
 		int getFrameIndex() const {
 			assert(isFrameStarted && "Cannot get frame index when frame not in progress");
 			return currentFrameIndex;
@@ -36,7 +47,11 @@ namespace vmc {
 
 		VkCommandBuffer beginFrame();
 		void endFrame();
-		void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+		// when the frame is split for occlusion culling, call it once with First and once with Second. with
+		// VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS everything in the pass has to come from secondaries, which set
+		// the viewport and scissor themselves
+		void beginSwapChainRenderPass(VkCommandBuffer commandBuffer, SwapChainPass pass = SwapChainPass::Single,
+			VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
 		void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
 	private:
 		static void windowRefreshCallback(GLFWwindow* window);
@@ -51,7 +66,7 @@ namespace vmc {
 		std::vector<VkCommandBuffer> commandBuffers;
 
 		uint32_t currentImageIndex;
-		int currentFrameIndex;
+		int currentFrameIndex = 0;
 		bool isFrameStarted = false;
 	};
 }
@@ -0,0 +1,127 @@
+#include "vmc_ring_buffer.hpp"
+
+// std
+#include <algorithm>
+#include <stdexcept>
+
+namespace vmc {
+	// regions have to start aligned for any kind of descriptor, no device asks for more than 256 bytes
+	VmcRingBuffer::VmcRingBuffer(VmcDevice& device, VkDeviceSize requestedFrameSize)
+		: vmcDevice{ device }, frameSize{ (requestedFrameSize + 255) / 256 * 256 } {
+		// the dynamic descriptors always cover STORAGE_RANGE, so the last region gets that much slack behind it
+		void* data = nullptr;
+		vmcDevice.createBuffer(frameSize * VmcSwapChain::MAX_FRAMES_IN_FLIGHT + STORAGE_RANGE,
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU,
+			&buffer, &memory, &data);
+		mapped = static_cast<uint8_t*>(data);
+		createDescriptors();
+	}
+
+	VmcRingBuffer::~VmcRingBuffer() {
+		vkDestroyDescriptorPool(vmcDevice.device(), descriptorPool, nullptr);
+		vkDestroyDescriptorSetLayout(vmcDevice.device(), descriptorSetLayout, nullptr);
+		vmaDestroyBuffer(vmcDevice.vmaAllocator, buffer, memory);
+	}
+
+	void VmcRingBuffer::createDescriptors() {
+		VkDescriptorSetLayoutBinding bindings[2]{};
+		bindings[0].binding = 0;
+		bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		bindings[0].descriptorCount = 1;
+		bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+		bindings[1].binding = 1;
+		bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		bindings[1].descriptorCount = 1;
+		bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = 2;
+		layoutInfo.pBindings = bindings;
+		if (vkCreateDescriptorSetLayout(vmcDevice.device(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create ring buffer descriptor set layout");
+		}
+
+		VkDescriptorPoolSize poolSizes[2]{};
+		poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		poolSizes[0].descriptorCount = 1;
+		poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		poolSizes[1].descriptorCount = 1;
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.maxSets = 1;
+		poolInfo.poolSizeCount = 2;
+		poolInfo.pPoolSizes = poolSizes;
+		if (vkCreateDescriptorPool(vmcDevice.device(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create ring buffer descriptor pool");
+		}
+
+		// a single set for every frame, the dynamic offsets pick the region
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = descriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &descriptorSetLayout;
+		if (vkAllocateDescriptorSets(vmcDevice.device(), &allocInfo, &descriptorSet) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate ring buffer descriptor set");
+		}
+
+		VkDescriptorBufferInfo bufferInfos[2]{};
+		bufferInfos[0] = { buffer, 0, UNIFORM_RANGE };
+		bufferInfos[1] = { buffer, 0, STORAGE_RANGE };
+		VkWriteDescriptorSet writes[2]{};
+		for (uint32_t i = 0; i < 2; i++) {
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = descriptorSet;
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = bindings[i].descriptorType;
+			writes[i].pBufferInfo = &bufferInfos[i];
+		}
+		vkUpdateDescriptorSets(vmcDevice.device(), 2, writes, 0, nullptr);
+	}
+
+	void VmcRingBuffer::beginFrame(int frameIndex) {
+		lastFrameBytes = frameOffset;
+		this->frameIndex = frameIndex;
+		frameOffset = 0;
+	}
+
+	void VmcRingBuffer::flush() {
+		if (frameOffset == 0) return;
+		vmaFlushAllocation(vmcDevice.vmaAllocator, memory, frameSize * frameIndex, frameOffset);
+	}
+
+	RingAllocation VmcRingBuffer::allocateUniform(VkDeviceSize size) {
+		return allocate(size, vmcDevice.properties.limits.minUniformBufferOffsetAlignment);
+	}
+
+	RingAllocation VmcRingBuffer::allocateStorage(VkDeviceSize size) {
+		return allocate(size, vmcDevice.properties.limits.minStorageBufferOffsetAlignment);
+	}
+
+	RingAllocation VmcRingBuffer::allocateVertices(VkDeviceSize size) {
+		// enough for any vertex format
+		return allocate(size, 16);
+	}
+
+	RingAllocation VmcRingBuffer::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+		const VkDeviceSize offset = (frameOffset + alignment - 1) / alignment * alignment;
+		if (offset + size > frameSize) throw std::runtime_error("frame ring buffer is out of space");
+		frameOffset = offset + size;
+		highWaterMark = std::max(highWaterMark, frameOffset);
+
+		RingAllocation allocation;
+		const VkDeviceSize start = frameSize * frameIndex + offset;
+		allocation.data = mapped + start;
+		allocation.offset = static_cast<uint32_t>(start);
+		allocation.size = static_cast<uint32_t>(size);
+		return allocation;
+	}
+
+	void VmcRingBuffer::bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t set, uint32_t uniformOffset, uint32_t storageOffset) {
+		const uint32_t offsets[2] = { uniformOffset, storageOffset };
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, set, 1, &descriptorSet, 2, offsets);
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "vmc_device.hpp"
+#include "vmc_swap_chain.hpp"
+
+// std
+#include <cstdint>
+#include <cstring>
+
+namespace vmc {
+	struct RingAllocation {
+		void* data = nullptr;
+		// from the start of the buffer, which is also the dynamic offset to bind it with
+		uint32_t offset = 0;
+		uint32_t size = 0;
+	};
+
+	// one persistently mapped buffer split into a region per frame in flight, for data that is written fresh every
+	// frame: camera uniforms, per object storage data and dynamic vertices. allocating just bumps an offset in the
+	// current frame's region, which is free again once that frame comes around, since beginFrame waited on its fence.
+	// uniform and storage data is read through a single descriptor set with dynamic offsets
+	class VmcRingBuffer {
+	public:
+		// what the dynamic descriptors cover past their offset, larger uniform or storage blocks can't be bound
+		static constexpr uint32_t UNIFORM_RANGE = 256;
+		static constexpr uint32_t STORAGE_RANGE = 64 << 10;
+
+		VmcRingBuffer(VmcDevice& device, VkDeviceSize frameSize);
+		~VmcRingBuffer();
+
+		VmcRingBuffer(const VmcRingBuffer&) = delete;
+		VmcRingBuffer& operator=(const VmcRingBuffer&) = delete;
+
+		// after the renderer's beginFrame, everything allocated for this frame slot last time is dropped
+		void beginFrame(int frameIndex);
+		// makes this frame's writes visible to the gpu, has to happen before the frame is submitted
+		void flush();
+
+		// throw when the frame's region is full
+		RingAllocation allocateUniform(VkDeviceSize size);
+		RingAllocation allocateStorage(VkDeviceSize size);
+		RingAllocation allocateVertices(VkDeviceSize size);
+		template<typename T>
+		RingAllocation writeUniform(const T& data) {
+			static_assert(sizeof(T) <= UNIFORM_RANGE, "uniform block is larger than the ring's uniform range");
+			RingAllocation allocation = allocateUniform(sizeof(T));
+			std::memcpy(allocation.data, &data, sizeof(T));
+			return allocation;
+		}
+
+		// binding 0 is a dynamic uniform buffer and binding 1 a dynamic storage buffer, both into this buffer
+		void bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t set, uint32_t uniformOffset, uint32_t storageOffset = 0);
+		VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout; }
+		VkBuffer getBuffer() const { return buffer; }
+
+		VkDeviceSize getFrameSize() const { return frameSize; }
+		// alignment padding included
+		VkDeviceSize getBytesWritten() const { return frameOffset; }
+		VkDeviceSize getLastFrameBytes() const { return lastFrameBytes; }
+		// the most any frame has used, what frameSize could be brought down to
+		VkDeviceSize getHighWaterMark() const { return highWaterMark; }
+
+	private:
+		RingAllocation allocate(VkDeviceSize size, VkDeviceSize alignment);
+		void createDescriptors();
+
+		VmcDevice& vmcDevice;
+		VkDeviceSize frameSize;
+		VkBuffer buffer;
+		VmaAllocation memory;
+		uint8_t* mapped = nullptr;
+		VkDescriptorSetLayout descriptorSetLayout;
+		VkDescriptorPool descriptorPool;
+		VkDescriptorSet descriptorSet;
+
+		int frameIndex = 0;
+		VkDeviceSize frameOffset = 0;
+		VkDeviceSize lastFrameBytes = 0;
+		VkDeviceSize highWaterMark = 0;
+	};
+}
@@ -33,6 +33,10 @@ namespace vmc {
 			vkDestroySwapchainKHR(device.device(), swapChain, nullptr);
 			swapChain = nullptr;
 		}
+		for (size_t i = 0; i < offscreenImageMemorys.size(); i++) {
+			vkDestroyImage(device.device(), swapChainImages[i], nullptr);
+			vkFreeMemory(device.device(), offscreenImageMemorys[i], nullptr);
+		}
 
 		for (int i = 0; i < depthImages.size(); i++) {
 			vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
@@ -44,7 +48,9 @@ namespace vmc {
 			vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
 		}
 
-		vkDestroyRenderPass(device.device(), renderPass, nullptr);
+		for (VkRenderPass renderPass : renderPasses) {
+			vkDestroyRenderPass(device.device(), renderPass, nullptr);
+		}
 
 		// cleanup synchronization objects
 		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
@@ -72,6 +78,12 @@ namespace vmc {
 			VK_TRUE,
 			std::numeric_limits<uint64_t>::max());
 
+		if (device.isHeadless()) {
+			// the offscreen images are used in turn, the fence above already says this one is free
+			*imageIndex = static_cast<uint32_t>(currentFrame);
+			return VK_SUCCESS;
+		}
+
 		VkResult result = vkAcquireNextImageKHR(
 			device.device(),
 			swapChain,
@@ -89,12 +101,14 @@ namespace vmc {
 		}
 		imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
 
+		const bool presents = !device.isHeadless();
 		VkSubmitInfo submitInfo = {};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
+		// nothing was acquired and nothing will be presented when headless, so there is no semaphore to wait on or signal
 		VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
 		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.waitSemaphoreCount = presents ? 1 : 0;
 		submitInfo.pWaitSemaphores = waitSemaphores;
 		submitInfo.pWaitDstStageMask = waitStages;
 
@@ -102,7 +116,7 @@ namespace vmc {
 		submitInfo.pCommandBuffers = buffers;
 
 		VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
-		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.signalSemaphoreCount = presents ? 1 : 0;
 		submitInfo.pSignalSemaphores = signalSemaphores;
 
 		vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
@@ -111,6 +125,11 @@ namespace vmc {
 			throw std::runtime_error("failed to submit draw command buffer!");
 		}
 
+		if (!presents) {
+			currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+			return VK_SUCCESS;
+		}
+
 		VkPresentInfoKHR presentInfo = {};
 		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
@@ -131,6 +150,10 @@ namespace vmc {
 	}
 
 	void VmcSwapChain::createSwapChain() {
+		if (device.isHeadless()) {
+			createOffscreenImages();
+			return;
+		}
 		SwapChainSupportDetails swapChainSupport = device.getSwapChainSupport();
 
 		VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
@@ -192,6 +215,34 @@ namespace vmc {
 		swapChainExtent = extent;
 	}
 
+	void VmcSwapChain::createOffscreenImages() {
+		// the format the swapchain would most likely have picked, so the render passes and pipelines match a windowed run
+		swapChainImageFormat = device.findSupportedFormat(
+			{ VK_FORMAT_B8G8R8A8_SRGB, VK_FORMAT_R8G8B8A8_SRGB },
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT);
+		swapChainExtent = windowExtent;
+
+		swapChainImages.resize(MAX_FRAMES_IN_FLIGHT);
+		offscreenImageMemorys.resize(MAX_FRAMES_IN_FLIGHT);
+		for (size_t i = 0; i < swapChainImages.size(); i++) {
+			VkImageCreateInfo imageInfo{};
+			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageInfo.extent = { swapChainExtent.width, swapChainExtent.height, 1 };
+			imageInfo.mipLevels = 1;
+			imageInfo.arrayLayers = 1;
+			imageInfo.format = swapChainImageFormat;
+			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swapChainImages[i], offscreenImageMemorys[i]);
+		}
+	}
+
 	void VmcSwapChain::createImageViews() {
 		swapChainImageViews.resize(swapChainImages.size());
 		for (size_t i = 0; i < swapChainImages.size(); i++) {
@@ -214,15 +265,25 @@ namespace vmc {
 	}
 
 	void VmcSwapChain::createRenderPass() {
+		renderPasses[static_cast<int>(SwapChainPass::Single)] = createRenderPass(SwapChainPass::Single);
+		renderPasses[static_cast<int>(SwapChainPass::First)] = createRenderPass(SwapChainPass::First);
+		renderPasses[static_cast<int>(SwapChainPass::Second)] = createRenderPass(SwapChainPass::Second);
+	}
+
+	VkRenderPass VmcSwapChain::createRenderPass(SwapChainPass pass) {
+		// the first pass hands its depth to the hi-z build and the second one picks both attachments up again
+		const bool clears = pass != SwapChainPass::Second;
+		const bool presents = pass != SwapChainPass::First && !device.isHeadless();
+
 		VkAttachmentDescription depthAttachment{};
 		depthAttachment.format = findDepthFormat();
 		depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-		depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		depthAttachment.loadOp = clears ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+		depthAttachment.storeOp = pass == SwapChainPass::First ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		depthAttachment.initialLayout = clears ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		depthAttachment.finalLayout = pass == SwapChainPass::First ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
 		VkAttachmentReference depthAttachmentRef{};
 		depthAttachmentRef.attachment = 1;
@@ -231,12 +292,12 @@ namespace vmc {
 		VkAttachmentDescription colorAttachment = {};
 		colorAttachment.format = getSwapChainImageFormat();
 		colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		colorAttachment.loadOp = clears ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
 		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 		colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		colorAttachment.initialLayout = clears ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		colorAttachment.finalLayout = presents ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
 		VkAttachmentReference colorAttachmentRef = {};
 		colorAttachmentRef.attachment = 0;
@@ -248,7 +309,8 @@ namespace vmc {
 		subpass.pColorAttachments = &colorAttachmentRef;
 		subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
-		VkSubpassDependency dependency = {};
+		std::array<VkSubpassDependency, 2> dependencies{};
+		VkSubpassDependency& dependency = dependencies[0];
 		dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
 		dependency.srcAccessMask = 0;
 		dependency.srcStageMask =
@@ -258,6 +320,25 @@ namespace vmc {
 			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
 		dependency.dstAccessMask =
 			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		uint32_t dependencyCount = 1;
+
+		if (pass == SwapChainPass::First) {
+			// the hi-z build reads the depth right after this pass
+			VkSubpassDependency& depthRead = dependencies[dependencyCount++];
+			depthRead.srcSubpass = 0;
+			depthRead.dstSubpass = VK_SUBPASS_EXTERNAL;
+			depthRead.srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+			depthRead.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			depthRead.dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+			depthRead.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		}
+		else if (pass == SwapChainPass::Second) {
+			// wait for the hi-z build to stop sampling depth and for the first pass to finish writing both attachments
+			dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+			dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+				| VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		}
 
 		std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
 		VkRenderPassCreateInfo renderPassInfo = {};
@@ -266,12 +347,14 @@ namespace vmc {
 		renderPassInfo.pAttachments = attachments.data();
 		renderPassInfo.subpassCount = 1;
 		renderPassInfo.pSubpasses = &subpass;
-		renderPassInfo.dependencyCount = 1;
-		renderPassInfo.pDependencies = &dependency;
+		renderPassInfo.dependencyCount = dependencyCount;
+		renderPassInfo.pDependencies = dependencies.data();
 
+		VkRenderPass renderPass;
 		if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create render pass!");
 		}
+		return renderPass;
 	}
 
 	void VmcSwapChain::createFramebuffers() {
@@ -282,7 +365,7 @@ namespace vmc {
 			VkExtent2D swapChainExtent = getSwapChainExtent();
 			VkFramebufferCreateInfo framebufferInfo = {};
 			framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-			framebufferInfo.renderPass = renderPass;
+			framebufferInfo.renderPass = getRenderPass();
 			framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
 			framebufferInfo.pAttachments = attachments.data();
 			framebufferInfo.width = swapChainExtent.width;
@@ -320,7 +403,8 @@ namespace vmc {
 			imageInfo.format = depthFormat;
 			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
 			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-			imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+			// sampled by the hi-z build
+			imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
 			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 			imageInfo.flags = 0;
@@ -6,15 +6,21 @@
 #include <vulkan/vulkan.h>
 
 // std lib headers
+#include <array>
 #include <memory>
 #include <string>
 #include <vector>
 
 namespace vmc {
+	// which part of the frame a render pass draws. with occlusion culling the frame is split in two, the first pass
+	// keeps its depth around so the hi-z pyramid can be built from it and the second loads both attachments back
+	enum class SwapChainPass { Single, First, Second };
+
 	/* The swap chain is essentially a queue of images that are waiting to be presented to the screen.
 	Our application will acquire such an image to draw to it, and then return it to the queue.
 	How exactly the queue works and the conditions for presenting an image from the queue depend on how the swap chain is set up,
-	but the general purpose of the swap chain is to synchronize the presentation of images with the refresh rate of the screen.*/
+	but the general purpose of the swap chain is to synchronize the presentation of images with the refresh rate of the screen.
+	When the device is headless there is no surface, the frames go round a set of offscreen images instead and nothing is presented.*/
 	class VmcSwapChain {
 	public:
 		static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
@@ -27,8 +33,11 @@ namespace vmc {
 		VmcSwapChain& operator=(const VmcSwapChain&) = delete;
 
 		VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
-		VkRenderPass getRenderPass() { return renderPass; }
+		// all three passes are compatible, so pipelines and framebuffers made for one work with the others
+		VkRenderPass getRenderPass(SwapChainPass pass = SwapChainPass::Single) { return renderPasses[static_cast<int>(pass)]; }
 		VkImageView getImageView(int index) { return swapChainImageViews[index]; }
+		// only has the depth aspect, sampled in DEPTH_STENCIL_READ_ONLY_OPTIMAL between the first and second pass
+		VkImageView getDepthImageView(int index) { return depthImageViews[index]; }
 		size_t imageCount() { return swapChainImages.size(); }
 		VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
 		VkExtent2D getSwapChainExtent() { return swapChainExtent; }
@@ -49,9 +58,12 @@ namespace vmc {
 
 	private:
 		void createSwapChain();
+		// headless stand in for the swapchain images, one per frame in flight
+		void createOffscreenImages();
 		void createImageViews();
 		void createDepthResources();
 		void createRenderPass();
+		VkRenderPass createRenderPass(SwapChainPass pass);
 		void createFramebuffers();
 		void createSyncObjects();
 		void init();
@@ -68,18 +80,20 @@ namespace vmc {
 		VkExtent2D swapChainExtent;
 
 		std::vector<VkFramebuffer> swapChainFramebuffers;
-		VkRenderPass renderPass;
+		std::array<VkRenderPass, 3> renderPasses;
 
 		std::vector<VkImage> depthImages;
 		std::vector<VkDeviceMemory> depthImageMemorys;
 		std::vector<VkImageView> depthImageViews;
 		std::vector<VkImage> swapChainImages;
 		std::vector<VkImageView> swapChainImageViews;
+		// only allocated when headless, swapchain images belong to the swapchain
+		std::vector<VkDeviceMemory> offscreenImageMemorys;
 
 		VmcDevice& device;
 		VkExtent2D windowExtent;
 
-		VkSwapchainKHR swapChain;
+		VkSwapchainKHR swapChain = VK_NULL_HANDLE;
 		std::shared_ptr<VmcSwapChain> oldSwapChain;
 
 		std::vector<VkSemaphore> imageAvailableSemaphores;
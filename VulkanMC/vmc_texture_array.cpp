@@ -0,0 +1,150 @@
+#include "vmc_texture_array.hpp"
+
+// std
+#include <algorithm>
+#include <stdexcept>
+
+namespace vmc {
+	static uint32_t mipLevelCount(uint32_t width, uint32_t height) {
+		uint32_t levels = 1;
+		while ((std::max(width, height) >> levels) > 0) levels++;
+		return levels;
+	}
+
+	static int32_t levelSize(uint32_t size, uint32_t level) {
+		return static_cast<int32_t>(std::max(1u, size >> level));
+	}
+
+	VmcTextureArray::VmcTextureArray(VmcDevice& device, VmcUploadManager& uploadManager, const Ktx2Image& source)
+		: vmcDevice{ device }, format{ source.format }, width{ source.width }, height{ source.height }, layerCount{ source.layerCount } {
+		const VkFormatFeatureFlags features = vmcDevice.getFormatProperties(format).optimalTilingFeatures;
+		if ((features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) == 0) throw std::runtime_error("texture array format can't be sampled");
+		linearFilter = (features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) != 0;
+		// compressed formats can't be blitted into, without mips of their own they stay at one level
+		const VkFormatFeatureFlags blit = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+		blitMips = source.levels.size() == 1 && (features & blit) == blit;
+		mipLevels = blitMips ? mipLevelCount(width, height) : static_cast<uint32_t>(source.levels.size());
+
+		createImage();
+		for (uint32_t level = 0; level < source.levels.size(); level++) {
+			const VkExtent3D extent{ static_cast<uint32_t>(levelSize(width, level)), static_cast<uint32_t>(levelSize(height, level)), 1 };
+			uploadManager.uploadImage(image, extent, layerCount, source.levels[level].data(), source.levels[level].size(), level);
+		}
+		// the graphics queue picks the upload up before the blits, since they are submitted after it
+		uploadManager.submit();
+		if (blitMips) generateMipmaps();
+		createSampler();
+
+		for (uint32_t level = 0; level < mipLevels; level++) {
+			sizeInBytes += VmcKtx2File::layerBytes(format, levelSize(width, level), levelSize(height, level)) * layerCount;
+		}
+	}
+
+	VmcTextureArray::~VmcTextureArray() {
+		vkDestroySampler(vmcDevice.device(), sampler, nullptr);
+		vkDestroyImageView(vmcDevice.device(), imageView, nullptr);
+		vmaDestroyImage(vmcDevice.vmaAllocator, image, imageMemory);
+	}
+
+	void VmcTextureArray::createImage() {
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent = { width, height, 1 };
+		imageInfo.mipLevels = mipLevels;
+		imageInfo.arrayLayers = layerCount;
+		imageInfo.format = format;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		// levels are only read from when the smaller ones are blitted down from them
+		imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | (blitMips ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0);
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VmaAllocationCreateInfo allocInfo{};
+		allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+		if (vmaCreateImage(vmcDevice.vmaAllocator, &imageInfo, &allocInfo, &image, &imageMemory, nullptr) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create texture array image");
+		}
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+		viewInfo.format = format;
+		viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, layerCount };
+		if (vkCreateImageView(vmcDevice.device(), &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create texture array image view");
+		}
+	}
+
+	void VmcTextureArray::generateMipmaps() {
+		VkCommandBuffer commandBuffer = vmcDevice.beginSingleTimeCommands();
+
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, layerCount };
+
+		// the upload left level 0 ready for fragment shaders, that is what this waits on
+		barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		// each level is blitted from the one above it, then becomes the source of the next
+		for (uint32_t level = 1; level < mipLevels; level++) {
+			barrier.subresourceRange.baseMipLevel = level;
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+			VkImageBlit blit{};
+			blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, layerCount };
+			blit.srcOffsets[1] = { levelSize(width, level - 1), levelSize(height, level - 1), 1 };
+			blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, layerCount };
+			blit.dstOffsets[1] = { levelSize(width, level), levelSize(height, level), 1 };
+			vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit,
+				linearFilter ? VK_FILTER_LINEAR : VK_FILTER_NEAREST);
+
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		}
+
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, layerCount };
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		vmcDevice.endSingleTimeCommands(commandBuffer);
+	}
+
+	void VmcTextureArray::createSampler() {
+		VkSamplerCreateInfo samplerInfo{};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		// texels stay sharp up close, further away the mips blend them
+		samplerInfo.magFilter = VK_FILTER_NEAREST;
+		samplerInfo.minFilter = linearFilter ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+		samplerInfo.mipmapMode = linearFilter ? VK_SAMPLER_MIPMAP_MODE_LINEAR : VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		samplerInfo.anisotropyEnable = VK_TRUE;
+		samplerInfo.maxAnisotropy = std::min(8.f, vmcDevice.properties.limits.maxSamplerAnisotropy);
+		samplerInfo.minLod = .0f;
+		samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+		if (vkCreateSampler(vmcDevice.device(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create texture array sampler");
+		}
+	}
+}
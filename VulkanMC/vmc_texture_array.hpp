@@ -0,0 +1,54 @@
+#pragma once
+
+#include "vmc_device.hpp"
+#include "vmc_ktx2_file.hpp"
+#include "vmc_upload_manager.hpp"
+
+// std
+#include <cstdint>
+
+namespace vmc {
+	// a 2d array texture with a full mip chain, for textures that are all the same size and sampled together like the
+	// block textures. every level the image comes with goes through the upload manager as is, so baked files with
+	// compressed blocks and their own mips are never touched on the cpu. when there is only the top level the smaller
+	// ones are blitted down from it on the graphics queue. sampled with repeat, so coordinates can run past a single tile
+	class VmcTextureArray {
+	public:
+		// blocks until the mips have been built, throws when the device can't sample the format
+		VmcTextureArray(VmcDevice& device, VmcUploadManager& uploadManager, const Ktx2Image& source);
+		~VmcTextureArray();
+
+		VmcTextureArray(const VmcTextureArray&) = delete;
+		VmcTextureArray& operator=(const VmcTextureArray&) = delete;
+
+		VkImageView getImageView() const { return imageView; }
+		VkSampler getSampler() const { return sampler; }
+		uint32_t getLayerCount() const { return layerCount; }
+		uint32_t getMipLevels() const { return mipLevels; }
+		// every level of every layer
+		VkDeviceSize getSizeInBytes() const { return sizeInBytes; }
+
+	private:
+		void createImage();
+		// starts with level 0 in SHADER_READ_ONLY_OPTIMAL and leaves every level that way
+		void generateMipmaps();
+		void createSampler();
+
+		VmcDevice& vmcDevice;
+		VkFormat format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t layerCount;
+		uint32_t mipLevels;
+		VkDeviceSize sizeInBytes = 0;
+		// false when the format can't be filtered linearly, mips are then point sampled down and so is the texture
+		bool linearFilter;
+		// the image only came with level 0
+		bool blitMips;
+
+		VkImage image;
+		VmaAllocation imageMemory;
+		VkImageView imageView;
+		VkSampler sampler;
+	};
+}
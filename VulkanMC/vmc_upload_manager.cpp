@@ -0,0 +1,382 @@
+#include "vmc_upload_manager.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace vmc {
+	using Clock = std::chrono::steady_clock;
+
+	static VkSemaphore createTimeline(VkDevice device) {
+		VkSemaphoreTypeCreateInfo typeInfo{};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		typeInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext = &typeInfo;
+		VkSemaphore semaphore;
+		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create upload timeline semaphore");
+		}
+		return semaphore;
+	}
+
+	static VkCommandPool createPool(VkDevice device, uint32_t family) {
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = family;
+		// buffers are handed back one at a time as their batch finishes
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		VkCommandPool pool;
+		if (vkCreateCommandPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create upload command pool");
+		}
+		return pool;
+	}
+
+	VmcUploadManager::VmcUploadManager(VmcDevice& device, VkDeviceSize stagingSize) : vmcDevice{ device }, stagingSize{ stagingSize } {
+		const QueueFamilyIndices families = vmcDevice.findPhysicalQueueFamilies();
+		graphicsFamily = families.graphicsFamily;
+		transferFamily = families.transferFamilyHasValue ? families.transferFamily : families.graphicsFamily;
+
+		void* mapped = nullptr;
+		vmcDevice.createBuffer(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY, &stagingBuffer, &stagingMemory, &mapped);
+		mappedStaging = static_cast<uint8_t*>(mapped);
+
+		transferPool = createPool(vmcDevice.device(), transferFamily);
+		acquirePool = createPool(vmcDevice.device(), graphicsFamily);
+		transferTimeline = createTimeline(vmcDevice.device());
+		timeline = createTimeline(vmcDevice.device());
+		lastCollectTime = Clock::now();
+	}
+
+	VmcUploadManager::~VmcUploadManager() {
+		wait(nextValue - 1);
+		vkDestroySemaphore(vmcDevice.device(), timeline, nullptr);
+		vkDestroySemaphore(vmcDevice.device(), transferTimeline, nullptr);
+		vkDestroyCommandPool(vmcDevice.device(), acquirePool, nullptr);
+		vkDestroyCommandPool(vmcDevice.device(), transferPool, nullptr);
+		vmaDestroyBuffer(vmcDevice.vmaAllocator, stagingBuffer, stagingMemory);
+	}
+
+	void VmcUploadManager::uploadBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size, VkPipelineStageFlags dstStage,
+		VkAccessFlags dstAccess) {
+		if (size == 0) return;
+		BufferUpload upload{};
+		upload.buffer = buffer;
+		upload.region.srcOffset = allocateStaging(data, size);
+		upload.region.dstOffset = offset;
+		upload.region.size = size;
+		upload.dstStage = dstStage;
+		upload.dstAccess = dstAccess;
+		pendingBuffers.push_back(upload);
+		stats.bytes += size;
+		stats.copies++;
+	}
+
+	void VmcUploadManager::uploadImage(VkImage image, VkExtent3D extent, uint32_t layerCount, const void* data, VkDeviceSize size, uint32_t mipLevel) {
+		ImageUpload upload{};
+		upload.image = image;
+		upload.region.bufferOffset = allocateStaging(data, size);
+		upload.region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		upload.region.imageSubresource.mipLevel = mipLevel;
+		upload.region.imageSubresource.baseArrayLayer = 0;
+		upload.region.imageSubresource.layerCount = layerCount;
+		upload.region.imageExtent = extent;
+		pendingImages.push_back(upload);
+		stats.bytes += size;
+		stats.copies++;
+	}
+
+	VkDeviceSize VmcUploadManager::allocateStaging(const void* data, VkDeviceSize size) {
+		if (size > stagingSize) throw std::runtime_error("upload is larger than the staging ring");
+
+		const Clock::time_point start = Clock::now();
+		bool stalled = false;
+		while (true) {
+			VkDeviceSize offset = (stagingHead + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+			// whatever is left at the end is skipped and counted as used until the batch it ended up in is done
+			if (offset + size > stagingSize) offset = 0;
+			const VkDeviceSize taken = offset >= stagingHead ? offset - stagingHead + size : stagingSize - stagingHead + size;
+			if (stagingUsed + taken <= stagingSize) {
+				std::memcpy(mappedStaging + offset, data, static_cast<size_t>(size));
+				stagingHead = offset + size;
+				stagingUsed += taken;
+				pendingStagingBytes += taken;
+				if (stalled) stats.stallMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+				return offset;
+			}
+
+			collect();
+			if (stagingUsed + taken <= stagingSize) continue;
+			// the ring is full of what is being queued right now, it has to go out before any of it can come back
+			if (batches.empty()) {
+				submit();
+				continue;
+			}
+			stalled = true;
+			wait(batches.front().value);
+		}
+	}
+
+	uint64_t VmcUploadManager::submit() {
+		collect();
+		if (pendingBuffers.empty() && pendingImages.empty()) return nextValue - 1;
+
+		Batch batch;
+		batch.value = nextValue++;
+		batch.stagingBytes = pendingStagingBytes;
+		pendingStagingBytes = 0;
+		vmaFlushAllocation(vmcDevice.vmaAllocator, stagingMemory, 0, VK_WHOLE_SIZE);
+
+		batch.transferCommands = beginCommands(transferPool, freeTransferCommands);
+		recordTransfer(batch.transferCommands);
+		if (vkEndCommandBuffer(batch.transferCommands) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record upload command buffer");
+		}
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.signalSemaphoreValueCount = 1;
+		timelineInfo.pSignalSemaphoreValues = &batch.value;
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = &timelineInfo;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &batch.transferCommands;
+		submitInfo.signalSemaphoreCount = 1;
+
+		if (!usesTransferQueue()) {
+			submitInfo.pSignalSemaphores = &timeline;
+			if (vkQueueSubmit(vmcDevice.graphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+				throw std::runtime_error("failed to submit upload command buffer");
+			}
+		}
+		else {
+			submitInfo.pSignalSemaphores = &transferTimeline;
+			if (vkQueueSubmit(vmcDevice.transferQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+				throw std::runtime_error("failed to submit upload command buffer");
+			}
+
+			// the graphics queue takes ownership once the copies are done, later submits to it are ordered after this
+			batch.acquireCommands = beginCommands(acquirePool, freeAcquireCommands);
+			VkPipelineStageFlags dstStages = 0;
+			recordAcquire(batch.acquireCommands, dstStages);
+			if (vkEndCommandBuffer(batch.acquireCommands) != VK_SUCCESS) {
+				throw std::runtime_error("failed to record upload acquire command buffer");
+			}
+
+			VkTimelineSemaphoreSubmitInfo acquireTimelineInfo{};
+			acquireTimelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+			acquireTimelineInfo.waitSemaphoreValueCount = 1;
+			acquireTimelineInfo.pWaitSemaphoreValues = &batch.value;
+			acquireTimelineInfo.signalSemaphoreValueCount = 1;
+			acquireTimelineInfo.pSignalSemaphoreValues = &batch.value;
+
+			VkSubmitInfo acquireInfo{};
+			acquireInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			acquireInfo.pNext = &acquireTimelineInfo;
+			acquireInfo.waitSemaphoreCount = 1;
+			acquireInfo.pWaitSemaphores = &transferTimeline;
+			acquireInfo.pWaitDstStageMask = &dstStages;
+			acquireInfo.commandBufferCount = 1;
+			acquireInfo.pCommandBuffers = &batch.acquireCommands;
+			acquireInfo.signalSemaphoreCount = 1;
+			acquireInfo.pSignalSemaphores = &timeline;
+			if (vkQueueSubmit(vmcDevice.graphicsQueue(), 1, &acquireInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+				throw std::runtime_error("failed to submit upload acquire command buffer");
+			}
+		}
+
+		pendingBuffers.clear();
+		pendingImages.clear();
+		batch.submitTime = Clock::now();
+		batches.push_back(batch);
+		stats.batches++;
+		return batch.value;
+	}
+
+	bool VmcUploadManager::isComplete(uint64_t value) {
+		if (value <= completedValue) return true;
+		collect();
+		return value <= completedValue;
+	}
+
+	void VmcUploadManager::wait(uint64_t value) {
+		if (value <= completedValue) return;
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &timeline;
+		waitInfo.pValues = &value;
+		vkWaitSemaphores(vmcDevice.device(), &waitInfo, UINT64_MAX);
+		collect();
+	}
+
+	void VmcUploadManager::collect() {
+		if (batches.empty()) return;
+		vkGetSemaphoreCounterValue(vmcDevice.device(), timeline, &completedValue);
+
+		const Clock::time_point now = Clock::now();
+		while (!batches.empty() && batches.front().value <= completedValue) {
+			const Batch& batch = batches.front();
+			stats.activeMs += std::chrono::duration<double, std::milli>(now - std::max(batch.submitTime, lastCollectTime)).count();
+			lastCollectTime = now;
+			stagingUsed -= batch.stagingBytes;
+			freeTransferCommands.push_back(batch.transferCommands);
+			if (batch.acquireCommands != VK_NULL_HANDLE) freeAcquireCommands.push_back(batch.acquireCommands);
+			batches.pop_front();
+		}
+		// start over at the front while the ring is empty so big uploads don't have to wrap
+		if (stagingUsed == 0) stagingHead = 0;
+	}
+
+	VkCommandBuffer VmcUploadManager::beginCommands(VkCommandPool pool, std::vector<VkCommandBuffer>& freeBuffers) {
+		VkCommandBuffer commandBuffer;
+		if (freeBuffers.empty()) {
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandPool = pool;
+			allocInfo.commandBufferCount = 1;
+			if (vkAllocateCommandBuffers(vmcDevice.device(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+				throw std::runtime_error("failed to allocate upload command buffer");
+			}
+		}
+		else {
+			commandBuffer = freeBuffers.back();
+			freeBuffers.pop_back();
+		}
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+			throw std::runtime_error("failed to begin recording upload command buffer");
+		}
+		return commandBuffer;
+	}
+
+	// the level and layers the copy wrote
+	static VkImageMemoryBarrier imageBarrier(VkImage image, const VkImageSubresourceLayers& subresource, VkImageLayout oldLayout, VkImageLayout newLayout) {
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = subresource.mipLevel;
+		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.baseArrayLayer = subresource.baseArrayLayer;
+		barrier.subresourceRange.layerCount = subresource.layerCount;
+		return barrier;
+	}
+
+	void VmcUploadManager::recordTransfer(VkCommandBuffer commandBuffer) {
+		// old contents are thrown away, so images go straight from undefined and nothing has to be released to us first
+		std::vector<VkImageMemoryBarrier> imageBarriers;
+		for (const ImageUpload& upload : pendingImages) {
+			VkImageMemoryBarrier barrier = imageBarrier(upload.image, upload.region.imageSubresource, VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			imageBarriers.push_back(barrier);
+		}
+		if (!imageBarriers.empty()) {
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+				static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+		}
+
+		// one copy command per destination buffer with all of its regions, the sort keeps the order within a buffer
+		std::stable_sort(pendingBuffers.begin(), pendingBuffers.end(), [](const BufferUpload& a, const BufferUpload& b) { return a.buffer < b.buffer; });
+		std::vector<VkBufferCopy> regions;
+		for (size_t i = 0; i < pendingBuffers.size(); i++) {
+			regions.push_back(pendingBuffers[i].region);
+			if (i + 1 < pendingBuffers.size() && pendingBuffers[i + 1].buffer == pendingBuffers[i].buffer) continue;
+			vkCmdCopyBuffer(commandBuffer, stagingBuffer, pendingBuffers[i].buffer, static_cast<uint32_t>(regions.size()), regions.data());
+			regions.clear();
+		}
+		for (const ImageUpload& upload : pendingImages) {
+			vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, upload.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &upload.region);
+		}
+
+		imageBarriers.clear();
+		for (const ImageUpload& upload : pendingImages) {
+			VkImageMemoryBarrier barrier = imageBarrier(upload.image, upload.region.imageSubresource, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			imageBarriers.push_back(barrier);
+		}
+
+		if (!usesTransferQueue()) {
+			// same queue, a single memory barrier makes every buffer copy visible to whoever reads it next
+			VkMemoryBarrier memoryBarrier{};
+			memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			VkPipelineStageFlags dstStages = 0;
+			for (const BufferUpload& upload : pendingBuffers) {
+				memoryBarrier.dstAccessMask |= upload.dstAccess;
+				dstStages |= upload.dstStage;
+			}
+			for (VkImageMemoryBarrier& barrier : imageBarriers) barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			if (!imageBarriers.empty()) dstStages |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStages, 0, pendingBuffers.empty() ? 0 : 1, &memoryBarrier, 0, nullptr,
+				static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+			return;
+		}
+
+		// release to the graphics family, the layout change happens as part of the transfer and is repeated on acquire
+		std::vector<VkBufferMemoryBarrier> bufferBarriers;
+		for (const BufferUpload& upload : pendingBuffers) {
+			VkBufferMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.srcQueueFamilyIndex = transferFamily;
+			barrier.dstQueueFamilyIndex = graphicsFamily;
+			barrier.buffer = upload.buffer;
+			barrier.offset = upload.region.dstOffset;
+			barrier.size = upload.region.size;
+			bufferBarriers.push_back(barrier);
+		}
+		for (VkImageMemoryBarrier& barrier : imageBarriers) {
+			barrier.srcQueueFamilyIndex = transferFamily;
+			barrier.dstQueueFamilyIndex = graphicsFamily;
+		}
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+			static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(), static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+	}
+
+	void VmcUploadManager::recordAcquire(VkCommandBuffer commandBuffer, VkPipelineStageFlags& dstStages) {
+		std::vector<VkBufferMemoryBarrier> bufferBarriers;
+		for (const BufferUpload& upload : pendingBuffers) {
+			VkBufferMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.dstAccessMask = upload.dstAccess;
+			barrier.srcQueueFamilyIndex = transferFamily;
+			barrier.dstQueueFamilyIndex = graphicsFamily;
+			barrier.buffer = upload.buffer;
+			barrier.offset = upload.region.dstOffset;
+			barrier.size = upload.region.size;
+			bufferBarriers.push_back(barrier);
+			dstStages |= upload.dstStage;
+		}
+		std::vector<VkImageMemoryBarrier> imageBarriers;
+		for (const ImageUpload& upload : pendingImages) {
+			VkImageMemoryBarrier barrier = imageBarrier(upload.image, upload.region.imageSubresource, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			barrier.srcQueueFamilyIndex = transferFamily;
+			barrier.dstQueueFamilyIndex = graphicsFamily;
+			imageBarriers.push_back(barrier);
+			dstStages |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		}
+		// the semaphore wait blocks these stages, so starting the barrier at them chains it after the transfer
+		vkCmdPipelineBarrier(commandBuffer, dstStages, dstStages, 0, 0, nullptr, static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+			static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+	}
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "vmc_device.hpp"
+
+// std
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace vmc {
+	struct UploadStats {
+		uint64_t bytes = 0;
+		uint64_t copies = 0;
+		uint64_t batches = 0;
+		// time with at least one batch in flight, from its submit to when the manager saw it finish
+		double activeMs = 0.0;
+		// the cpu waiting for staging space to come free
+		double stallMs = 0.0;
+
+		double megabytesPerSecond() const { return activeMs == 0.0 ? 0.0 : bytes / (1024.0 * 1024.0) * 1000.0 / activeMs; }
+	};
+
+	// streams data into device local buffers and images through a persistently mapped staging ring. copies are queued
+	// on the cpu and recorded into one command buffer per submit, on the dedicated transfer family when the device has
+	// one. ownership of what was written is then handed to the graphics family, which acquires it in a small submit of
+	// its own that waits on the transfer on the gpu, so everything the graphics queue is given afterwards sees the data.
+	// completion is tracked with a timeline semaphore, the cpu only ever waits when the staging ring is full
+	class VmcUploadManager {
+	public:
+		static constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+		VmcUploadManager(VmcDevice& device, VkDeviceSize stagingSize);
+		~VmcUploadManager();
+
+		VmcUploadManager(const VmcUploadManager&) = delete;
+		VmcUploadManager& operator=(const VmcUploadManager&) = delete;
+
+		// the data is copied into the ring right away. dstStage and dstAccess are how the graphics queue reads the range,
+		// which must not be in use by any frame still in flight. throws if size is larger than the whole ring
+		void uploadBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+		// fills one mip level of every layer from tightly packed texels or blocks, extent is the level's. the image has to
+		// be created with the graphics family as owner and the level ends up in SHADER_READ_ONLY_OPTIMAL for fragment shaders
+		void uploadImage(VkImage image, VkExtent3D extent, uint32_t layerCount, const void* data, VkDeviceSize size, uint32_t mipLevel = 0);
+
+		// submits everything queued since the last call as one batch and returns its timeline value, or the last
+		// batch's when nothing was queued. has to happen before the frame that uses the data is submitted
+		uint64_t submit();
+		bool isComplete(uint64_t value);
+		void wait(uint64_t value);
+
+		bool usesTransferQueue() const { return transferFamily != graphicsFamily; }
+		VkDeviceSize getStagingSize() const { return stagingSize; }
+		const UploadStats& getStats() const { return stats; }
+		void resetStats() { stats = {}; }
+
+	private:
+		struct BufferUpload {
+			VkBuffer buffer;
+			VkBufferCopy region;
+			VkPipelineStageFlags dstStage;
+			VkAccessFlags dstAccess;
+		};
+		struct ImageUpload {
+			VkImage image;
+			VkBufferImageCopy region;
+		};
+		struct Batch {
+			uint64_t value = 0;
+			// staging bytes, wrap padding included, that come free when it is done
+			VkDeviceSize stagingBytes = 0;
+			VkCommandBuffer transferCommands = VK_NULL_HANDLE;
+			VkCommandBuffer acquireCommands = VK_NULL_HANDLE;
+			std::chrono::steady_clock::time_point submitTime;
+		};
+
+		// where the bytes went in the ring, waits for older batches while it is full
+		VkDeviceSize allocateStaging(const void* data, VkDeviceSize size);
+		// retires finished batches and frees their staging bytes
+		void collect();
+		VkCommandBuffer beginCommands(VkCommandPool pool, std::vector<VkCommandBuffer>& freeBuffers);
+		void recordTransfer(VkCommandBuffer commandBuffer);
+		void recordAcquire(VkCommandBuffer commandBuffer, VkPipelineStageFlags& dstStages);
+
+		VmcDevice& vmcDevice;
+		uint32_t graphicsFamily;
+		uint32_t transferFamily;
+
+		VkDeviceSize stagingSize;
+		VkBuffer stagingBuffer;
+		VmaAllocation stagingMemory;
+		uint8_t* mappedStaging = nullptr;
+		VkDeviceSize stagingHead = 0;
+		VkDeviceSize stagingUsed = 0;
+		// bytes taken by the batch that is still being queued
+		VkDeviceSize pendingStagingBytes = 0;
+
+		std::vector<BufferUpload> pendingBuffers;
+		std::vector<ImageUpload> pendingImages;
+		std::deque<Batch> batches;
+
+		VkCommandPool transferPool;
+		VkCommandPool acquirePool;
+		std::vector<VkCommandBuffer> freeTransferCommands;
+		std::vector<VkCommandBuffer> freeAcquireCommands;
+		// signalled by the transfer queue, only used when there is one
+		VkSemaphore transferTimeline;
+		// signalled once a batch is usable on the graphics queue
+		VkSemaphore timeline;
+		uint64_t nextValue = 1;
+		uint64_t completedValue = 0;
+
+		UploadStats stats;
+		std::chrono::steady_clock::time_point lastCollectTime;
+	};
+}
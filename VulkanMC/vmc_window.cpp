@@ -3,21 +3,30 @@
 #include <stdexcept>
 #include <iostream>
 namespace vmc {
-	VmcWindow::VmcWindow(uint16_t w, uint16_t h, std::string name) : width{ w }, height{ h }, windowName{ name } {
-		initWindow();
+	VmcWindow::VmcWindow(uint16_t w, uint16_t h, std::string name, bool headless) : width{ w }, height{ h }, windowName{ name } {
+		if (!headless) initWindow();
 	}
 
 	VmcWindow::~VmcWindow() {
+		// headless never called glfwInit, so there is nothing to tear down
+		if (window == nullptr) return;
 		glfwDestroyWindow(window);
 		glfwTerminate();
 	}
 
 	void VmcWindow::initWindow() {
-		glfwInit();
+		if (glfwInit() != GLFW_TRUE) {
+			throw std::runtime_error("failed to initialize glfw");
+		}
 		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 		glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
 		window = glfwCreateWindow(width, height, windowName.c_str(), nullptr, nullptr);
+		// a null window would pass for headless and glfw would never be terminated
+		if (window == nullptr) {
+			glfwTerminate();
+			throw std::runtime_error("failed to create window");
+		}
 		glfwSetWindowUserPointer(window, this);
 		glfwSetFramebufferSizeCallback(window, frameBufferResizedCallback);
 		//glfwSetWindowRefreshCallback(window, windowRefreshCallback);
@@ -8,18 +8,21 @@
 namespace vmc {
 	class VmcWindow {
 	public:
-		VmcWindow(uint16_t w, uint16_t h, std::string name);
+		// headless doesn't touch glfw at all, the window is then only the size of the offscreen images
+		VmcWindow(uint16_t w, uint16_t h, std::string name, bool headless = false);
 		~VmcWindow();
 
 		// delete copy and assignment constructors to prevent dangling pointers (RAII)
 		VmcWindow(const VmcWindow&) = delete;
 		VmcWindow& operator=(const VmcWindow&) = delete;
 
-		bool shouldClose() { return glfwWindowShouldClose(window); }
+		bool shouldClose() { return window != nullptr && glfwWindowShouldClose(window); }
+		bool isHeadless() const { return window == nullptr; }
 		VkExtent2D getExtent() {
 			return { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
 		}
 		bool wasWindowResized() { return framebufferResized; }
+		GLFWwindow* getGLFWwindow() const { return window; }
 		void resetWindowResizedFlag() { framebufferResized = false; }
 
 		void createWindowSurface(VkInstance instance, VkSurfaceKHR* surface);
@@ -33,7 +36,7 @@ namespace vmc {
 		int height;
 		bool framebufferResized = false;
 
-		GLFWwindow* window;
+		GLFWwindow* window = nullptr;
 		std::string windowName;
 	};
 }
@@ -0,0 +1,41 @@
+#include "vmc_world.hpp"
+
+// std
+#include <cassert>
+
+namespace vmc {
+	Chunk& VmcWorld::createChunk(ChunkPos pos) {
+		auto& slot = chunks[pos];
+		if (slot == nullptr) {
+			slot = std::make_unique<Chunk>(pos);
+		}
+		return *slot;
+	}
+
+	Chunk& VmcWorld::insertChunk(std::unique_ptr<Chunk> chunk) {
+		assert(chunk != nullptr && "Cannot insert a null chunk");
+		auto& slot = chunks[chunk->getPos()];
+		slot = std::move(chunk);
+		return *slot;
+	}
+
+	bool VmcWorld::setBlock(int x, int y, int z, BlockId id) {
+		Chunk* chunk = getChunk(toChunkPos(x, z));
+		if (chunk == nullptr) return false;
+		chunk->setBlock(toLocal(x), y, toLocal(z), id);
+		dirtyChunks.insert(chunk->getPos());
+		return true;
+	}
+
+	std::vector<ChunkPos> VmcWorld::takeDirtyChunks() {
+		std::vector<ChunkPos> taken(dirtyChunks.begin(), dirtyChunks.end());
+		dirtyChunks.clear();
+		return taken;
+	}
+
+	size_t VmcWorld::memoryUsage() const {
+		size_t bytes = sizeof(VmcWorld);
+		for (const auto& [pos, chunk] : chunks) bytes += chunk->memoryUsage();
+		return bytes;
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "vmc_chunk.hpp"
+
+// std
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace vmc {
+	// owns every loaded chunk column and translates world block coordinates into chunk local ones
+	class VmcWorld {
+	public:
+		VmcWorld() = default;
+
+		VmcWorld(const VmcWorld&) = delete;
+		VmcWorld& operator=(const VmcWorld&) = delete;
+
+		// arithmetic shift rounds towards negative infinity, so block -1 lives in chunk -1 at local 15
+		static ChunkPos toChunkPos(int x, int z) { return { x >> 4, z >> 4 }; }
+		static int toLocal(int v) { return v & 15; }
+
+		// returns the existing chunk if one is already loaded at pos
+		Chunk& createChunk(ChunkPos pos);
+		Chunk& insertChunk(std::unique_ptr<Chunk> chunk);
+
+		Chunk* getChunk(ChunkPos pos) {
+			auto it = chunks.find(pos);
+			return it == chunks.end() ? nullptr : it->second.get();
+		}
+		const Chunk* getChunk(ChunkPos pos) const {
+			auto it = chunks.find(pos);
+			return it == chunks.end() ? nullptr : it->second.get();
+		}
+
+		// blocks in chunks that are not loaded read as air
+		BlockId getBlock(int x, int y, int z) const {
+			const Chunk* chunk = getChunk(toChunkPos(x, z));
+			if (chunk == nullptr) return BLOCK_AIR;
+			return chunk->getBlock(toLocal(x), y, toLocal(z));
+		}
+		// returns false if the chunk holding the block is not loaded, otherwise the chunk is marked dirty
+		bool setBlock(int x, int y, int z, BlockId id);
+		// chunks changed through setBlock since the last call, so only those have to be saved
+		std::vector<ChunkPos> takeDirtyChunks();
+
+		template<typename F>
+		void forEachChunk(F&& f) const {
+			for (const auto& [pos, chunk] : chunks) f(*chunk);
+		}
+
+		size_t getChunkCount() const { return chunks.size(); }
+		size_t memoryUsage() const;
+
+	private:
+		std::unordered_map<ChunkPos, std::unique_ptr<Chunk>, ChunkPosHash> chunks;
+		std::unordered_set<ChunkPos, ChunkPosHash> dirtyChunks;
+	};
+}
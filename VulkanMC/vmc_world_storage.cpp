@@ -0,0 +1,76 @@
+#include "vmc_world_storage.hpp"
+
+// std
+#include <chrono>
+#include <filesystem>
+
+namespace vmc {
+	VmcWorldStorage::VmcWorldStorage(const std::string& directory) : directory{ directory } {
+		std::filesystem::create_directories(directory);
+	}
+
+	std::unique_ptr<Chunk> VmcWorldStorage::loadChunk(ChunkPos pos) {
+		const auto startTime = std::chrono::steady_clock::now();
+		size_t bytes = 0;
+		auto chunk = getRegion(VmcRegionFile::regionOf(pos)).readChunk(pos, &bytes);
+		if (chunk == nullptr) return nullptr;
+
+		const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime);
+		chunksLoaded.fetch_add(1, std::memory_order_relaxed);
+		bytesRead.fetch_add(bytes, std::memory_order_relaxed);
+		loadNanoseconds.fetch_add(static_cast<uint64_t>(elapsed.count()), std::memory_order_relaxed);
+		return chunk;
+	}
+
+	void VmcWorldStorage::saveChunks(const std::vector<const Chunk*>& chunks) {
+		const auto startTime = std::chrono::steady_clock::now();
+
+		std::unordered_map<RegionPos, std::vector<const Chunk*>, RegionPosHash> byRegion;
+		for (const Chunk* chunk : chunks) byRegion[VmcRegionFile::regionOf(chunk->getPos())].push_back(chunk);
+
+		for (const auto& [pos, regionChunks] : byRegion) {
+			bytesWritten += getRegion(pos).writeChunks(regionChunks);
+			chunksSaved += regionChunks.size();
+		}
+		saveSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	}
+
+	size_t VmcWorldStorage::saveDirtyChunks(VmcWorld& world) {
+		std::vector<const Chunk*> chunks;
+		for (ChunkPos pos : world.takeDirtyChunks()) {
+			if (const Chunk* chunk = world.getChunk(pos)) chunks.push_back(chunk);
+		}
+		if (!chunks.empty()) saveChunks(chunks);
+		return chunks.size();
+	}
+
+	StorageStats VmcWorldStorage::getStats() const {
+		StorageStats stats;
+		stats.chunksLoaded = chunksLoaded.load(std::memory_order_relaxed);
+		stats.bytesRead = bytesRead.load(std::memory_order_relaxed);
+		stats.loadSeconds = loadNanoseconds.load(std::memory_order_relaxed) * 1e-9;
+		stats.chunksSaved = chunksSaved;
+		stats.bytesWritten = bytesWritten;
+		stats.saveSeconds = saveSeconds;
+		return stats;
+	}
+
+	void VmcWorldStorage::resetStats() {
+		chunksLoaded = 0;
+		bytesRead = 0;
+		loadNanoseconds = 0;
+		chunksSaved = 0;
+		bytesWritten = 0;
+		saveSeconds = 0.0;
+	}
+
+	VmcRegionFile& VmcWorldStorage::getRegion(RegionPos pos) {
+		std::lock_guard<std::mutex> lock{ regionsMutex };
+		auto& region = regions[pos];
+		if (region == nullptr) {
+			const std::string path = directory + "/r." + std::to_string(pos.x) + "." + std::to_string(pos.z) + ".vmr";
+			region = std::make_unique<VmcRegionFile>(path);
+		}
+		return *region;
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "vmc_region_file.hpp"
+#include "vmc_world.hpp"
+
+// std
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vmc {
+	struct StorageStats {
+		uint64_t chunksLoaded = 0;
+		uint64_t chunksSaved = 0;
+		uint64_t bytesRead = 0;
+		uint64_t bytesWritten = 0;
+		double loadSeconds = 0.0;
+		double saveSeconds = 0.0;
+
+		double loadMegabytesPerSecond() const { return loadSeconds > 0.0 ? bytesRead / (1024.0 * 1024.0) / loadSeconds : 0.0; }
+		double saveMegabytesPerSecond() const { return saveSeconds > 0.0 ? bytesWritten / (1024.0 * 1024.0) / saveSeconds : 0.0; }
+		double loadChunksPerSecond() const { return loadSeconds > 0.0 ? chunksLoaded / loadSeconds : 0.0; }
+		double saveChunksPerSecond() const { return saveSeconds > 0.0 ? chunksSaved / saveSeconds : 0.0; }
+	};
+
+	// a directory of region files, opened on first use. loadChunk can be called from any number of threads
+	class VmcWorldStorage {
+	public:
+		// creates the directory if it doesn't exist
+		explicit VmcWorldStorage(const std::string& directory);
+
+		VmcWorldStorage(const VmcWorldStorage&) = delete;
+		VmcWorldStorage& operator=(const VmcWorldStorage&) = delete;
+
+		// nullptr if the chunk was never saved or is corrupt
+		std::unique_ptr<Chunk> loadChunk(ChunkPos pos);
+		// groups the chunks by region so each region file is flushed once
+		void saveChunks(const std::vector<const Chunk*>& chunks);
+		// saves the chunks the world has changed since this was last called, untouched regions are left alone.
+		// returns how many chunks were written
+		size_t saveDirtyChunks(VmcWorld& world);
+
+		// bytes and chunk counts are exact, loadSeconds is summed over every thread that loaded something so it
+		// measures decode cost rather than wall time
+		StorageStats getStats() const;
+		void resetStats();
+
+	private:
+		VmcRegionFile& getRegion(RegionPos pos);
+
+		std::string directory;
+		std::mutex regionsMutex;
+		std::unordered_map<RegionPos, std::unique_ptr<VmcRegionFile>, RegionPosHash> regions;
+
+		std::atomic<uint64_t> chunksLoaded{ 0 };
+		std::atomic<uint64_t> bytesRead{ 0 };
+		std::atomic<uint64_t> loadNanoseconds{ 0 };
+		uint64_t chunksSaved = 0;
+		uint64_t bytesWritten = 0;
+		double saveSeconds = 0.0;
+	};
+}
@@ -0,0 +1,125 @@
+#include "voxel_raycaster.hpp"
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <limits>
+#include <memory>
+#include <thread>
+
+namespace vmc {
+	RayHit VoxelRaycaster::cast(const Ray& ray) const {
+		ChunkCache cache;
+		uint64_t steps = 0;
+		return cast(ray, cache, steps);
+	}
+
+	RayHit VoxelRaycaster::cast(const Ray& ray, ChunkCache& cache, uint64_t& steps) const {
+		RayHit result;
+		const float length = glm::length(ray.direction);
+		if (length == .0f) return result;
+		const glm::vec3 direction = ray.direction / length;
+
+		// tMax is how far along the ray the next boundary on each axis is, tDelta how far apart those boundaries are
+		glm::ivec3 block{ glm::floor(ray.origin) };
+		glm::ivec3 step{ 0 };
+		glm::vec3 tMax{ std::numeric_limits<float>::infinity() };
+		glm::vec3 tDelta{ std::numeric_limits<float>::infinity() };
+		for (int axis = 0; axis < 3; axis++) {
+			if (direction[axis] > .0f) {
+				step[axis] = 1;
+				tDelta[axis] = 1.f / direction[axis];
+				tMax[axis] = (static_cast<float>(block[axis] + 1) - ray.origin[axis]) * tDelta[axis];
+			}
+			else if (direction[axis] < .0f) {
+				step[axis] = -1;
+				tDelta[axis] = -1.f / direction[axis];
+				tMax[axis] = (ray.origin[axis] - static_cast<float>(block[axis])) * tDelta[axis];
+			}
+		}
+
+		glm::ivec3 normal{ 0 };
+		float distance = .0f;
+		glm::ivec3 sectionPos{ INT_MIN };
+		const ChunkSection* section = nullptr;
+		while (true) {
+			// out of the top or bottom of the world and still heading away from it
+			if ((block.y < 0 && step.y <= 0) || (block.y >= Chunk::HEIGHT && step.y >= 0)) break;
+
+			if (block.y >= 0 && block.y < Chunk::HEIGHT) {
+				const glm::ivec3 current{ block.x >> 4, block.y >> 4, block.z >> 4 };
+				if (current != sectionPos) {
+					sectionPos = current;
+					const Chunk* chunk = cache.get(world, { current.x, current.z });
+					section = chunk == nullptr ? nullptr : &chunk->getSection(current.y);
+				}
+				if (section != nullptr && !section->isEmpty()) {
+					const BlockId id = section->getBlock(block.x & 15, block.y & 15, block.z & 15);
+					if (isSolidBlock(id)) {
+						result.hit = true;
+						result.block = id;
+						result.position = block;
+						result.normal = normal;
+						result.distance = distance;
+						return result;
+					}
+				}
+			}
+
+			const int axis = tMax.x < tMax.y ? (tMax.x < tMax.z ? 0 : 2) : (tMax.y < tMax.z ? 1 : 2);
+			distance = tMax[axis];
+			if (distance > ray.maxDistance) break;
+			block[axis] += step[axis];
+			tMax[axis] += tDelta[axis];
+			normal = glm::ivec3{ 0 };
+			normal[axis] = -step[axis];
+			steps++;
+		}
+		return result;
+	}
+
+	RaycastStats VoxelRaycaster::castBatch(VmcJobSystem& jobSystem, const std::vector<Ray>& rays, std::vector<RayHit>& hits) const {
+		const auto start = std::chrono::steady_clock::now();
+		hits.resize(rays.size());
+
+		// jobs that only get to run after everything is done still hold on to this, so it is shared
+		struct Progress {
+			std::atomic<size_t> nextBlock{ 0 };
+			std::atomic<size_t> raysDone{ 0 };
+			std::atomic<uint64_t> steps{ 0 };
+		};
+		auto progress = std::make_shared<Progress>();
+		const size_t count = rays.size();
+		const size_t blockCount = (count + RAYS_PER_BLOCK - 1) / RAYS_PER_BLOCK;
+		const Ray* rayData = rays.data();
+		RayHit* hitData = hits.data();
+
+		auto work = [this, progress, count, blockCount, rayData, hitData] {
+			ChunkCache cache;
+			for (size_t i = progress->nextBlock.fetch_add(1); i < blockCount; i = progress->nextBlock.fetch_add(1)) {
+				const size_t first = i * RAYS_PER_BLOCK;
+				const size_t last = std::min(count, first + RAYS_PER_BLOCK);
+				uint64_t steps = 0;
+				for (size_t j = first; j < last; j++) hitData[j] = cast(rayData[j], cache, steps);
+				progress->steps.fetch_add(steps);
+				progress->raysDone.fetch_add(last - first);
+			}
+		};
+		const size_t helpers = std::min<size_t>(jobSystem.getWorkerCount(), blockCount > 0 ? blockCount - 1 : 0);
+		for (size_t i = 0; i < helpers; i++) jobSystem.submit(work);
+		work();
+		// whatever the workers picked up last
+		while (progress->raysDone.load() < count) std::this_thread::yield();
+
+		RaycastStats stats;
+		stats.rays = count;
+		stats.steps = progress->steps.load();
+		for (const RayHit& hit : hits) {
+			if (hit.hit) stats.hits++;
+		}
+		stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return stats;
+	}
+}
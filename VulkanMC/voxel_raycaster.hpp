@@ -0,0 +1,83 @@
+#pragma once
+
+#include "vmc_job_system.hpp"
+#include "vmc_world.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace vmc {
+	struct Ray {
+		glm::vec3 origin{ .0f };
+		// doesn't have to be normalized, distances are in blocks either way
+		glm::vec3 direction{ .0f, -1.f, .0f };
+		float maxDistance = 64.f;
+	};
+
+	struct RayHit {
+		bool hit = false;
+		BlockId block = BLOCK_AIR;
+		glm::ivec3 position{ 0 };
+		// points out of the face the ray entered through, zero when the ray starts inside the block
+		glm::ivec3 normal{ 0 };
+		// from the origin to where the ray entered the block
+		float distance = .0f;
+	};
+
+	struct RaycastStats {
+		uint64_t rays = 0;
+		uint64_t hits = 0;
+		// block boundaries crossed, summed over all rays
+		uint64_t steps = 0;
+		double ms = 0.0;
+
+		double raysPerSecond() const { return ms == 0.0 ? 0.0 : rays * 1000.0 / ms; }
+	};
+
+	// walks rays through the block grid one block at a time (amanatides and woo) and stops at the first solid block.
+	// chunks that aren't loaded read as air. used for block picking, line of sight and explosions
+	class VoxelRaycaster {
+	public:
+		// rays a thread takes at a time in castBatch
+		static constexpr size_t RAYS_PER_BLOCK = 256;
+
+		explicit VoxelRaycaster(const VmcWorld& world) : world{ world } {}
+
+		RayHit cast(const Ray& ray) const;
+		// hits[i] is the result of rays[i]. blocks of rays are spread over the job system and the calling thread works
+		// through them too, so it also finishes when every worker is busy. the world must not change until it returns
+		RaycastStats castBatch(VmcJobSystem& jobSystem, const std::vector<Ray>& rays, std::vector<RayHit>& hits) const;
+
+	private:
+		// the columns a thread looked at last, shared by all the rays it casts. rays from the same batch tend to
+		// pass through the same few, so the world's hash map is rarely touched
+		struct ChunkCache {
+			struct Entry {
+				ChunkPos pos{ 0, 0 };
+				const Chunk* chunk = nullptr;
+				bool valid = false;
+			};
+			std::array<Entry, 16> entries{};
+
+			const Chunk* get(const VmcWorld& world, ChunkPos pos) {
+				Entry& entry = entries[(pos.x & 3) | ((pos.z & 3) << 2)];
+				if (!entry.valid || entry.pos != pos) {
+					entry.pos = pos;
+					entry.chunk = world.getChunk(pos);
+					entry.valid = true;
+				}
+				return entry.chunk;
+			}
+		};
+
+		RayHit cast(const Ray& ray, ChunkCache& cache, uint64_t& steps) const;
+
+		const VmcWorld& world;
+	};
+}